@@ -20,6 +20,7 @@ import org.json.JSONObject
 
 const val START_LISTENING_CONST = "startListening"
 const val STOP_LISTENING_CONST = "stopListening"
+const val UPDATE_CONFIG_CONST = "updateConfig"
 const val MIRROR_METHOD_CHANNEL = "com.flutterplaza.no_screen_mirror_methods"
 const val MIRROR_EVENT_CHANNEL = "com.flutterplaza.no_screen_mirror_streams"
 
@@ -90,6 +91,14 @@ class NoScreenMirrorPlugin : FlutterPlugin, MethodChannel.MethodCallHandler, Act
                 startDetection()
                 result.success("Listening started")
             }
+            UPDATE_CONFIG_CONST -> {
+                // Detection is event-driven; there is nothing to swap.
+                val intervalMs = call.argument<Int>("pollingIntervalMs")
+                if (intervalMs != null && intervalMs > 0) {
+                    pollingIntervalMs = intervalMs.toLong()
+                }
+                result.success("Config updated")
+            }
             STOP_LISTENING_CONST -> {
                 stopDetection()
                 result.success("Listening stopped")
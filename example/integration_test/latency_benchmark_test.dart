@@ -0,0 +1,241 @@
+// End-to-end latency benchmark for the Linux plugin.
+//
+// Each sample injects a state change natively, either by flipping a fake
+// connector's `status` file or by adding a fake screen sharing process to a
+// fixture laid out like `/proc`, and times how long it takes for the matching
+// MirrorSnapshot to arrive on `mirrorStream`. Timestamps come from
+// `Timeline.now`, the monotonic clock the plugin stamps events with, so every
+// sample also splits into detection, queueing and channel delivery.
+//
+// Run headless from the example directory:
+//
+// $ xvfb-run flutter test integration_test/latency_benchmark_test.dart \
+//       -d linux --dart-define=LATENCY_SAMPLES=50
+//
+// Results are printed as a table and attached to the test's report data.
+
+import 'dart:async';
+import 'dart:developer';
+import 'dart:io';
+import 'dart:math';
+
+import 'package:flutter_test/flutter_test.dart';
+import 'package:integration_test/integration_test.dart';
+
+import 'package:no_screen_mirror/linux_scan_options.dart';
+import 'package:no_screen_mirror/mirror_snapshot.dart';
+import 'package:no_screen_mirror/no_screen_mirror.dart';
+
+const int sampleCount =
+    int.fromEnvironment('LATENCY_SAMPLES', defaultValue: 20);
+
+const List<Duration> pollingIntervals = [
+  Duration(milliseconds: 100),
+  Duration(milliseconds: 500),
+  Duration(seconds: 2),
+];
+
+const String fakeProcessPid = '4242';
+
+/// How a sample changes the native state.
+enum Injection { connector, process }
+
+/// One detector configuration under test.
+class Backend {
+  final String name;
+  final Injection injection;
+  final LinuxScanOptions options;
+
+  const Backend(this.name, this.injection, this.options);
+}
+
+const List<Backend> backends = [
+  Backend('connector', Injection.connector, LinuxScanOptions()),
+  Backend('process', Injection.process, LinuxScanOptions()),
+  Backend('process, 4 threads', Injection.process,
+      LinuxScanOptions(scanThreads: 4)),
+  Backend('process, sliced', Injection.process,
+      LinuxScanOptions(scanSliceBudget: Duration(microseconds: 500))),
+];
+
+/// Fake `/proc` and `/sys/class/drm` trees the detector is pointed at.
+class Fixture {
+  final Directory root = Directory.systemTemp.createTempSync('nsm_latency_');
+
+  String get procRoot => '${root.path}/proc';
+  String get drmRoot => '${root.path}/drm';
+
+  Fixture() {
+    // Enough processes that a walk isn't free.
+    for (var pid = 1; pid <= 500; pid++) {
+      _writeFile('$procRoot/$pid/comm', 'bash');
+    }
+    _writeFile('$drmRoot/card0-eDP-1/status', 'connected');
+    setExternalConnected(false);
+  }
+
+  void setExternalConnected(bool connected) {
+    _writeFile('$drmRoot/card0-HDMI-A-1/status',
+        connected ? 'connected' : 'disconnected');
+  }
+
+  void setSharing(bool sharing) {
+    final process = Directory('$procRoot/$fakeProcessPid');
+    if (sharing) {
+      _writeFile('${process.path}/comm', 'obs');
+    } else if (process.existsSync()) {
+      process.deleteSync(recursive: true);
+    }
+  }
+
+  void delete() => root.deleteSync(recursive: true);
+
+  static void _writeFile(String path, String line) {
+    File(path)
+      ..createSync(recursive: true)
+      ..writeAsStringSync('$line\n', flush: true);
+  }
+}
+
+/// Timings of one sample, in microseconds.
+class Sample {
+  final int total;
+  final int? detection;
+  final int? queueing;
+  final int? delivery;
+
+  Sample(this.total, this.detection, this.queueing, this.delivery);
+}
+
+/// Nearest-rank percentile of [values], which must be sorted.
+int percentile(List<int> values, double p) {
+  final rank = (p / 100 * values.length).ceil().clamp(1, values.length);
+  return values[rank - 1];
+}
+
+Map<String, int> summarize(Iterable<int?> values) {
+  final sorted = values.whereType<int>().toList()..sort();
+  if (sorted.isEmpty) return const {};
+  return {
+    'p50': percentile(sorted, 50),
+    'p99': percentile(sorted, 99),
+    'max': sorted.last,
+  };
+}
+
+String ms(int? us) => us == null ? '-' : (us / 1000).toStringAsFixed(1);
+
+void main() {
+  final binding = IntegrationTestWidgetsFlutterBinding.ensureInitialized();
+
+  testWidgets('native state change to mirrorStream latency', (tester) async {
+    final plugin = NoScreenMirror.instance;
+    final random = Random(42);
+    final report = <String, dynamic>{};
+    final rows = <String>[];
+
+    for (final backend in backends) {
+      for (final interval in pollingIntervals) {
+        final fixture = Fixture();
+        final snapshots = StreamController<MirrorSnapshot>.broadcast();
+        final subscription = plugin.mirrorStream.listen(snapshots.add);
+
+        Future<MirrorSnapshot> nextMatching(
+            bool Function(MirrorSnapshot) test) {
+          return snapshots.stream
+              .firstWhere(test)
+              .timeout(interval * 4 + const Duration(seconds: 5));
+        }
+
+        bool matches(MirrorSnapshot snapshot, bool target) =>
+            backend.injection == Injection.connector
+                ? snapshot.isExternalDisplayConnected == target
+                : snapshot.isScreenShared == target;
+
+        // Without the default one-per-second rate limit, so queueing measures
+        // the plugin rather than the limiter holding back alternate samples.
+        await plugin.startListening(
+          pollingInterval: interval,
+          maxEventsPerSecond: 0,
+          linuxScanOptions: LinuxScanOptions(
+            processSource: backend.options.processSource,
+            scanThreads: backend.options.scanThreads,
+            scanSliceBudget: backend.options.scanSliceBudget,
+            procRoot: fixture.procRoot,
+            drmRoot: fixture.drmRoot,
+          ),
+        );
+        // Let the initial state through: the first scan always sends an
+        // event confirming the provisional snapshot, which must not be taken
+        // for a sample.
+        await Future<void>.delayed(interval + const Duration(seconds: 2));
+
+        final samples = <Sample>[];
+        var target = true;
+        for (var i = 0; i < sampleCount; i++) {
+          // Land at a random phase of the poll timer.
+          await Future<void>.delayed(Duration(
+              microseconds: random.nextInt(interval.inMicroseconds)));
+
+          final arrival = nextMatching((s) => matches(s, target));
+          final injectedAtUs = Timeline.now;
+          if (backend.injection == Injection.connector) {
+            fixture.setExternalConnected(target);
+          } else {
+            fixture.setSharing(target);
+          }
+          final snapshot = await arrival;
+          final arrivedAtUs = Timeline.now;
+
+          final detectedAtUs = snapshot.detectedAtUs;
+          final enqueuedAtUs = snapshot.enqueuedAtUs;
+          samples.add(Sample(
+            arrivedAtUs - injectedAtUs,
+            detectedAtUs == null ? null : detectedAtUs - injectedAtUs,
+            snapshot.enqueueDelay?.inMicroseconds,
+            enqueuedAtUs == null ? null : arrivedAtUs - enqueuedAtUs,
+          ));
+          target = !target;
+        }
+
+        await plugin.stopListening();
+        await subscription.cancel();
+        await snapshots.close();
+        fixture.delete();
+
+        final total = summarize(samples.map((s) => s.total));
+        final detection = summarize(samples.map((s) => s.detection));
+        final queueing = summarize(samples.map((s) => s.queueing));
+        final delivery = summarize(samples.map((s) => s.delivery));
+        report['${backend.name} @ ${interval.inMilliseconds}ms'] = {
+          'total_us': total,
+          'detection_us': detection,
+          'queueing_us': queueing,
+          'delivery_us': delivery,
+        };
+        rows.add('${backend.name.padRight(20)} '
+            '${interval.inMilliseconds.toString().padLeft(6)} '
+            '${ms(total['p50']).padLeft(8)} '
+            '${ms(total['p99']).padLeft(8)} '
+            '${ms(total['max']).padLeft(8)} '
+            '${ms(detection['p50']).padLeft(10)} '
+            '${ms(queueing['p50']).padLeft(10)} '
+            '${ms(delivery['p50']).padLeft(10)}');
+
+        expect(samples, hasLength(sampleCount));
+      }
+    }
+
+    // ignore: avoid_print
+    print('${'backend'.padRight(20)} '
+        '${'poll'.padLeft(6)} '
+        '${'p50_ms'.padLeft(8)} '
+        '${'p99_ms'.padLeft(8)} '
+        '${'max_ms'.padLeft(8)} '
+        '${'detect_p50'.padLeft(10)} '
+        '${'queue_p50'.padLeft(10)} '
+        '${'chan_p50'.padLeft(10)}\n'
+        '${rows.join('\n')}');
+    binding.reportData = {'latency': report, 'samples': sampleCount};
+  }, skip: !Platform.isLinux, timeout: Timeout.none);
+}
@@ -32,6 +32,13 @@ public class NoScreenMirrorPlugin: NSObject, FlutterPlugin, FlutterStreamHandler
             }
             startDetection()
             result("Listening started")
+        case "updateConfig":
+            // Detection is event-driven; there is nothing to swap.
+            if let args = call.arguments as? [String: Any],
+               let intervalMs = args["pollingIntervalMs"] as? Int, intervalMs > 0 {
+                pollingIntervalMs = intervalMs
+            }
+            result("Config updated")
         case "stopListening":
             stopDetection()
             result("Listening stopped")
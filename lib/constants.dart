@@ -4,6 +4,9 @@ const startListeningConst = 'startListening';
 /// Method name used to stop listening for screen mirror changes.
 const stopListeningConst = 'stopListening';
 
+/// Method name used to change detector settings while listening.
+const updateConfigConst = 'updateConfig';
+
 /// The method channel name for invoking native plugin methods.
 const mirrorMethodChannel = 'com.flutterplaza.no_screen_mirror_methods';
 
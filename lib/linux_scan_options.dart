@@ -0,0 +1,331 @@
+/// Where the Linux implementation looks for screen sharing apps.
+enum LinuxProcessSource {
+  /// Walks every process in `/proc` and matches its name.
+  processTable,
+
+  /// Enumerates the current user's systemd app scopes under `/sys/fs/cgroup`
+  /// and matches the scope names (e.g. `app-flatpak-us.zoom.Zoom-1234.scope`).
+  ///
+  /// Reads tens of entries instead of every process, catches sandboxed apps
+  /// whose process name is `bwrap` or truncated, and is notified of new
+  /// scopes via inotify instead of polling. Apps started from a terminal share
+  /// the terminal's scope and are not detected. Falls back to [processTable]
+  /// when no cgroup v2 user session is available.
+  appScopes,
+}
+
+/// Which processes a [LinuxProcessSource.processTable] walk reads.
+enum LinuxProcessScope {
+  /// Every process on the system.
+  all,
+
+  /// Only the current user's processes, skipping other users' processes and
+  /// kernel threads with one `fstatat` on each `/proc/<pid>` directory before
+  /// anything is read from it.
+  user,
+
+  /// Only the current user's processes in this app's logind session. Apps
+  /// started by the systemd user manager belong to the manager's session and
+  /// are skipped. Same as [user] when the app has no session.
+  session,
+}
+
+/// Linux-specific tuning for screen sharing detection.
+///
+/// Passed to [NoScreenMirror.startListening] and ignored on other platforms.
+class LinuxScanOptions {
+  /// Where screen sharing apps are looked up. Defaults to
+  /// [LinuxProcessSource.processTable].
+  final LinuxProcessSource processSource;
+
+  /// Which processes the `/proc` walk reads. On multi-user hosts
+  /// [LinuxProcessScope.user] reads an order of magnitude fewer `comm`
+  /// files. Defaults to [LinuxProcessScope.all].
+  final LinuxProcessScope processScope;
+
+  /// Whether a process matched by name must also hold a capture resource open
+  /// to count as screen sharing: PipeWire stream buffers, a `/dev/dri` render
+  /// node, or a `/dev/video*` v4l2loopback device.
+  ///
+  /// Applies to [LinuxProcessSource.processTable]. Defaults to `false`.
+  final bool requireCaptureEvidence;
+
+  /// The maximum number of open file descriptors inspected per poll when
+  /// [requireCaptureEvidence] is enabled.
+  ///
+  /// Candidates are inspected round-robin and resume where the previous poll
+  /// stopped, which bounds the cost of each poll. Defaults to 256.
+  final int captureFdBudget;
+
+  /// Whether processes are also identified by the capture libraries their
+  /// executable loads (`libobs`, ffmpeg's `libavdevice` x11grab, the
+  /// GStreamer PipeWire plugin), not just by name.
+  ///
+  /// Catches renamed or wrapped capture tools whose process name does not
+  /// match. Each executable is classified once, by reading
+  /// `/proc/<pid>/maps` of the first process running it; later processes
+  /// cost one `stat` of `/proc/<pid>/exe`. Only the user's own processes can
+  /// be inspected. Applies to [LinuxProcessSource.processTable]. Defaults to
+  /// `false`.
+  final bool matchLibraries;
+
+  /// The longest a single main-loop dispatch may spend walking `/proc`.
+  ///
+  /// When non-zero, each poll walks the process table in slices of at most
+  /// this duration and yields to the UI between slices, so a scan never
+  /// blocks a frame. The result is reported once the whole walk completes.
+  /// Defaults to [Duration.zero], which walks `/proc` in one go.
+  final Duration scanSliceBudget;
+
+  /// The number of threads that walk `/proc` in parallel.
+  ///
+  /// Each poll lists `/proc` once and splits the PIDs into one contiguous
+  /// range per thread; all threads stop as soon as any of them finds a match.
+  /// Worth raising on hosts with tens of thousands of processes. Ignored when
+  /// [scanSliceBudget] is non-zero. Defaults to 1.
+  final int scanThreads;
+
+  /// How often display connectors are polled, overriding
+  /// `startListening`'s `pollingInterval` for this probe.
+  ///
+  /// Reading connector status is cheap, so a short interval picks up newly
+  /// plugged displays quickly without paying for a `/proc` walk each time.
+  /// Defaults to `null`, the polling interval.
+  final Duration? connectorPollingInterval;
+
+  /// How often the process table (or app scopes) is scanned for screen
+  /// sharing apps, overriding `startListening`'s `pollingInterval` for this
+  /// probe.
+  ///
+  /// Probes with different intervals run on separate timers; when both come
+  /// due together their results are reported as a single change. Defaults to
+  /// `null`, the polling interval.
+  final Duration? processPollingInterval;
+
+  /// Whether `startListening` waits for the first scan before completing.
+  ///
+  /// By default the first scan runs on the main loop right after
+  /// `startListening` returns, so app startup never waits on a `/proc` walk,
+  /// and its result arrives as the first snapshot. Set this when the first
+  /// snapshot must already be detected by the time the future completes.
+  /// Defaults to `false`.
+  final bool awaitFirstScan;
+
+  /// Whether polling trades latency for fewer CPU wakeups, for battery
+  /// powered devices.
+  ///
+  /// Probe deadlines and the rate-limited stream timer are rounded up to the
+  /// whole-second grid GLib's `g_timeout_add_seconds` shares across the
+  /// desktop session, so both probes and other apps' timers fire on the same
+  /// wakeup. Changes can arrive up to a second later. The
+  /// `no_screen_mirror_wakeups_per_hour` metric shows the effect. Defaults to
+  /// `false`.
+  final bool lowPower;
+
+  /// Name of a POSIX shared memory segment (e.g. `/no_screen_mirror`) the
+  /// detector also publishes its state, sequence number and detection time
+  /// to while listening.
+  ///
+  /// Other local processes can then read the state lock-free, without
+  /// scanning `/proc` themselves, using the C reader in
+  /// `linux/include/no_screen_mirror/no_screen_mirror_state.h`. The segment
+  /// is readable by every local user and removed when listening stops.
+  /// Defaults to `null`, no export.
+  final String? stateExportName;
+
+  /// Path of a unix socket serving Prometheus text-format metrics while
+  /// listening: scan duration histograms, probe errors, events delivered and
+  /// coalesced, the current state and the process table size.
+  ///
+  /// Each connection receives one exposition, as an HTTP response when the
+  /// client sends a request (`curl --unix-socket`). Rendering happens on a
+  /// background thread. Defaults to `null`, no socket.
+  final String? metricsSocketPath;
+
+  /// Path of a node-exporter textfile (ending in `.prom`) that the same
+  /// metrics as [metricsSocketPath] are written to every 10 seconds while
+  /// listening, and removed from when listening stops. Defaults to `null`,
+  /// no textfile.
+  final String? metricsTextfilePath;
+
+  /// Path of a file every state transition is appended to while listening,
+  /// for post-mortem analysis after a crash or reboot.
+  ///
+  /// The journal is a fixed-size ring of [journalCapacity] binary records
+  /// (wall-clock time, sequence number, state and cause), written through a
+  /// memory mapping without a syscall per event. It survives the process,
+  /// keeps its records across runs and is dumped with the `nsm-journal` tool.
+  /// Defaults to `null`, no journal.
+  final String? journalPath;
+
+  /// Transitions the journal at [journalPath] keeps before overwriting the
+  /// oldest, at 32 bytes each. Changing it starts a new journal. Defaults to
+  /// `4096`.
+  final int journalCapacity;
+
+  /// Path of a file every connector status and process name read is
+  /// recorded to while listening, as a compact delta-encoded trace.
+  ///
+  /// A trace captured on a real machine replays through the detector with
+  /// the `nsm-replay` tool, deterministically and much faster than real
+  /// time, to reproduce a field report or benchmark a change against the
+  /// same input. Defaults to `null`, no trace.
+  final String? probeTracePath;
+
+  /// Whether apps on the same desktop session share a single detector over
+  /// D-Bus instead of each scanning `/sys` and `/proc`.
+  ///
+  /// The first app to start listening claims the session bus name
+  /// `com.flutterplaza.NoScreenMirror`, scans with its own settings and
+  /// broadcasts every change. Later apps subscribe to it and only scan if
+  /// the owner exits, in which case the next one in line takes over. Falls
+  /// back to scanning locally when there is no session bus. Defaults to
+  /// `false`.
+  final bool shareDetector;
+
+  /// Reads the process table from this directory instead of `/proc`.
+  ///
+  /// For tests and benchmarks that inject fake processes into a fixture laid
+  /// out like `/proc` (`<pid>/comm`). Defaults to `null`, the real `/proc`.
+  final String? procRoot;
+
+  /// Reads display connectors from this directory instead of
+  /// `/sys/class/drm`.
+  ///
+  /// For tests and benchmarks that flip a fake connector's `status` file
+  /// (`card0-HDMI-A-1/status`). Defaults to `null`, the real sysfs.
+  final String? drmRoot;
+
+  /// Creates [LinuxScanOptions] with the given values.
+  const LinuxScanOptions({
+    this.processSource = LinuxProcessSource.processTable,
+    this.processScope = LinuxProcessScope.all,
+    this.requireCaptureEvidence = false,
+    this.captureFdBudget = 256,
+    this.matchLibraries = false,
+    this.scanSliceBudget = Duration.zero,
+    this.scanThreads = 1,
+    this.connectorPollingInterval,
+    this.processPollingInterval,
+    this.awaitFirstScan = false,
+    this.lowPower = false,
+    this.stateExportName,
+    this.metricsSocketPath,
+    this.metricsTextfilePath,
+    this.journalPath,
+    this.journalCapacity = 4096,
+    this.probeTracePath,
+    this.shareDetector = false,
+    this.procRoot,
+    this.drmRoot,
+  });
+
+  /// Converts these options to a map suitable for platform channel
+  /// serialization.
+  Map<String, dynamic> toMap() {
+    return {
+      'processSource': processSource.name,
+      if (processScope != LinuxProcessScope.all)
+        'processScope': processScope.name,
+      'requireCaptureEvidence': requireCaptureEvidence,
+      'captureFdBudget': captureFdBudget,
+      if (matchLibraries) 'matchLibraries': matchLibraries,
+      'scanSliceBudgetUs': scanSliceBudget.inMicroseconds,
+      'scanThreads': scanThreads,
+      if (connectorPollingInterval != null)
+        'connectorPollingIntervalMs': connectorPollingInterval!.inMilliseconds,
+      if (processPollingInterval != null)
+        'processPollingIntervalMs': processPollingInterval!.inMilliseconds,
+      if (awaitFirstScan) 'awaitFirstScan': awaitFirstScan,
+      if (lowPower) 'lowPower': lowPower,
+      if (stateExportName != null) 'stateExportName': stateExportName,
+      if (metricsSocketPath != null) 'metricsSocketPath': metricsSocketPath,
+      if (metricsTextfilePath != null)
+        'metricsTextfilePath': metricsTextfilePath,
+      if (journalPath != null) ...{
+        'journalPath': journalPath,
+        'journalCapacity': journalCapacity,
+      },
+      if (probeTracePath != null) 'probeTracePath': probeTracePath,
+      if (shareDetector) 'shareDetector': shareDetector,
+      if (procRoot != null) 'procRoot': procRoot,
+      if (drmRoot != null) 'drmRoot': drmRoot,
+    };
+  }
+
+  @override
+  String toString() {
+    return 'LinuxScanOptions('
+        'processSource: $processSource, '
+        'processScope: $processScope, '
+        'requireCaptureEvidence: $requireCaptureEvidence, '
+        'captureFdBudget: $captureFdBudget, '
+        'matchLibraries: $matchLibraries, '
+        'scanSliceBudget: $scanSliceBudget, '
+        'scanThreads: $scanThreads, '
+        'connectorPollingInterval: $connectorPollingInterval, '
+        'processPollingInterval: $processPollingInterval, '
+        'awaitFirstScan: $awaitFirstScan, '
+        'lowPower: $lowPower, '
+        'stateExportName: $stateExportName, '
+        'metricsSocketPath: $metricsSocketPath, '
+        'metricsTextfilePath: $metricsTextfilePath, '
+        'journalPath: $journalPath, '
+        'journalCapacity: $journalCapacity, '
+        'probeTracePath: $probeTracePath, '
+        'shareDetector: $shareDetector, '
+        'procRoot: $procRoot, '
+        'drmRoot: $drmRoot'
+        ')';
+  }
+
+  @override
+  bool operator ==(Object other) {
+    if (identical(this, other)) return true;
+    return other is LinuxScanOptions &&
+        other.processSource == processSource &&
+        other.processScope == processScope &&
+        other.requireCaptureEvidence == requireCaptureEvidence &&
+        other.captureFdBudget == captureFdBudget &&
+        other.matchLibraries == matchLibraries &&
+        other.scanSliceBudget == scanSliceBudget &&
+        other.scanThreads == scanThreads &&
+        other.connectorPollingInterval == connectorPollingInterval &&
+        other.processPollingInterval == processPollingInterval &&
+        other.awaitFirstScan == awaitFirstScan &&
+        other.lowPower == lowPower &&
+        other.stateExportName == stateExportName &&
+        other.metricsSocketPath == metricsSocketPath &&
+        other.metricsTextfilePath == metricsTextfilePath &&
+        other.journalPath == journalPath &&
+        other.journalCapacity == journalCapacity &&
+        other.probeTracePath == probeTracePath &&
+        other.shareDetector == shareDetector &&
+        other.procRoot == procRoot &&
+        other.drmRoot == drmRoot;
+  }
+
+  @override
+  int get hashCode {
+    return processSource.hashCode ^
+        processScope.hashCode ^
+        requireCaptureEvidence.hashCode ^
+        captureFdBudget.hashCode ^
+        matchLibraries.hashCode ^
+        scanSliceBudget.hashCode ^
+        scanThreads.hashCode ^
+        connectorPollingInterval.hashCode ^
+        processPollingInterval.hashCode ^
+        awaitFirstScan.hashCode ^
+        lowPower.hashCode ^
+        stateExportName.hashCode ^
+        metricsSocketPath.hashCode ^
+        metricsTextfilePath.hashCode ^
+        journalPath.hashCode ^
+        journalCapacity.hashCode ^
+        probeTracePath.hashCode ^
+        shareDetector.hashCode ^
+        procRoot.hashCode ^
+        drmRoot.hashCode;
+  }
+}
@@ -0,0 +1,18 @@
+/// A field of [MirrorSnapshot] an app can subscribe to.
+///
+/// Passed to [NoScreenMirror.startListening] as `fields` so the native side
+/// only runs the probes behind the fields the app reads. Fields that are not
+/// subscribed keep their last observed value in every snapshot.
+enum MirrorField {
+  /// [MirrorSnapshot.isScreenMirrored].
+  screenMirrored,
+
+  /// [MirrorSnapshot.isExternalDisplayConnected].
+  externalDisplayConnected,
+
+  /// [MirrorSnapshot.displayCount].
+  displayCount,
+
+  /// [MirrorSnapshot.isScreenShared].
+  screenShared,
+}
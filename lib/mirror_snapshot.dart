@@ -14,18 +14,66 @@ class MirrorSnapshot {
   /// Whether the screen is being shared in a video call or recording.
   final bool isScreenShared;
 
+  /// Position of this event in the plugin's event stream, starting at 1.
+  ///
+  /// States that were replaced by a newer one before delivery are skipped, so
+  /// a gap between consecutive snapshots shows how many changes were missed.
+  /// `null` on platforms that don't stamp events (Linux and Windows do).
+  final int? sequence;
+
+  /// When the native detector reported this state, in microseconds on the
+  /// monotonic clock read by `Timeline.now` from `dart:developer`.
+  ///
+  /// `null` on platforms that don't stamp events.
+  final int? detectedAtUs;
+
+  /// When the native side handed this event to the event channel, on the same
+  /// clock as [detectedAtUs].
+  ///
+  /// Comparing it with `Timeline.now` on arrival gives the delivery latency.
+  final int? enqueuedAtUs;
+
+  /// Whether this state was restored from an earlier run instead of detected.
+  ///
+  /// On Linux, the first snapshot after startup repeats the last state
+  /// committed during the current boot (or the default state if there is
+  /// none), so the app isn't told nothing is mirrored while the first scan
+  /// runs. The next snapshot confirms or replaces it, even if it is
+  /// unchanged. Its [detectedAtUs] is when the state was originally detected.
+  final bool isProvisional;
+
+  /// How many changes since the previous snapshot were replaced by this one
+  /// before they could be delivered, e.g. while `maxEventsPerSecond` held
+  /// events back.
+  ///
+  /// 0 when nothing was coalesced, and on platforms that don't report it.
+  final int coalescedCount;
+
   /// Creates a [MirrorSnapshot] with the given display state values.
   MirrorSnapshot({
     required this.isScreenMirrored,
     required this.isExternalDisplayConnected,
     required this.displayCount,
     this.isScreenShared = false,
+    this.sequence,
+    this.detectedAtUs,
+    this.enqueuedAtUs,
+    this.isProvisional = false,
+    this.coalescedCount = 0,
   });
 
+  /// How long this state waited on the native side between detection and
+  /// being sent to Dart, or `null` if the event was not stamped.
+  Duration? get enqueueDelay {
+    if (detectedAtUs == null || enqueuedAtUs == null) return null;
+    return Duration(microseconds: enqueuedAtUs! - detectedAtUs!);
+  }
+
   /// Creates a [MirrorSnapshot] from a platform channel map.
   ///
   /// Missing or null values default to `false` for booleans and `1` for
-  /// [displayCount].
+  /// [displayCount]. The delivery stamps stay `null` when absent, and
+  /// [isProvisional] defaults to `false` and [coalescedCount] to 0.
   factory MirrorSnapshot.fromMap(Map<String, dynamic> map) {
     return MirrorSnapshot(
       isScreenMirrored: map['is_screen_mirrored'] as bool? ?? false,
@@ -33,6 +81,11 @@ class MirrorSnapshot {
           map['is_external_display_connected'] as bool? ?? false,
       displayCount: map['display_count'] as int? ?? 1,
       isScreenShared: map['is_screen_shared'] as bool? ?? false,
+      sequence: map['sequence'] as int?,
+      detectedAtUs: map['detected_at_us'] as int?,
+      enqueuedAtUs: map['enqueued_at_us'] as int?,
+      isProvisional: map['provisional'] as bool? ?? false,
+      coalescedCount: map['coalesced'] as int? ?? 0,
     );
   }
 
@@ -43,14 +96,27 @@ class MirrorSnapshot {
       'is_external_display_connected': isExternalDisplayConnected,
       'display_count': displayCount,
       'is_screen_shared': isScreenShared,
+      if (sequence != null) 'sequence': sequence,
+      if (detectedAtUs != null) 'detected_at_us': detectedAtUs,
+      if (enqueuedAtUs != null) 'enqueued_at_us': enqueuedAtUs,
+      if (isProvisional) 'provisional': isProvisional,
+      if (coalescedCount > 0) 'coalesced': coalescedCount,
     };
   }
 
   @override
   String toString() {
-    return 'MirrorSnapshot(\nisScreenMirrored: $isScreenMirrored, \nisExternalDisplayConnected: $isExternalDisplayConnected, \ndisplayCount: $displayCount, \nisScreenShared: $isScreenShared\n)';
+    final stamp = sequence == null
+        ? ''
+        : ', \nsequence: $sequence, \ndetectedAtUs: $detectedAtUs, \nenqueuedAtUs: $enqueuedAtUs';
+    final provisional = isProvisional ? ', \nisProvisional: true' : '';
+    final coalesced =
+        coalescedCount > 0 ? ', \ncoalescedCount: $coalescedCount' : '';
+    return 'MirrorSnapshot(\nisScreenMirrored: $isScreenMirrored, \nisExternalDisplayConnected: $isExternalDisplayConnected, \ndisplayCount: $displayCount, \nisScreenShared: $isScreenShared$stamp$provisional$coalesced\n)';
   }
 
+  /// Compares the display state only; the delivery stamps, [isProvisional]
+  /// and [coalescedCount] are ignored.
   @override
   bool operator ==(Object other) {
     if (identical(this, other)) return true;
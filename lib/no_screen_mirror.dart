@@ -1,3 +1,5 @@
+import 'package:no_screen_mirror/linux_scan_options.dart';
+import 'package:no_screen_mirror/mirror_field.dart';
 import 'package:no_screen_mirror/mirror_capabilities.dart';
 import 'package:no_screen_mirror/mirror_snapshot.dart';
 
@@ -35,10 +37,16 @@ class NoScreenMirror implements NoScreenMirrorPlatform {
   Future<void> startListening({
     Duration pollingInterval = const Duration(seconds: 2),
     List<String> customScreenSharingProcesses = const [],
+    LinuxScanOptions? linuxScanOptions,
+    Set<MirrorField>? fields,
+    int? maxEventsPerSecond,
   }) {
     return _instancePlatform.startListening(
       pollingInterval: pollingInterval,
       customScreenSharingProcesses: customScreenSharingProcesses,
+      linuxScanOptions: linuxScanOptions,
+      fields: fields,
+      maxEventsPerSecond: maxEventsPerSecond,
     );
   }
 
@@ -47,6 +55,19 @@ class NoScreenMirror implements NoScreenMirrorPlatform {
     return _instancePlatform.stopListening();
   }
 
+  @override
+  Future<void> updateConfig({
+    Duration? pollingInterval,
+    List<String>? customScreenSharingProcesses,
+    int? maxEventsPerSecond,
+  }) {
+    return _instancePlatform.updateConfig(
+      pollingInterval: pollingInterval,
+      customScreenSharingProcesses: customScreenSharingProcesses,
+      maxEventsPerSecond: maxEventsPerSecond,
+    );
+  }
+
   @override
   bool operator ==(Object other) {
     return identical(this, other) ||
@@ -3,6 +3,8 @@ import 'dart:convert';
 import 'package:flutter/foundation.dart';
 import 'package:flutter/services.dart';
 import 'package:no_screen_mirror/constants.dart';
+import 'package:no_screen_mirror/linux_scan_options.dart';
+import 'package:no_screen_mirror/mirror_field.dart';
 import 'package:no_screen_mirror/mirror_snapshot.dart';
 
 import 'no_screen_mirror_platform_interface.dart';
@@ -30,11 +32,18 @@ class MethodChannelNoScreenMirror extends NoScreenMirrorPlatform {
   Future<void> startListening({
     Duration pollingInterval = const Duration(seconds: 2),
     List<String> customScreenSharingProcesses = const [],
+    LinuxScanOptions? linuxScanOptions,
+    Set<MirrorField>? fields,
+    int? maxEventsPerSecond,
   }) {
     return methodChannel.invokeMethod<void>(startListeningConst, {
       'pollingIntervalMs': pollingInterval.inMilliseconds,
       if (customScreenSharingProcesses.isNotEmpty)
         'customProcesses': customScreenSharingProcesses,
+      if (linuxScanOptions != null)
+        'linuxScanOptions': linuxScanOptions.toMap(),
+      if (fields != null) 'fields': [for (final field in fields) field.name],
+      if (maxEventsPerSecond != null) 'maxEventsPerSecond': maxEventsPerSecond,
     });
   }
 
@@ -42,4 +51,19 @@ class MethodChannelNoScreenMirror extends NoScreenMirrorPlatform {
   Future<void> stopListening() {
     return methodChannel.invokeMethod<void>(stopListeningConst);
   }
+
+  @override
+  Future<void> updateConfig({
+    Duration? pollingInterval,
+    List<String>? customScreenSharingProcesses,
+    int? maxEventsPerSecond,
+  }) {
+    return methodChannel.invokeMethod<void>(updateConfigConst, {
+      if (pollingInterval != null)
+        'pollingIntervalMs': pollingInterval.inMilliseconds,
+      if (customScreenSharingProcesses != null)
+        'customProcesses': customScreenSharingProcesses,
+      if (maxEventsPerSecond != null) 'maxEventsPerSecond': maxEventsPerSecond,
+    });
+  }
 }
@@ -1,3 +1,5 @@
+import 'package:no_screen_mirror/linux_scan_options.dart';
+import 'package:no_screen_mirror/mirror_field.dart';
 import 'package:no_screen_mirror/mirror_snapshot.dart';
 import 'package:plugin_platform_interface/plugin_platform_interface.dart';
 
@@ -43,9 +45,29 @@ abstract class NoScreenMirrorPlatform extends PlatformInterface {
   ///
   /// [customScreenSharingProcesses] provides additional process names to
   /// detect as screen sharing apps, supplementing the built-in list.
+  ///
+  /// [linuxScanOptions] tunes how screen sharing is detected on Linux and is
+  /// ignored on other platforms.
+  ///
+  /// [fields] limits detection to the [MirrorField]s the app reads; `null`
+  /// subscribes to all of them. On Linux a probe whose fields are all
+  /// unsubscribed (the `/proc` walk behind [MirrorField.screenShared], or the
+  /// connector scan) does not run, and calling [startListening] again while
+  /// listening changes the subscription without restarting. Other platforms
+  /// detect every field.
+  ///
+  /// [maxEventsPerSecond] caps how often [mirrorStream] emits on Linux and
+  /// Windows; `null` keeps the default of one per second and `0` removes the
+  /// limit. The first change after a quiet period is sent immediately;
+  /// changes inside the interval that follows are coalesced into a single
+  /// snapshot of the latest state, whose [MirrorSnapshot.coalescedCount]
+  /// says how many it replaced. Other platforms emit every change.
   Future<void> startListening({
     Duration pollingInterval = const Duration(seconds: 2),
     List<String> customScreenSharingProcesses = const [],
+    LinuxScanOptions? linuxScanOptions,
+    Set<MirrorField>? fields,
+    int? maxEventsPerSecond,
   }) {
     throw UnimplementedError('startListening has not been implemented.');
   }
@@ -56,4 +78,21 @@ abstract class NoScreenMirrorPlatform extends PlatformInterface {
   Future<void> stopListening() {
     throw UnimplementedError('stopListening has not been implemented.');
   }
+
+  /// Changes the polling interval, custom screen sharing process names or
+  /// event rate limit while listening, without stopping detection.
+  ///
+  /// Arguments left `null` keep their current value; they mean the same as
+  /// in [startListening]. [mirrorStream] stays subscribed and misses no
+  /// change. On Linux, new process names are checked on the next main-loop
+  /// iteration, and only if they change which processes match; a new
+  /// interval applies from the last poll. Windows and macOS restart their
+  /// poll timer with a new interval. Does nothing when not listening.
+  Future<void> updateConfig({
+    Duration? pollingInterval,
+    List<String>? customScreenSharingProcesses,
+    int? maxEventsPerSecond,
+  }) {
+    throw UnimplementedError('updateConfig has not been implemented.');
+  }
 }
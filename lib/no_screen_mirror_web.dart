@@ -1,6 +1,8 @@
 import 'dart:async';
 
 import 'package:flutter_web_plugins/flutter_web_plugins.dart';
+import 'package:no_screen_mirror/linux_scan_options.dart';
+import 'package:no_screen_mirror/mirror_field.dart';
 import 'package:no_screen_mirror/mirror_snapshot.dart';
 import 'package:no_screen_mirror/no_screen_mirror_platform_interface.dart';
 import 'package:web/web.dart' as web;
@@ -31,11 +33,11 @@ class NoScreenMirrorWeb extends NoScreenMirrorPlatform {
   Future<void> startListening({
     Duration pollingInterval = const Duration(seconds: 2),
     List<String> customScreenSharingProcesses = const [],
+    LinuxScanOptions? linuxScanOptions,
+    Set<MirrorField>? fields,
+    int? maxEventsPerSecond,
   }) async {
-    _pollTimer?.cancel();
-    _pollTimer = Timer.periodic(pollingInterval, (_) {
-      _controller.add(_scan());
-    });
+    _startPollTimer(pollingInterval);
 
     // Listen for visibility changes (tab hidden/shown).
     _visibilityListener = ((web.Event event) {
@@ -47,6 +49,25 @@ class NoScreenMirrorWeb extends NoScreenMirrorPlatform {
     _controller.add(_scan());
   }
 
+  @override
+  Future<void> updateConfig({
+    Duration? pollingInterval,
+    List<String>? customScreenSharingProcesses,
+    int? maxEventsPerSecond,
+  }) async {
+    // Process names and the rate limit do not apply on the web.
+    if (_pollTimer != null && pollingInterval != null) {
+      _startPollTimer(pollingInterval);
+    }
+  }
+
+  void _startPollTimer(Duration pollingInterval) {
+    _pollTimer?.cancel();
+    _pollTimer = Timer.periodic(pollingInterval, (_) {
+      _controller.add(_scan());
+    });
+  }
+
   @override
   Future<void> stopListening() async {
     _pollTimer?.cancel();
@@ -0,0 +1,165 @@
+#include "app_scopes.h"
+
+#include <dirent.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+// Launchers group some apps one level down (app-org.gnome.Terminal.slice).
+static const gint kMaxSliceDepth = 2;
+
+static const guint32 kWatchMask = IN_CREATE | IN_DELETE | IN_ONLYDIR;
+// The kernel reports "populated" flipping as a modification of cgroup.events.
+static const guint32 kEventsWatchMask = IN_MODIFY;
+
+struct _AppScopes {
+  gchar* app_slice_path;
+  gint inotify_fd;
+  // The owner's source polling inotify_fd, and the fd's tag in it.
+  GSource* source;
+  gpointer fd_tag;
+};
+
+// Resolves <cgroupfs>/.../user@<uid>.service/app.slice from the cgroup v2 path
+// of this process, falling back to the conventional layout for our uid.
+static gchar* find_app_slice_path(void) {
+  g_autofree gchar* self_cgroup = NULL;
+  if (g_file_get_contents("/proc/self/cgroup", &self_cgroup, NULL, NULL)) {
+    g_auto(GStrv) lines = g_strsplit(self_cgroup, "\n", -1);
+    for (gint i = 0; lines[i] != NULL; i++) {
+      // The unified hierarchy is the single "0::<path>" entry.
+      if (!g_str_has_prefix(lines[i], "0::")) continue;
+      const gchar* path = lines[i] + 3;
+      const gchar* manager = strstr(path, "/user@");
+      const gchar* service =
+          manager != NULL ? strstr(manager, ".service") : NULL;
+      if (service == NULL) break;
+      gint prefix_len = (gint)(service + strlen(".service") - path);
+      gchar* slice =
+          g_strdup_printf("/sys/fs/cgroup%.*s/app.slice", prefix_len, path);
+      if (g_file_test(slice, G_FILE_TEST_IS_DIR)) return slice;
+      g_free(slice);
+      break;
+    }
+  }
+
+  guint uid = (guint)getuid();
+  gchar* slice = g_strdup_printf(
+      "/sys/fs/cgroup/user.slice/user-%u.slice/user@%u.service/app.slice", uid,
+      uid);
+  if (g_file_test(slice, G_FILE_TEST_IS_DIR)) return slice;
+  g_free(slice);
+  return NULL;
+}
+
+// Also watches the scope's cgroup.events, since a scope can outlive its last
+// process or exist before its first one joins.
+static gboolean is_populated(AppScopes* self, const gchar* scope_path) {
+  g_autofree gchar* events_path =
+      g_build_filename(scope_path, "cgroup.events", NULL);
+  if (self->inotify_fd >= 0) {
+    inotify_add_watch(self->inotify_fd, events_path, kEventsWatchMask);
+  }
+  g_autofree gchar* events = NULL;
+  // Older kernels lack cgroup.events; systemd removes empty scopes anyway.
+  if (!g_file_get_contents(events_path, &events, NULL, NULL)) return TRUE;
+  return strstr(events, "populated 1") != NULL;
+}
+
+static gboolean find_in_slice(AppScopes* self, const gchar* slice_path,
+                              gint depth, AppScopeMatchFunc match,
+                              gpointer user_data) {
+  DIR* dir = opendir(slice_path);
+  if (dir == NULL) return FALSE;
+
+  gboolean found = FALSE;
+  struct dirent* entry;
+  while (!found && (entry = readdir(dir)) != NULL) {
+    // Control files (cgroup.procs, memory.max, ...) are regular files.
+    if (entry->d_type != DT_DIR && entry->d_type != DT_UNKNOWN) continue;
+    const gchar* name = entry->d_name;
+
+    if (g_str_has_suffix(name, ".slice")) {
+      if (depth >= kMaxSliceDepth) continue;
+      g_autofree gchar* sub_slice = g_build_filename(slice_path, name, NULL);
+      if (self->inotify_fd >= 0) {
+        inotify_add_watch(self->inotify_fd, sub_slice, kWatchMask);
+      }
+      found = find_in_slice(self, sub_slice, depth + 1, match, user_data);
+      continue;
+    }
+
+    if (!g_str_has_suffix(name, ".scope") && !g_str_has_suffix(name, ".service"))
+      continue;
+    if (!match(name, user_data)) continue;
+
+    g_autofree gchar* scope_path = g_build_filename(slice_path, name, NULL);
+    found = is_populated(self, scope_path);
+  }
+  closedir(dir);
+  return found;
+}
+
+AppScopes* app_scopes_new(void) {
+  gchar* app_slice_path = find_app_slice_path();
+  if (app_slice_path == NULL) return NULL;
+
+  AppScopes* self = g_new0(AppScopes, 1);
+  self->app_slice_path = app_slice_path;
+  self->inotify_fd = -1;
+  self->source = NULL;
+  self->fd_tag = NULL;
+  return self;
+}
+
+gboolean app_scopes_find(AppScopes* self, AppScopeMatchFunc match,
+                         gpointer user_data) {
+  if (self == NULL || match == NULL) return FALSE;
+  return find_in_slice(self, self->app_slice_path, 0, match, user_data);
+}
+
+gboolean app_scopes_attach(AppScopes* self, GSource* source) {
+  if (self == NULL) return FALSE;
+  if (self->inotify_fd >= 0) return TRUE;
+
+  gint fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0) return FALSE;
+  if (inotify_add_watch(fd, self->app_slice_path, kWatchMask) < 0) {
+    close(fd);
+    return FALSE;
+  }
+
+  self->inotify_fd = fd;
+  self->source = g_source_ref(source);
+  self->fd_tag = g_source_add_unix_fd(source, fd, G_IO_IN);
+  return TRUE;
+}
+
+gboolean app_scopes_dispatch(AppScopes* self) {
+  if (self == NULL || self->fd_tag == NULL) return FALSE;
+  if ((g_source_query_unix_fd(self->source, self->fd_tag) & G_IO_IN) == 0) {
+    return FALSE;
+  }
+
+  // Only the fact that the tree changed matters, not the individual events.
+  gchar buffer[4096]
+      __attribute__((aligned(__alignof__(struct inotify_event))));
+  while (read(self->inotify_fd, buffer, sizeof(buffer)) > 0) {
+  }
+  return TRUE;
+}
+
+void app_scopes_free(AppScopes* self) {
+  if (self == NULL) return;
+  if (self->source != NULL) {
+    g_source_remove_unix_fd(self->source, self->fd_tag);
+    g_source_unref(self->source);
+    self->source = NULL;
+  }
+  if (self->inotify_fd >= 0) {
+    close(self->inotify_fd);
+    self->inotify_fd = -1;
+  }
+  g_free(self->app_slice_path);
+  g_free(self);
+}
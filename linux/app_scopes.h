@@ -0,0 +1,39 @@
+#ifndef APP_SCOPES_H_
+#define APP_SCOPES_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// The current user's systemd app scopes (cgroup v2). Desktop launchers,
+// Flatpak and snapd start each application in its own scope under
+// user@<uid>.service/app.slice, e.g. app-flatpak-us.zoom.Zoom-1234.scope.
+typedef struct _AppScopes AppScopes;
+
+typedef gboolean (*AppScopeMatchFunc)(const gchar* scope_name,
+                                      gpointer user_data);
+
+// Returns NULL when no app.slice is found for the current user (cgroup v1
+// hosts, sessions without a systemd user manager).
+AppScopes* app_scopes_new(void);
+
+// Returns TRUE if a populated scope whose name satisfies |match| exists.
+gboolean app_scopes_find(AppScopes* scopes, AppScopeMatchFunc match,
+                         gpointer user_data);
+
+// Adds an inotify fd reporting created and removed scopes, and scopes that
+// app_scopes_find() matched becoming populated or empty, to |source|, which
+// must call app_scopes_dispatch() whenever it dispatches. Returns FALSE if
+// inotify is unavailable, in which case callers must poll. Free |scopes|
+// before destroying |source|.
+gboolean app_scopes_attach(AppScopes* scopes, GSource* source);
+
+// Drains pending notifications. Returns TRUE if a scope was created or
+// removed, or a matched one changed, since the last call.
+gboolean app_scopes_dispatch(AppScopes* scopes);
+
+void app_scopes_free(AppScopes* scopes);
+
+G_END_DECLS
+
+#endif  // APP_SCOPES_H_
@@ -0,0 +1,186 @@
+#include "batched_reads.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+// Slots in the registered buffer pool and fixed-file table. Each path costs
+// three SQEs (openat, read, close).
+#define MAX_BATCH BATCHED_READS_MAX_BATCH
+#define SLOT_SIZE (BATCHED_READS_MAX_LENGTH + 1)
+
+#ifdef HAVE_LIBURING
+enum { OP_OPEN = 0, OP_READ = 1, OP_CLOSE = 2 };
+#endif
+
+struct _BatchedReads {
+#ifdef HAVE_LIBURING
+  gboolean ring_ready;
+  struct io_uring ring;
+#endif
+  gchar* buffers;  // MAX_BATCH slots of SLOT_SIZE bytes
+  guint64 syscalls;
+};
+
+static gchar* slot_buffer(BatchedReads* self, guint slot) {
+  return self->buffers + (gsize)slot * SLOT_SIZE;
+}
+
+#ifdef HAVE_LIBURING
+
+static gboolean setup_ring(BatchedReads* self) {
+  if (io_uring_queue_init(MAX_BATCH * 4, &self->ring, 0) < 0) return FALSE;
+
+  struct iovec pool = {self->buffers, (size_t)MAX_BATCH * SLOT_SIZE};
+  if (io_uring_register_buffers(&self->ring, &pool, 1) < 0 ||
+      io_uring_register_files_sparse(&self->ring, MAX_BATCH) < 0) {
+    // Kernels before 5.19 (sparse direct descriptors), or RLIMIT_MEMLOCK.
+    io_uring_queue_exit(&self->ring);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+static void teardown_ring(BatchedReads* self) {
+  if (!self->ring_ready) return;
+  io_uring_queue_exit(&self->ring);
+  self->ring_ready = FALSE;
+}
+
+// Submits openat -> read -> close for each path as one linked chain per path,
+// using the direct descriptor and buffer slot matching its index. Returns
+// FALSE if the ring failed; the caller then falls back to plain reads.
+static gboolean run_ring_batch(BatchedReads* self, const gchar* const* paths,
+                               guint count, gssize* lengths) {
+  for (guint i = 0; i < count; i++) {
+    lengths[i] = -1;
+
+    struct io_uring_sqe* sqe = io_uring_get_sqe(&self->ring);
+    io_uring_prep_openat_direct(sqe, AT_FDCWD, paths[i], O_RDONLY | O_CLOEXEC,
+                                0, i);
+    sqe->flags |= IOSQE_IO_LINK;
+    sqe->user_data = ((guint64)OP_OPEN << 32) | i;
+
+    // A short read fails a soft link, so the close hangs off a hard link.
+    sqe = io_uring_get_sqe(&self->ring);
+    io_uring_prep_read_fixed(sqe, i, slot_buffer(self, i),
+                             BATCHED_READS_MAX_LENGTH, 0, 0);
+    sqe->flags |= IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+    sqe->user_data = ((guint64)OP_READ << 32) | i;
+
+    sqe = io_uring_get_sqe(&self->ring);
+    io_uring_prep_close_direct(sqe, i);
+    sqe->user_data = ((guint64)OP_CLOSE << 32) | i;
+  }
+
+  gint ret;
+  do {
+    ret = io_uring_submit_and_wait(&self->ring, count * 3);
+    self->syscalls++;
+  } while (ret == -EINTR);
+  if (ret < 0) {
+    teardown_ring(self);
+    return FALSE;
+  }
+
+  guint reaped = 0;
+  while (reaped < count * 3) {
+    struct io_uring_cqe* cqe = NULL;
+    if (io_uring_peek_cqe(&self->ring, &cqe) != 0) {
+      if (io_uring_wait_cqe(&self->ring, &cqe) < 0) {
+        teardown_ring(self);
+        return FALSE;
+      }
+      self->syscalls++;
+    }
+    guint op = (guint)(cqe->user_data >> 32);
+    guint slot = (guint)(cqe->user_data & 0xffffffff);
+    if (op == OP_READ && slot < count) lengths[slot] = cqe->res;
+    io_uring_cqe_seen(&self->ring, cqe);
+    reaped++;
+  }
+  return TRUE;
+}
+
+#endif  // HAVE_LIBURING
+
+static gssize read_file(BatchedReads* self, const gchar* path, gchar* buffer) {
+  gint fd = open(path, O_RDONLY | O_CLOEXEC);
+  self->syscalls++;
+  if (fd < 0) return -1;
+  gssize length = read(fd, buffer, BATCHED_READS_MAX_LENGTH);
+  close(fd);
+  self->syscalls += 2;
+  return length;
+}
+
+BatchedReads* batched_reads_new(gboolean use_io_uring) {
+  BatchedReads* self = g_new0(BatchedReads, 1);
+  // Page-aligned so registering the pool pins as few pages as possible.
+  self->buffers = (gchar*)aligned_alloc(4096, (size_t)MAX_BATCH * SLOT_SIZE);
+  if (self->buffers == NULL) {
+    self->buffers = (gchar*)malloc((size_t)MAX_BATCH * SLOT_SIZE);
+  }
+  self->syscalls = 0;
+#ifdef HAVE_LIBURING
+  self->ring_ready = use_io_uring && setup_ring(self);
+#endif
+  return self;
+}
+
+gboolean batched_reads_uses_io_uring(BatchedReads* self) {
+#ifdef HAVE_LIBURING
+  return self != NULL && self->ring_ready;
+#else
+  return FALSE;
+#endif
+}
+
+guint batched_reads_batch_size(BatchedReads* self) {
+  return batched_reads_uses_io_uring(self) ? MAX_BATCH : 1;
+}
+
+void batched_reads_run(BatchedReads* self, const gchar* const* paths,
+                       guint count, BatchedReadFunc func, gpointer user_data) {
+  if (self == NULL || func == NULL) return;
+
+  for (guint offset = 0; offset < count; offset += MAX_BATCH) {
+    guint batch = MIN(MAX_BATCH, count - offset);
+    gssize lengths[MAX_BATCH];
+    gboolean batched = FALSE;
+#ifdef HAVE_LIBURING
+    batched =
+        self->ring_ready && run_ring_batch(self, paths + offset, batch, lengths);
+#endif
+
+    for (guint i = 0; i < batch; i++) {
+      gchar* buffer = slot_buffer(self, batched ? i : 0);
+      gssize length =
+          batched ? lengths[i] : read_file(self, paths[offset + i], buffer);
+      if (length < 0) {
+        func(offset + i, NULL, user_data);
+        continue;
+      }
+      buffer[length] = '\0';
+      func(offset + i, buffer, user_data);
+    }
+  }
+}
+
+guint64 batched_reads_get_syscall_count(BatchedReads* self) {
+  return self != NULL ? self->syscalls : 0;
+}
+
+void batched_reads_free(BatchedReads* self) {
+  if (self == NULL) return;
+#ifdef HAVE_LIBURING
+  teardown_ring(self);
+#endif
+  free(self->buffers);
+  g_free(self);
+}
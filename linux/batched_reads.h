@@ -0,0 +1,43 @@
+#ifndef BATCHED_READS_H_
+#define BATCHED_READS_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// Reads batches of small attribute files (/proc/<pid>/comm, connector status).
+//
+// When built with liburing (NO_SCREEN_MIRROR_USE_IO_URING) and the kernel
+// allows it, each batch is a single io_uring submission of linked
+// openat+read+close requests into a registered buffer pool. Otherwise, or if
+// the ring fails at runtime, files are read with plain open/read/close.
+typedef struct _BatchedReads BatchedReads;
+
+// Called once per path, in order. |contents| is NUL-terminated and truncated
+// to BATCHED_READS_MAX_LENGTH bytes, or NULL if the file could not be read.
+typedef void (*BatchedReadFunc)(guint index, const gchar* contents,
+                                gpointer user_data);
+
+#define BATCHED_READS_MAX_LENGTH 255
+
+// Upper bound of batched_reads_batch_size().
+#define BATCHED_READS_MAX_BATCH 64
+
+BatchedReads* batched_reads_new(gboolean use_io_uring);
+
+gboolean batched_reads_uses_io_uring(BatchedReads* reads);
+
+// How many paths are worth gathering before calling batched_reads_run().
+guint batched_reads_batch_size(BatchedReads* reads);
+
+void batched_reads_run(BatchedReads* reads, const gchar* const* paths,
+                       guint count, BatchedReadFunc func, gpointer user_data);
+
+// Syscalls issued so far by batched_reads_run(), for benchmarking.
+guint64 batched_reads_get_syscall_count(BatchedReads* reads);
+
+void batched_reads_free(BatchedReads* reads);
+
+G_END_DECLS
+
+#endif  // BATCHED_READS_H_
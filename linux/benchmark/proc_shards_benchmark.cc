@@ -0,0 +1,54 @@
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "proc_shards.h"
+
+// Measures how a full walk of a /proc-like directory scales with the number of
+// shard threads. Nothing matches, so every shard reads its whole range.
+//
+// $ no_screen_mirror_proc_shards_benchmark [proc_root] [max_threads] [passes]
+
+namespace {
+
+gboolean match_nothing(guint pid, const gchar* comm, gpointer user_data) {
+  return FALSE;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const gchar* proc_root = argc > 1 ? argv[1] : "/proc";
+  guint max_threads =
+      argc > 2 ? (guint)strtoul(argv[2], nullptr, 10) : g_get_num_processors();
+  guint passes = argc > 3 ? (guint)strtoul(argv[3], nullptr, 10) : 20;
+  if (max_threads == 0) max_threads = 1;
+  if (passes == 0) passes = 1;
+
+  printf("%-8s %8s %12s %10s %8s\n", "threads", "procs", "mean_us", "best_us",
+         "speedup");
+  gdouble baseline_us = 0;
+  for (guint threads = 1; threads <= max_threads; threads++) {
+    ProcShards* shards = proc_shards_new(proc_root, threads);
+    // Warm the dentry cache and start the pool's threads.
+    proc_shards_scan(shards, match_nothing, nullptr, TRUE, nullptr);
+
+    guint examined = 0;
+    gint64 total_us = 0;
+    gint64 best_us = G_MAXINT64;
+    for (guint i = 0; i < passes; i++) {
+      gint64 start_us = g_get_monotonic_time();
+      examined = proc_shards_scan(shards, match_nothing, nullptr, TRUE, nullptr);
+      gint64 elapsed_us = g_get_monotonic_time() - start_us;
+      total_us += elapsed_us;
+      best_us = MIN(best_us, elapsed_us);
+    }
+    proc_shards_free(shards);
+
+    gdouble mean_us = (gdouble)total_us / passes;
+    if (threads == 1) baseline_us = mean_us;
+    printf("%-8u %8u %12.1f %10" G_GINT64_FORMAT " %7.2fx\n", threads,
+           examined, mean_us, best_us, baseline_us / mean_us);
+  }
+  return 0;
+}
@@ -0,0 +1,227 @@
+#include "capture_fds.h"
+
+#include <dirent.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct {
+  guint pid;
+  guint64 starttime;
+  // Last fd inspected in the current pass; -1 at the start of a pass.
+  gint cursor;
+  // Outcome of the last complete pass.
+  gboolean verdict;
+  gboolean seen;
+} Candidate;
+
+struct _CaptureFds {
+  gchar* proc_root;
+  guint fd_budget;
+  GHashTable* candidates;  // pid -> Candidate* (owned)
+  GPtrArray* order;        // Candidate* in round-robin order (borrowed)
+  guint next_index;
+  GHashTable* loopback_devices;  // "videoN" -> GINT_TO_POINTER(is_loopback)
+};
+
+// Reads field 22 of /proc/<pid>/stat, which together with the pid identifies a
+// process across pid reuse.
+static gboolean read_starttime(CaptureFds* self, guint pid,
+                               guint64* out_starttime) {
+  g_autofree gchar* stat_path =
+      g_strdup_printf("%s/%u/stat", self->proc_root, pid);
+  g_autofree gchar* stat = NULL;
+  if (!g_file_get_contents(stat_path, &stat, NULL, NULL)) return FALSE;
+
+  // comm may contain spaces and parentheses; fields resume after the last ')'.
+  const gchar* p = strrchr(stat, ')');
+  if (p == NULL) return FALSE;
+  for (gint field = 3; field <= 22; field++) {
+    p = strchr(p + 1, ' ');
+    if (p == NULL) return FALSE;
+  }
+  *out_starttime = g_ascii_strtoull(p + 1, NULL, 10);
+  return TRUE;
+}
+
+// v4l2loopback devices have no parent bus device and sit under
+// /sys/devices/virtual, unlike real cameras.
+static gboolean is_video_loopback(CaptureFds* self, const gchar* device_name) {
+  gpointer cached = NULL;
+  if (g_hash_table_lookup_extended(self->loopback_devices, device_name, NULL,
+                                   &cached)) {
+    return GPOINTER_TO_INT(cached);
+  }
+
+  g_autofree gchar* class_path =
+      g_strdup_printf("/sys/class/video4linux/%s", device_name);
+  char* resolved = realpath(class_path, NULL);
+  gboolean loopback =
+      resolved != NULL && strstr(resolved, "/devices/virtual/") != NULL;
+  free(resolved);
+
+  g_hash_table_insert(self->loopback_devices, g_strdup(device_name),
+                      GINT_TO_POINTER(loopback));
+  return loopback;
+}
+
+static gboolean is_capture_target(CaptureFds* self, const gchar* target) {
+  // PipeWire clients receive stream buffers as memfd pools or dma-bufs.
+  if (g_str_has_prefix(target, "/memfd:pipewire-memfd") ||
+      g_str_has_prefix(target, "/dmabuf:") ||
+      g_strcmp0(target, "anon_inode:dmabuf") == 0) {
+    return TRUE;
+  }
+  if (g_str_has_prefix(target, "/dev/dri/renderD")) return TRUE;
+  if (g_str_has_prefix(target, "/dev/video")) {
+    return is_video_loopback(self, target + strlen("/dev/"));
+  }
+  return FALSE;
+}
+
+// Walks |candidate|'s fd table from its cursor, spending |budget|. Returns
+// FALSE if the budget ran out before the pass completed.
+static gboolean inspect_candidate(CaptureFds* self, Candidate* candidate,
+                                  guint* budget) {
+  g_autofree gchar* fd_dir_path =
+      g_strdup_printf("%s/%u/fd", self->proc_root, candidate->pid);
+
+  DIR* fd_dir = opendir(fd_dir_path);
+  if (fd_dir == NULL) {
+    // Exited, or owned by another user.
+    candidate->verdict = FALSE;
+    candidate->cursor = -1;
+    return TRUE;
+  }
+
+  gboolean found = FALSE;
+  gboolean complete = TRUE;
+  struct dirent* entry;
+  // procfs lists descriptors in ascending order, so the cursor is the fd
+  // number itself.
+  while ((entry = readdir(fd_dir)) != NULL) {
+    if (entry->d_name[0] < '0' || entry->d_name[0] > '9') continue;
+    gint fd = atoi(entry->d_name);
+    if (fd <= candidate->cursor) continue;
+    if (*budget == 0) {
+      complete = FALSE;
+      break;
+    }
+    (*budget)--;
+    candidate->cursor = fd;
+
+    gchar link_path[PATH_MAX];
+    g_snprintf(link_path, sizeof(link_path), "%s/%s", fd_dir_path,
+               entry->d_name);
+    gchar target[PATH_MAX];
+    ssize_t len = readlink(link_path, target, sizeof(target) - 1);
+    if (len <= 0) continue;
+    target[len] = '\0';
+
+    if (is_capture_target(self, target)) {
+      found = TRUE;
+      break;
+    }
+  }
+  closedir(fd_dir);
+
+  if (!found && !complete) return FALSE;
+  candidate->verdict = found;
+  candidate->cursor = -1;
+  return TRUE;
+}
+
+CaptureFds* capture_fds_new(const gchar* proc_root, guint fd_budget) {
+  CaptureFds* self = g_new0(CaptureFds, 1);
+  self->proc_root = g_strdup(proc_root);
+  self->fd_budget = fd_budget;
+  self->candidates =
+      g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+  self->order = g_ptr_array_new();
+  self->next_index = 0;
+  self->loopback_devices =
+      g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+  return self;
+}
+
+void capture_fds_begin_tick(CaptureFds* self) {
+  if (self == NULL) return;
+  for (guint i = 0; i < self->order->len; i++) {
+    Candidate* candidate = (Candidate*)g_ptr_array_index(self->order, i);
+    candidate->seen = FALSE;
+  }
+}
+
+void capture_fds_add_candidate(CaptureFds* self, guint pid) {
+  if (self == NULL) return;
+
+  guint64 starttime = 0;
+  if (!read_starttime(self, pid, &starttime)) return;
+
+  Candidate* candidate = (Candidate*)g_hash_table_lookup(
+      self->candidates, GUINT_TO_POINTER(pid));
+  if (candidate == NULL) {
+    candidate = g_new0(Candidate, 1);
+    candidate->pid = pid;
+    candidate->starttime = starttime;
+    candidate->cursor = -1;
+    candidate->verdict = FALSE;
+    g_hash_table_insert(self->candidates, GUINT_TO_POINTER(pid), candidate);
+    g_ptr_array_add(self->order, candidate);
+  } else if (candidate->starttime != starttime) {
+    // The pid was reused by a different process.
+    candidate->starttime = starttime;
+    candidate->cursor = -1;
+    candidate->verdict = FALSE;
+  }
+  candidate->seen = TRUE;
+}
+
+gboolean capture_fds_end_tick(CaptureFds* self) {
+  if (self == NULL) return FALSE;
+
+  for (guint i = 0; i < self->order->len;) {
+    Candidate* candidate = (Candidate*)g_ptr_array_index(self->order, i);
+    if (candidate->seen) {
+      i++;
+      continue;
+    }
+    g_ptr_array_remove_index(self->order, i);
+    g_hash_table_remove(self->candidates, GUINT_TO_POINTER(candidate->pid));
+  }
+
+  guint count = self->order->len;
+  if (count == 0) {
+    self->next_index = 0;
+    return FALSE;
+  }
+
+  guint budget = self->fd_budget;
+  guint start = self->next_index % count;
+  for (guint step = 0; step < count && budget > 0; step++) {
+    guint i = (start + step) % count;
+    Candidate* candidate = (Candidate*)g_ptr_array_index(self->order, i);
+    if (!inspect_candidate(self, candidate, &budget)) {
+      // Resume this candidate first on the next tick.
+      self->next_index = i;
+      break;
+    }
+    self->next_index = (i + 1) % count;
+  }
+
+  for (guint i = 0; i < count; i++) {
+    Candidate* candidate = (Candidate*)g_ptr_array_index(self->order, i);
+    if (candidate->verdict) return TRUE;
+  }
+  return FALSE;
+}
+
+void capture_fds_free(CaptureFds* self) {
+  if (self == NULL) return;
+  g_ptr_array_unref(self->order);
+  g_hash_table_destroy(self->candidates);
+  g_hash_table_destroy(self->loopback_devices);
+  g_free(self->proc_root);
+  g_free(self);
+}
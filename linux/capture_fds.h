@@ -0,0 +1,38 @@
+#ifndef CAPTURE_FDS_H_
+#define CAPTURE_FDS_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// Confirms that name-matched processes are actually capturing by looking at
+// the files they hold open in /proc/<pid>/fd:
+//   - PipeWire buffers (pipewire memfd pools, dma-buf frames),
+//   - a /dev/dri render node,
+//   - a /dev/video* v4l2loopback device (virtual cameras fed by a capture).
+//
+// Walking fd tables is expensive, so each tick inspects at most |fd_budget|
+// descriptors, round-robin across candidates, resuming where the previous
+// tick stopped. Verdicts are cached per (pid, starttime) and refreshed by
+// every complete pass over a candidate's fd table.
+typedef struct _CaptureFds CaptureFds;
+
+// |proc_root| is normally "/proc".
+CaptureFds* capture_fds_new(const gchar* proc_root, guint fd_budget);
+
+// Call once per scan, before adding that scan's candidates. A tick that was
+// never ended is discarded.
+void capture_fds_begin_tick(CaptureFds* capture_fds);
+
+void capture_fds_add_candidate(CaptureFds* capture_fds, guint pid);
+
+// Spends this tick's budget and forgets candidates that were not added since
+// capture_fds_begin_tick(). Returns TRUE if any candidate's latest verdict is
+// that it is capturing.
+gboolean capture_fds_end_tick(CaptureFds* capture_fds);
+
+void capture_fds_free(CaptureFds* capture_fds);
+
+G_END_DECLS
+
+#endif  // CAPTURE_FDS_H_
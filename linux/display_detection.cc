@@ -2,18 +2,150 @@
 
 #include <dirent.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "app_scopes.h"
+#include "batched_reads.h"
+#include "capture_fds.h"
+#include "exe_signatures.h"
+#include "detection_state.h"
+#include "proc_scope.h"
+#include "proc_shards.h"
+#include "sharer_exits.h"
+#include "process_matcher.h"
+
+using no_screen_mirror::DetectionState;
+using no_screen_mirror::ProcessMatcher;
+using no_screen_mirror::StateTracker;
 
 struct _DisplayDetection {
   DisplayChangeCallback callback;
   gpointer user_data;
-  guint poll_timer_id;
-  gboolean last_external_connected;
-  gint last_display_count;
-  gboolean last_screen_shared;
+  // The one main-loop source behind every fd the detector waits on (inotify,
+  // pidfds) and its next probe deadline; see detector_source_dispatch().
+  // Non-NULL from display_detection_start() to display_detection_stop().
+  GSource* source;
+  // Per-probe intervals; 0 follows display_detection_start()'s.
+  guint poll_interval_ms;
+  guint connector_interval_ms;
+  guint process_interval_ms;
+  // Monotonic times the probes are next due, once polling.
+  gboolean polling;
+  gint64 next_connector_us;
+  gint64 next_process_us;
+  // Low-power mode rounds deadlines up to the session's whole-second grid
+  // (see align_to_session_second()); wakeup_offset_us is the grid's offset.
+  gboolean low_power;
+  gint64 wakeup_offset_us;
+
+  // First scan after display_detection_start(). When not awaited it runs
+  // from the source's first dispatch (first_scan_due), and
+  // first_scan_pending stays set until a sliced pass delivers it; polling
+  // starts once it is reported.
+  gboolean await_first_scan;
+  gboolean first_scan_due;
+  gboolean first_scan_pending;
+  StateTracker* tracker;
+  // Copy of the custom names for scope matching; comm names go through
+  // matcher.
   gchar** custom_processes;
+  ProcessMatcher* matcher;
+
+  // Reads comm and connector status files, batched through io_uring when
+  // available.
+  BatchedReads* reads;
+
+  // Screen-sharing lookup. app_scopes stays NULL while scanning /proc.
+  DisplayDetectionProcessSource process_source;
+  AppScopes* app_scopes;
+  gboolean app_scopes_watched;
+  gboolean app_scopes_dirty;
+  gboolean app_scopes_shared;
+
+  // fd inspection of name-matched processes; NULL when a name match suffices.
+  guint capture_fd_budget;
+  CaptureFds* capture_fds;
+
+  // Mapped-library classification of processes whose comm does not match;
+  // NULL unless enabled.
+  gboolean library_signatures;
+  ExeSignatures* exe_signatures;
+
+  // Connector directory, /sys/class/drm outside of tests.
+  gchar* drm_root;
+
+  // Process table walk. With a slice budget, a process probe only starts a
+  // pass and idle dispatches continue it, each bounded by the budget; the
+  // result is committed once the pass completes.
+  gchar* proc_root;
+  guint scan_slice_budget_us;
+  guint scan_slice_id;
+  DIR* scan_dir;
+  // scan_found ends the pass; scan_matched records a match of a pass that
+  // keeps going to watch every sharer.
+  gboolean scan_found;
+  gboolean scan_matched;
+  // Processes examined and time spent so far in the current pass, summed
+  // over its slices.
+  guint scan_process_count;
+  gint64 scan_busy_us;
+  // Measured cost of one entry, in nanoseconds, so a sliced pass gathers
+  // only as many entries as fit before its deadline. 0 until measured.
+  gint64 scan_entry_ns;
+
+  // Latest result of each probe. Probes write here and commits report it, so
+  // probes finishing at different times merge into one state; unsubscribed
+  // fields keep their last value.
+  gboolean observed_external_connected;
+  gint observed_display_count;
+  gboolean observed_screen_shared;
+
+  // Exit watches on the processes found sharing; NULL with capture evidence,
+  // app scopes or a fixture proc_root. While every sharer is watched, only
+  // one process probe in kWatchedWalkEvery walks /proc.
+  SharerExits* sharer_exits;
+  guint walks_skipped;
+
+  // Parallel walk used for unsliced passes; NULL with a single thread.
+  guint scan_threads;
+  ProcShards* proc_shards;
+
+  // Owner and session filter applied to both walks; NULL reads everything.
+  DisplayDetectionProcessScope process_scope;
+  ProcScope* proc_scope;
+
+  // Subscribed DisplayDetectionField mask; probes outside it are skipped.
+  guint fields;
+
+  // Not owned; NULL unless metrics are exported.
+  MetricsExport* metrics;
+  // Not owned; NULL unless probe reads are recorded.
+  ProbeTraceWriter* probe_trace;
 };
 
+typedef struct {
+  GSource source;
+  DisplayDetection* detection;
+} DetectorSource;
+
+// While a known sharer is alive a walk can only discover additional sharers,
+// which does not change the state.
+static const guint kWatchedWalkEvery = 10;
+
+static gboolean connectors_subscribed(DisplayDetection* self) {
+  return (self->fields & (DISPLAY_DETECTION_FIELD_EXTERNAL_DISPLAY |
+                          DISPLAY_DETECTION_FIELD_DISPLAY_COUNT)) != 0;
+}
+
+static gboolean processes_subscribed(DisplayDetection* self) {
+  return (self->fields & DISPLAY_DETECTION_FIELD_SCREEN_SHARED) != 0;
+}
+
 static gboolean is_builtin_connector(const gchar* name) {
   return (g_str_has_prefix(name, "eDP") || g_str_has_prefix(name, "LVDS") ||
           g_str_has_prefix(name, "DSI"));
@@ -26,19 +158,56 @@ static gboolean is_display_connector(const gchar* name) {
           g_str_has_prefix(name, "DSI"));
 }
 
-static void scan_connectors(gboolean* out_external_connected,
-                             gint* out_display_count) {
-  gboolean external_connected = FALSE;
-  gint display_count = 0;
+typedef struct {
+  GPtrArray* entry_names;
+  GPtrArray* connector_names;
+  gboolean external_connected;
+  gint display_count;
+  ProbeTraceWriter* trace;
+} ConnectorScan;
+
+static void on_connector_status_read(guint index, const gchar* contents,
+                                     gpointer user_data) {
+  ConnectorScan* scan = (ConnectorScan*)user_data;
+  if (contents == NULL) return;
 
+  gchar status[BATCHED_READS_MAX_LENGTH + 1];
+  g_strlcpy(status, contents, sizeof(status));
+  g_strstrip(status);
+  probe_trace_writer_add(
+      scan->trace, PROBE_TRACE_CONNECTORS,
+      (const gchar*)g_ptr_array_index(scan->entry_names, index), status);
+  if (g_strcmp0(status, "connected") == 0) {
+    scan->display_count++;
+    const gchar* connector_name =
+        (const gchar*)g_ptr_array_index(scan->connector_names, index);
+    if (!is_builtin_connector(connector_name)) {
+      scan->external_connected = TRUE;
+    }
+  }
+}
+
+// Returns FALSE, reporting the internal display only, if the connector
+// directory cannot be read.
+static gboolean scan_connectors(DisplayDetection* self,
+                                gboolean* out_external_connected,
+                                gint* out_display_count) {
+  probe_trace_writer_begin_tick(self->probe_trace, PROBE_TRACE_CONNECTORS,
+                                g_get_monotonic_time());
   // Scan /sys/class/drm/ for card*-* connector directories
-  DIR* drm_dir = opendir("/sys/class/drm");
+  DIR* drm_dir = opendir(self->drm_root);
   if (drm_dir == NULL) {
+    probe_trace_writer_end_tick(self->probe_trace, PROBE_TRACE_CONNECTORS);
     *out_external_connected = FALSE;
     *out_display_count = 1;
-    return;
+    return FALSE;
   }
 
+  g_autoptr(GPtrArray) status_paths = g_ptr_array_new_with_free_func(g_free);
+  ConnectorScan scan = {g_ptr_array_new_with_free_func(g_free),
+                        g_ptr_array_new_with_free_func(g_free), FALSE, 0,
+                        self->probe_trace};
+
   struct dirent* entry;
   while ((entry = readdir(drm_dir)) != NULL) {
     // Only look at card*-ConnectorName entries (e.g. card0-HDMI-A-1)
@@ -49,29 +218,27 @@ static void scan_connectors(gboolean* out_external_connected,
 
     if (!is_display_connector(connector_name)) continue;
 
-    // Read the status file
-    g_autofree gchar* status_path = g_strdup_printf(
-        "/sys/class/drm/%s/status", entry->d_name);
-
-    g_autofree gchar* status_content = NULL;
-    if (!g_file_get_contents(status_path, &status_content, NULL, NULL))
-      continue;
-
-    g_strstrip(status_content);
-    if (g_strcmp0(status_content, "connected") == 0) {
-      display_count++;
-      if (!is_builtin_connector(connector_name)) {
-        external_connected = TRUE;
-      }
-    }
+    g_ptr_array_add(status_paths, g_strdup_printf("%s/%s/status",
+                                                  self->drm_root,
+                                                  entry->d_name));
+    g_ptr_array_add(scan.entry_names, g_strdup(entry->d_name));
+    g_ptr_array_add(scan.connector_names, g_strdup(connector_name));
   }
   closedir(drm_dir);
 
+  // Read every status file in one batch
+  batched_reads_run(self->reads, (const gchar* const*)status_paths->pdata,
+                    status_paths->len, on_connector_status_read, &scan);
+  g_ptr_array_unref(scan.entry_names);
+  g_ptr_array_unref(scan.connector_names);
+  probe_trace_writer_end_tick(self->probe_trace, PROBE_TRACE_CONNECTORS);
+
   // Ensure at least 1 display
-  if (display_count == 0) display_count = 1;
+  if (scan.display_count == 0) scan.display_count = 1;
 
-  *out_external_connected = external_connected;
-  *out_display_count = display_count;
+  *out_external_connected = scan.external_connected;
+  *out_display_count = scan.display_count;
+  return TRUE;
 }
 
 static const gchar* default_screen_sharing_process_names[] = {
@@ -80,89 +247,688 @@ static const gchar* default_screen_sharing_process_names[] = {
     "kazam",   "peek",   "recordmydesktop", "vokoscreen",
     NULL};
 
-static gboolean is_screen_sharing_active(DisplayDetection* self) {
-  DIR* proc_dir = opendir("/proc");
-  if (proc_dir == NULL) return FALSE;
+// Flatpak app IDs that don't contain one of the process names above.
+static const gchar* default_screen_sharing_app_ids[] = {
+    "com.obsproject.Studio", "com.github.vkohaupt.vokoscreenNG", NULL};
 
-  struct dirent* entry;
-  while ((entry = readdir(proc_dir)) != NULL) {
-    // Only look at numeric PID directories
-    if (entry->d_name[0] < '0' || entry->d_name[0] > '9') continue;
+static gboolean is_scope_name_delimiter(gchar c) {
+  return c == '\0' || c == '-' || c == '.' || c == '@' || c == '_';
+}
 
-    g_autofree gchar* comm_path =
-        g_strdup_printf("/proc/%s/comm", entry->d_name);
-    g_autofree gchar* comm_content = NULL;
-    if (!g_file_get_contents(comm_path, &comm_content, NULL, NULL)) continue;
+// Matches |rule| as a whole delimited component of a scope name, so "zoom"
+// matches app-flatpak-us.zoom.Zoom-1234.scope and
+// snap.zoom-client.zoom-client-<uuid>.scope but not app-gnome-zoomit-1.scope.
+static gboolean scope_name_matches_rule(const gchar* scope_name,
+                                        const gchar* rule) {
+  gsize rule_len = strlen(rule);
+  if (rule_len == 0) return FALSE;
 
-    g_strstrip(comm_content);
+  for (const gchar* p = scope_name; *p != '\0'; p++) {
+    if (p != scope_name && !is_scope_name_delimiter(p[-1])) continue;
+    if (g_ascii_strncasecmp(p, rule, rule_len) == 0 &&
+        is_scope_name_delimiter(p[rule_len])) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
 
-    // Check default processes
-    for (int i = 0; default_screen_sharing_process_names[i] != NULL; i++) {
-      if (g_strcmp0(comm_content, default_screen_sharing_process_names[i]) == 0) {
-        closedir(proc_dir);
+static gboolean scope_name_matches(const gchar* scope_name,
+                                   gpointer user_data) {
+  DisplayDetection* self = (DisplayDetection*)user_data;
+
+  for (int i = 0; default_screen_sharing_process_names[i] != NULL; i++) {
+    if (scope_name_matches_rule(scope_name,
+                                default_screen_sharing_process_names[i]))
+      return TRUE;
+  }
+  for (int i = 0; default_screen_sharing_app_ids[i] != NULL; i++) {
+    if (scope_name_matches_rule(scope_name, default_screen_sharing_app_ids[i]))
+      return TRUE;
+  }
+  if (self->custom_processes != NULL) {
+    for (int i = 0; self->custom_processes[i] != NULL; i++) {
+      if (scope_name_matches_rule(scope_name, self->custom_processes[i]))
         return TRUE;
-      }
     }
+  }
+  return FALSE;
+}
+
+static gboolean is_screen_sharing_scope_active(DisplayDetection* self) {
+  // With inotify the cached answer holds until a scope is created or removed
+  // or a matched one gains or loses its processes.
+  if (self->app_scopes_watched && !self->app_scopes_dirty) {
+    return self->app_scopes_shared;
+  }
+  self->app_scopes_shared =
+      app_scopes_find(self->app_scopes, scope_name_matches, self);
+  self->app_scopes_dirty = FALSE;
+  return self->app_scopes_shared;
+}
+
+static gboolean is_screen_sharing_process_name(DisplayDetection* self,
+                                               const gchar* comm) {
+  return self->matcher->Matches(comm);
+}
+
+// Name match first; the library check costs a stat() even when cached.
+static gboolean is_screen_sharing_process(DisplayDetection* self, guint pid,
+                                          const gchar* comm) {
+  if (is_screen_sharing_process_name(self, comm)) return TRUE;
+  return self->exe_signatures != NULL &&
+         exe_signatures_match(self->exe_signatures, pid);
+}
+
+// A pass over the process table. It can run to completion in one call or be
+// resumed across main-loop dispatches (see scan_slice_budget_us).
+static void process_scan_begin(DisplayDetection* self) {
+  probe_trace_writer_begin_tick(self->probe_trace, PROBE_TRACE_PROCESSES,
+                                g_get_monotonic_time());
+  self->scan_dir = opendir(self->proc_root);
+  self->scan_found = FALSE;
+  self->scan_matched = FALSE;
+  self->scan_process_count = 0;
+  self->scan_busy_us = 0;
+  if (self->scan_dir == NULL) {
+    metrics_export_record_error(self->metrics,
+                                METRICS_EXPORT_PROBE_PROCESSES);
+  }
+
+  // With capture evidence enabled, every name match becomes a candidate for
+  // the fd inspection stage instead of ending the walk. With exit watching,
+  // every match is watched.
+  capture_fds_begin_tick(self->capture_fds);
+  sharer_exits_begin_walk(self->sharer_exits);
+}
 
-    // Check custom processes
-    if (self->custom_processes != NULL) {
-      for (int i = 0; self->custom_processes[i] != NULL; i++) {
-        if (g_strcmp0(comm_content, self->custom_processes[i]) == 0) {
-          closedir(proc_dir);
-          return TRUE;
+typedef struct {
+  DisplayDetection* self;
+  const guint* pids;
+} CommBatch;
+
+static void record_comm(DisplayDetection* self, guint pid, const gchar* comm) {
+  if (self->probe_trace == NULL) return;
+  gchar key[16];
+  g_snprintf(key, sizeof(key), "%u", pid);
+  probe_trace_writer_add(self->probe_trace, PROBE_TRACE_PROCESSES, key, comm);
+}
+
+static void on_comm_read(guint index, const gchar* contents,
+                         gpointer user_data) {
+  CommBatch* batch = (CommBatch*)user_data;
+  DisplayDetection* self = batch->self;
+  if (contents == NULL) return;
+
+  gchar comm[BATCHED_READS_MAX_LENGTH + 1];
+  g_strlcpy(comm, contents, sizeof(comm));
+  g_strstrip(comm);
+  record_comm(self, batch->pids[index], comm);
+  if (self->scan_found) return;
+
+  if (!is_screen_sharing_process(self, batch->pids[index], comm)) return;
+
+  if (self->capture_fds != NULL) {
+    capture_fds_add_candidate(self->capture_fds, batch->pids[index]);
+  } else if (self->sharer_exits != NULL) {
+    self->scan_matched = TRUE;
+    sharer_exits_add(self->sharer_exits, batch->pids[index]);
+  } else {
+    self->scan_found = TRUE;
+  }
+}
+
+// Processes entries until the pass completes or |deadline_us| (monotonic) is
+// reached. Returns TRUE once the pass is complete.
+static gboolean process_scan_step(DisplayDetection* self, gint64 deadline_us) {
+  if (self->scan_dir == NULL) return TRUE;
+
+  guint batch_size = batched_reads_batch_size(self->reads);
+  gchar* comm_paths[BATCHED_READS_MAX_BATCH];
+  guint pids[BATCHED_READS_MAX_BATCH];
+  CommBatch batch = {self, pids};
+
+  while (!self->scan_found) {
+    gint64 batch_start_us = g_get_monotonic_time();
+    if (batch_start_us >= deadline_us) return FALSE;
+
+    // A whole io_uring batch could overrun a slice budget on its own.
+    guint limit = batch_size;
+    if (deadline_us != G_MAXINT64 && batch_size > 1) {
+      limit = self->scan_entry_ns > 0
+                  ? (guint)CLAMP((deadline_us - batch_start_us) * 1000 /
+                                     self->scan_entry_ns,
+                                 1, batch_size)
+                  : 1;
+    }
+
+    // Gather a batch of numeric PID directories
+    guint count = 0;
+    gboolean at_end = FALSE;
+    while (count < limit) {
+      struct dirent* entry = readdir(self->scan_dir);
+      if (entry == NULL) {
+        at_end = TRUE;
+        break;
+      }
+      if (entry->d_name[0] < '0' || entry->d_name[0] > '9') continue;
+      if (!proc_scope_contains(self->proc_scope, dirfd(self->scan_dir),
+                               entry->d_name)) {
+        // Out-of-scope entries read nothing but still cost an fstatat each;
+        // a long run of them must not overrun the slice.
+        if (deadline_us != G_MAXINT64 &&
+            g_get_monotonic_time() >= deadline_us) {
+          break;
         }
+        continue;
       }
+
+      pids[count] = (guint)strtoul(entry->d_name, NULL, 10);
+      comm_paths[count] =
+          g_strdup_printf("%s/%s/comm", self->proc_root, entry->d_name);
+      count++;
+    }
+
+    batched_reads_run(self->reads, (const gchar* const*)comm_paths, count,
+                      on_comm_read, &batch);
+    for (guint i = 0; i < count; i++) g_free(comm_paths[i]);
+    self->scan_process_count += count;
+    if (count > 0) {
+      self->scan_entry_ns =
+          (g_get_monotonic_time() - batch_start_us) * 1000 / count;
     }
+
+    if (at_end) return TRUE;
   }
-  closedir(proc_dir);
-  return FALSE;
+  return TRUE;
 }
 
-static gboolean poll_tick(gpointer user_data) {
+static gboolean process_scan_finish(DisplayDetection* self) {
+  if (self->scan_dir != NULL) {
+    closedir(self->scan_dir);
+    self->scan_dir = NULL;
+  }
+  metrics_export_set_process_count(self->metrics, self->scan_process_count);
+  probe_trace_writer_end_tick(self->probe_trace, PROBE_TRACE_PROCESSES);
+  if (self->capture_fds != NULL) return capture_fds_end_tick(self->capture_fds);
+  if (self->sharer_exits != NULL) {
+    sharer_exits_end_walk(self->sharer_exits);
+    return self->scan_matched;
+  }
+  return self->scan_found;
+}
+
+static gboolean comm_matches(guint pid, const gchar* comm,
+                             gpointer user_data) {
   DisplayDetection* self = (DisplayDetection*)user_data;
+  record_comm(self, pid, comm);
+  return is_screen_sharing_process(self, pid, comm);
+}
 
-  gboolean external_connected = FALSE;
-  gint display_count = 0;
-  scan_connectors(&external_connected, &display_count);
+static gboolean is_screen_sharing_process_sharded(DisplayDetection* self) {
+  // Without capture evidence or exit watching the first match settles the
+  // pass.
+  GArray* matches = g_array_new(FALSE, FALSE, sizeof(guint));
+  probe_trace_writer_begin_tick(self->probe_trace, PROBE_TRACE_PROCESSES,
+                                g_get_monotonic_time());
+  guint examined = proc_shards_scan(
+      self->proc_shards, comm_matches, self,
+      self->capture_fds == NULL && self->sharer_exits == NULL, matches);
+  probe_trace_writer_end_tick(self->probe_trace, PROBE_TRACE_PROCESSES);
+  metrics_export_set_process_count(self->metrics, examined);
 
-  gboolean screen_shared = is_screen_sharing_active(self);
+  gboolean found = matches->len > 0;
+  if (self->capture_fds != NULL) {
+    capture_fds_begin_tick(self->capture_fds);
+    for (guint i = 0; i < matches->len; i++) {
+      capture_fds_add_candidate(self->capture_fds,
+                                g_array_index(matches, guint, i));
+    }
+    found = capture_fds_end_tick(self->capture_fds);
+  } else if (self->sharer_exits != NULL) {
+    sharer_exits_begin_walk(self->sharer_exits);
+    for (guint i = 0; i < matches->len; i++) {
+      sharer_exits_add(self->sharer_exits, g_array_index(matches, guint, i));
+    }
+    sharer_exits_end_walk(self->sharer_exits);
+  }
+  g_array_unref(matches);
+  return found;
+}
 
-  if (external_connected != self->last_external_connected ||
-      display_count != self->last_display_count ||
-      screen_shared != self->last_screen_shared) {
-    self->last_external_connected = external_connected;
-    self->last_display_count = display_count;
-    self->last_screen_shared = screen_shared;
+static gboolean find_screen_sharing(DisplayDetection* self) {
+  if (self->app_scopes != NULL) return is_screen_sharing_scope_active(self);
+  if (self->proc_shards != NULL) return is_screen_sharing_process_sharded(self);
 
-    if (self->callback != NULL) {
-      self->callback(external_connected, display_count, screen_shared,
-                     self->user_data);
-    }
+  process_scan_begin(self);
+  process_scan_step(self, G_MAXINT64);
+  return process_scan_finish(self);
+}
+
+// Runs an unsliced process probe and records how long it took.
+static gboolean is_screen_sharing_active(DisplayDetection* self) {
+  gint64 started_us = g_get_monotonic_time();
+  gboolean active = find_screen_sharing(self);
+  metrics_export_record_scan(self->metrics, METRICS_EXPORT_PROBE_PROCESSES,
+                             g_get_monotonic_time() - started_us);
+  return active;
+}
+
+static void commit_state(DisplayDetection* self) {
+  DetectionState state;
+  state.is_external_display_connected = self->observed_external_connected;
+  state.display_count = self->observed_display_count;
+  state.is_screen_shared = self->observed_screen_shared;
+  if (!self->tracker->Update(state)) return;
+
+  if (self->callback != NULL) {
+    self->callback(state.is_external_display_connected, state.display_count,
+                   state.is_screen_shared, self->user_data);
+  }
+}
+
+// Drops an in-flight sliced pass without committing it.
+static void abandon_process_scan(DisplayDetection* self) {
+  if (self->scan_slice_id != 0) {
+    g_source_remove(self->scan_slice_id);
+    self->scan_slice_id = 0;
+    // The capture fd tick and exit watching walk are simply begun again by
+    // the next pass; the trace has to be told not to keep a partial table.
+    probe_trace_writer_abort_tick(self->probe_trace, PROBE_TRACE_PROCESSES);
+  }
+  if (self->scan_dir != NULL) {
+    closedir(self->scan_dir);
+    self->scan_dir = NULL;
+  }
+}
+
+static void finish_first_scan(DisplayDetection* self);
+
+// Runs one slice of a time-sliced pass. Commits and returns TRUE once the pass
+// is complete.
+static gboolean run_scan_slice(DisplayDetection* self, gint64 deadline_us) {
+  gint64 started_us = g_get_monotonic_time();
+  gboolean complete = process_scan_step(self, deadline_us);
+  self->scan_busy_us += g_get_monotonic_time() - started_us;
+  if (!complete) return FALSE;
+  // The pass's own cost; the time it spent yielding to the main loop is not
+  // counted.
+  metrics_export_record_scan(self->metrics, METRICS_EXPORT_PROBE_PROCESSES,
+                             self->scan_busy_us);
+  self->observed_screen_shared = process_scan_finish(self);
+  if (self->first_scan_pending) {
+    finish_first_scan(self);
+  } else {
+    commit_state(self);
+  }
+  return TRUE;
+}
+
+static gboolean on_scan_slice(gpointer user_data) {
+  DisplayDetection* self = (DisplayDetection*)user_data;
+  gint64 deadline_us = g_get_monotonic_time() + self->scan_slice_budget_us;
+  if (!run_scan_slice(self, deadline_us)) return G_SOURCE_CONTINUE;
+  self->scan_slice_id = 0;
+  return G_SOURCE_REMOVE;
+}
+
+static void probe_connectors(DisplayDetection* self) {
+  if (!connectors_subscribed(self)) return;
+  gint64 started_us = g_get_monotonic_time();
+  if (!scan_connectors(self, &self->observed_external_connected,
+                       &self->observed_display_count)) {
+    metrics_export_record_error(self->metrics,
+                                METRICS_EXPORT_PROBE_CONNECTORS);
+  }
+  metrics_export_record_scan(self->metrics, METRICS_EXPORT_PROBE_CONNECTORS,
+                             g_get_monotonic_time() - started_us);
+}
+
+// A sliced pass only starts here and commits from its last slice.
+static void probe_processes(DisplayDetection* self) {
+  if (!processes_subscribed(self)) return;
+
+  // Every sharer is watched, so an exit is reported without a walk.
+  if (sharer_exits_is_complete(self->sharer_exits) &&
+      ++self->walks_skipped < kWatchedWalkEvery) {
+    return;
+  }
+  self->walks_skipped = 0;
+
+  if (self->scan_slice_budget_us == 0 || self->app_scopes != NULL) {
+    self->observed_screen_shared = is_screen_sharing_active(self);
+    return;
+  }
+
+  // The previous pass is still being sliced; it commits before a new one
+  // starts.
+  if (self->scan_slice_id != 0) return;
+
+  gint64 deadline_us = g_get_monotonic_time() + self->scan_slice_budget_us;
+  process_scan_begin(self);
+  if (!run_scan_slice(self, deadline_us)) {
+    // Yield to the main loop between slices; idle priority keeps frames and
+    // input ahead of the scan.
+    self->scan_slice_id = g_idle_add(on_scan_slice, self);
+  }
+}
+
+static guint connector_interval(DisplayDetection* self) {
+  return self->connector_interval_ms > 0 ? self->connector_interval_ms
+                                         : self->poll_interval_ms;
+}
+
+static guint process_interval(DisplayDetection* self) {
+  return self->process_interval_ms > 0 ? self->process_interval_ms
+                                       : self->poll_interval_ms;
+}
+
+// The same per-session offset g_timeout_add_seconds() derives, so aligned
+// deadlines land on the instants every GLib second-granularity timer in the
+// session already wakes at.
+static gint64 session_wakeup_offset_us() {
+  const gchar* session = g_getenv("DBUS_SESSION_BUS_ADDRESS");
+  if (session == NULL) session = g_getenv("HOSTNAME");
+  if (session == NULL) return 0;
+  return ABS((gint)g_str_hash(session)) % G_USEC_PER_SEC;
+}
+
+// Rounds |time_us| up to the next instant of the session's second grid.
+static gint64 align_to_session_second(DisplayDetection* self, gint64 time_us) {
+  gint64 remainder = (time_us - self->wakeup_offset_us) % G_USEC_PER_SEC;
+  return remainder == 0 ? time_us : time_us + G_USEC_PER_SEC - remainder;
+}
+
+// When a probe run at |now_us| is next due, |interval_ms| later, delayed to
+// the grid in low-power mode so both probes and other apps' timers share
+// wakeups.
+static gint64 next_deadline(DisplayDetection* self, gint64 now_us,
+                            guint interval_ms) {
+  gint64 deadline_us = now_us + (gint64)interval_ms * 1000;
+  return self->low_power ? align_to_session_second(self, deadline_us)
+                         : deadline_us;
+}
+
+// Arms the source for whatever is due next: the first scan right away, then
+// the earlier of the two probes.
+static void update_deadline(DisplayDetection* self) {
+  gint64 ready_time = -1;
+  if (self->first_scan_due) {
+    ready_time = 0;
+  } else if (self->polling) {
+    ready_time = MIN(self->next_connector_us, self->next_process_us);
+  }
+  g_source_set_ready_time(self->source, ready_time);
+}
+
+static void start_polling(DisplayDetection* self) {
+  gint64 now_us = g_get_monotonic_time();
+  self->polling = TRUE;
+  self->next_connector_us =
+      next_deadline(self, now_us, connector_interval(self));
+  self->next_process_us = next_deadline(self, now_us, process_interval(self));
+  update_deadline(self);
+}
+
+// Reports the first scan's result, changed or not, and starts polling.
+static void finish_first_scan(DisplayDetection* self) {
+  self->first_scan_pending = FALSE;
+  DetectionState state;
+  state.is_external_display_connected = self->observed_external_connected;
+  state.display_count = self->observed_display_count;
+  state.is_screen_shared = self->observed_screen_shared;
+  self->tracker->Reset(state);
+  if (self->callback != NULL) {
+    self->callback(state.is_external_display_connected, state.display_count,
+                   state.is_screen_shared, self->user_data);
+  }
+  start_polling(self);
+}
+
+static void run_first_scan(DisplayDetection* self) {
+  self->first_scan_due = FALSE;
+  probe_connectors(self);
+  probe_processes(self);
+  // A sliced pass still in flight finishes the scan from its last slice.
+  if (self->first_scan_pending && self->scan_slice_id == 0) {
+    finish_first_scan(self);
+  }
+}
+
+// Handles everything that is ready in one go: drains every readable fd,
+// runs every probe that is due, then commits once. However many fds and
+// deadlines fire together, they cost one wakeup and report one change.
+static gboolean detector_source_dispatch(GSource* source, GSourceFunc callback,
+                                         gpointer user_data) {
+  DisplayDetection* self = ((DetectorSource*)source)->detection;
+  metrics_export_record_wakeup(self->metrics);
+
+  gboolean scopes_changed = app_scopes_dispatch(self->app_scopes);
+  if (scopes_changed) self->app_scopes_dirty = TRUE;
+  if (sharer_exits_dispatch(self->sharer_exits)) {
+    self->observed_screen_shared = FALSE;
+    self->walks_skipped = 0;
   }
 
+  // Before the first scan is reported, it picks changes up itself.
+  if (self->first_scan_due) {
+    run_first_scan(self);
+    if (!self->polling) update_deadline(self);
+    return G_SOURCE_CONTINUE;
+  }
+  if (!self->polling) return G_SOURCE_CONTINUE;
+
+  gint64 now_us = g_get_monotonic_time();
+  if (now_us >= self->next_connector_us) {
+    probe_connectors(self);
+    self->next_connector_us =
+        next_deadline(self, now_us, connector_interval(self));
+  }
+  if (now_us >= self->next_process_us) {
+    probe_processes(self);
+    self->next_process_us = next_deadline(self, now_us, process_interval(self));
+  } else if (scopes_changed && processes_subscribed(self)) {
+    probe_processes(self);
+  }
+  commit_state(self);
+  update_deadline(self);
   return G_SOURCE_CONTINUE;
 }
 
+static GSourceFuncs detector_source_funcs = {
+    NULL,  // prepare: fds and the ready time say when to dispatch
+    NULL,  // check
+    detector_source_dispatch,
+    NULL,  // finalize
+};
+
 DisplayDetection* display_detection_new(DisplayChangeCallback callback,
                                         gpointer user_data) {
   DisplayDetection* self = g_new0(DisplayDetection, 1);
   self->callback = callback;
   self->user_data = user_data;
-  self->poll_timer_id = 0;
-  self->last_external_connected = FALSE;
-  self->last_display_count = 1;
-  self->last_screen_shared = FALSE;
+  self->source = NULL;
+  self->poll_interval_ms = 2000;
+  self->connector_interval_ms = 0;
+  self->process_interval_ms = 0;
+  self->polling = FALSE;
+  self->next_connector_us = 0;
+  self->next_process_us = 0;
+  self->low_power = FALSE;
+  self->wakeup_offset_us = 0;
+  self->await_first_scan = TRUE;
+  self->first_scan_due = FALSE;
+  self->first_scan_pending = FALSE;
+  self->tracker = new StateTracker();
   self->custom_processes = NULL;
+  self->matcher = new ProcessMatcher(
+      std::vector<std::string>(
+          default_screen_sharing_process_names,
+          default_screen_sharing_process_names +
+              G_N_ELEMENTS(default_screen_sharing_process_names) - 1),
+      ProcessMatcher::CaseSensitivity::kSensitive);
+  self->reads = batched_reads_new(TRUE);
+  self->process_source = DISPLAY_DETECTION_PROCESS_SOURCE_PROC;
+  self->app_scopes = NULL;
+  self->app_scopes_watched = FALSE;
+  self->app_scopes_dirty = TRUE;
+  self->app_scopes_shared = FALSE;
+  self->capture_fd_budget = 0;
+  self->library_signatures = FALSE;
+  self->exe_signatures = NULL;
+  self->sharer_exits = NULL;
+  self->walks_skipped = 0;
+  self->capture_fds = NULL;
+  self->proc_root = g_strdup("/proc");
+  self->drm_root = g_strdup("/sys/class/drm");
+  self->scan_slice_budget_us = 0;
+  self->scan_slice_id = 0;
+  self->scan_dir = NULL;
+  self->scan_found = FALSE;
+  self->scan_process_count = 0;
+  self->scan_busy_us = 0;
+  self->observed_external_connected = FALSE;
+  self->observed_display_count = 1;
+  self->observed_screen_shared = FALSE;
+  self->scan_threads = 1;
+  self->proc_shards = NULL;
+  self->process_scope = DISPLAY_DETECTION_PROCESS_SCOPE_ALL;
+  self->proc_scope = NULL;
+  self->fields = DISPLAY_DETECTION_FIELDS_ALL;
+  self->metrics = NULL;
+  self->probe_trace = NULL;
   return self;
 }
 
-void display_detection_start(DisplayDetection* self,
-                             guint poll_interval_ms,
-                             const gchar* const* custom_processes) {
+void display_detection_set_process_source(
+    DisplayDetection* self,
+    DisplayDetectionProcessSource process_source) {
+  if (self == NULL) return;
+  self->process_source = process_source;
+}
+
+DisplayDetectionProcessScope display_detection_process_scope_from_name(
+    const gchar* name) {
+  if (g_strcmp0(name, "user") == 0) return DISPLAY_DETECTION_PROCESS_SCOPE_USER;
+  if (g_strcmp0(name, "session") == 0) {
+    return DISPLAY_DETECTION_PROCESS_SCOPE_SESSION;
+  }
+  return DISPLAY_DETECTION_PROCESS_SCOPE_ALL;
+}
+
+void display_detection_set_process_scope(
+    DisplayDetection* self,
+    DisplayDetectionProcessScope process_scope) {
   if (self == NULL) return;
-  if (self->poll_timer_id != 0) return;
+  self->process_scope = process_scope;
+}
+
+void display_detection_set_capture_fd_budget(DisplayDetection* self,
+                                             guint fd_budget) {
+  if (self == NULL) return;
+  self->capture_fd_budget = fd_budget;
+}
 
-  // Store custom processes
+void display_detection_set_library_signatures(DisplayDetection* self,
+                                              gboolean enabled) {
+  if (self == NULL) return;
+  self->library_signatures = enabled;
+}
+
+void display_detection_set_scan_slice_budget(DisplayDetection* self,
+                                             guint budget_us) {
+  if (self == NULL) return;
+  self->scan_slice_budget_us = budget_us;
+}
+
+void display_detection_set_scan_threads(DisplayDetection* self,
+                                       guint thread_count) {
+  if (self == NULL) return;
+  self->scan_threads = MAX(thread_count, 1);
+}
+
+void display_detection_set_probe_intervals(DisplayDetection* self,
+                                           guint connector_interval_ms,
+                                           guint process_interval_ms) {
+  if (self == NULL) return;
+  self->connector_interval_ms = connector_interval_ms;
+  self->process_interval_ms = process_interval_ms;
+}
+
+void display_detection_set_low_power(DisplayDetection* self,
+                                     gboolean low_power) {
+  if (self == NULL) return;
+  self->low_power = low_power;
+  self->wakeup_offset_us = low_power ? session_wakeup_offset_us() : 0;
+}
+
+void display_detection_set_await_first_scan(DisplayDetection* self,
+                                            gboolean await_first_scan) {
+  if (self == NULL) return;
+  self->await_first_scan = await_first_scan;
+}
+
+void display_detection_set_proc_root(DisplayDetection* self,
+                                     const gchar* proc_root) {
+  if (self == NULL) return;
+  g_free(self->proc_root);
+  self->proc_root = g_strdup(proc_root != NULL ? proc_root : "/proc");
+}
+
+void display_detection_set_drm_root(DisplayDetection* self,
+                                    const gchar* drm_root) {
+  if (self == NULL) return;
+  g_free(self->drm_root);
+  self->drm_root = g_strdup(drm_root != NULL ? drm_root : "/sys/class/drm");
+}
+
+void display_detection_set_metrics(DisplayDetection* self,
+                                   MetricsExport* metrics_export) {
+  if (self == NULL) return;
+  self->metrics = metrics_export;
+}
+
+void display_detection_set_probe_trace(DisplayDetection* self,
+                                       ProbeTraceWriter* writer) {
+  if (self == NULL) return;
+  self->probe_trace = writer;
+  if (writer != NULL) {
+    sharer_exits_free(self->sharer_exits);
+    self->sharer_exits = NULL;
+  }
+}
+
+guint display_detection_field_from_name(const gchar* name) {
+  if (g_strcmp0(name, "externalDisplayConnected") == 0) {
+    return DISPLAY_DETECTION_FIELD_EXTERNAL_DISPLAY;
+  }
+  if (g_strcmp0(name, "displayCount") == 0) {
+    return DISPLAY_DETECTION_FIELD_DISPLAY_COUNT;
+  }
+  if (g_strcmp0(name, "screenShared") == 0) {
+    return DISPLAY_DETECTION_FIELD_SCREEN_SHARED;
+  }
+  return 0;
+}
+
+void display_detection_set_fields(DisplayDetection* self, guint fields) {
+  if (self == NULL) return;
+  fields &= DISPLAY_DETECTION_FIELDS_ALL;
+  guint added = fields & ~self->fields;
+  self->fields = fields;
+  if (!self->polling) return;
+
+  if (!processes_subscribed(self)) abandon_process_scan(self);
+  if (self->app_scopes != NULL) self->app_scopes_dirty = TRUE;
+  // Bring newly subscribed fields up to date now rather than a full poll
+  // interval later, running only the probe that produces them.
+  if (added != 0) display_detection_poll(self, added);
+}
+
+// Stores |custom_processes| and rebuilds the matcher from them. Returns
+// whether that changed which names match.
+static gboolean set_custom_processes(DisplayDetection* self,
+                                     const gchar* const* custom_processes) {
   g_strfreev(self->custom_processes);
   self->custom_processes = NULL;
   if (custom_processes != NULL) {
@@ -173,25 +939,171 @@ void display_detection_start(DisplayDetection* self,
       self->custom_processes[i] = g_strdup(custom_processes[i]);
     }
   }
+  return self->matcher->SetCustomNames(
+      self->custom_processes != NULL
+          ? std::vector<std::string>(
+                self->custom_processes,
+                self->custom_processes + g_strv_length(self->custom_processes))
+          : std::vector<std::string>());
+}
 
-  // Initial scan
-  scan_connectors(&self->last_external_connected, &self->last_display_count);
-  self->last_screen_shared = is_screen_sharing_active(self);
-  if (self->callback != NULL) {
-    self->callback(self->last_external_connected, self->last_display_count,
-                   self->last_screen_shared, self->user_data);
+// Moves a deadline set for |old_interval_ms| to where |new_interval_ms|
+// would have put it, i.e. the same time after the last run, or now if that
+// has already passed.
+static gint64 reschedule_deadline(DisplayDetection* self, gint64 deadline_us,
+                                  guint old_interval_ms,
+                                  guint new_interval_ms) {
+  if (old_interval_ms == new_interval_ms) return deadline_us;
+  gint64 now_us = g_get_monotonic_time();
+  deadline_us +=
+      ((gint64)new_interval_ms - (gint64)old_interval_ms) * 1000;
+  if (deadline_us <= now_us) return now_us;
+  return self->low_power ? align_to_session_second(self, deadline_us)
+                         : deadline_us;
+}
+
+void display_detection_update_config(DisplayDetection* self,
+                                     guint poll_interval_ms,
+                                     const gchar* const* custom_processes) {
+  if (self == NULL) return;
+  guint old_connector_interval = connector_interval(self);
+  guint old_process_interval = process_interval(self);
+  if (poll_interval_ms > 0) self->poll_interval_ms = poll_interval_ms;
+  gboolean rules_changed = set_custom_processes(self, custom_processes);
+  if (self->source == NULL) return;
+
+  gboolean rescan = FALSE;
+  if (rules_changed && processes_subscribed(self)) {
+    // Every process is judged again, including watched sharers the new rules
+    // may no longer match.
+    if (self->app_scopes != NULL) self->app_scopes_dirty = TRUE;
+    self->walks_skipped = kWatchedWalkEvery - 1;
+    if (self->scan_slice_id != 0) {
+      // Half a pass under each set of rules would be neither; start over.
+      abandon_process_scan(self);
+      process_scan_begin(self);
+      self->scan_slice_id = g_idle_add(on_scan_slice, self);
+    } else {
+      rescan = self->polling;
+    }
   }
+  if (!self->polling) return;
 
-  // Configurable poll timer
-  if (poll_interval_ms == 0) poll_interval_ms = 2000;
-  self->poll_timer_id = g_timeout_add(poll_interval_ms, poll_tick, self);
+  self->next_connector_us =
+      reschedule_deadline(self, self->next_connector_us,
+                          old_connector_interval, connector_interval(self));
+  self->next_process_us =
+      rescan ? g_get_monotonic_time()
+             : reschedule_deadline(self, self->next_process_us,
+                                   old_process_interval,
+                                   process_interval(self));
+  update_deadline(self);
+}
+
+void display_detection_poll(DisplayDetection* self, guint fields) {
+  if (self == NULL || !self->polling) return;
+  if ((fields & (DISPLAY_DETECTION_FIELD_EXTERNAL_DISPLAY |
+                 DISPLAY_DETECTION_FIELD_DISPLAY_COUNT)) != 0) {
+    probe_connectors(self);
+  }
+  if ((fields & DISPLAY_DETECTION_FIELD_SCREEN_SHARED) != 0) {
+    probe_processes(self);
+  }
+  commit_state(self);
+}
+
+void display_detection_start(DisplayDetection* self,
+                             guint poll_interval_ms,
+                             const gchar* const* custom_processes) {
+  if (self == NULL) return;
+  if (self->source != NULL) return;
+
+  self->source =
+      g_source_new(&detector_source_funcs, sizeof(DetectorSource));
+  ((DetectorSource*)self->source)->detection = self;
+  g_source_set_name(self->source, "DisplayDetection");
+  g_source_attach(self->source, NULL);
+
+  set_custom_processes(self, custom_processes);
+
+  if (self->process_source == DISPLAY_DETECTION_PROCESS_SOURCE_APP_SCOPES) {
+    // NULL without a cgroup v2 user session; /proc scanning is used instead.
+    self->app_scopes = app_scopes_new();
+    self->app_scopes_watched =
+        app_scopes_attach(self->app_scopes, self->source);
+    self->app_scopes_dirty = TRUE;
+  }
+  if (self->capture_fd_budget > 0) {
+    self->capture_fds =
+        capture_fds_new(self->proc_root, self->capture_fd_budget);
+  }
+  if (self->library_signatures) {
+    self->exe_signatures = exe_signatures_new(self->proc_root);
+  }
+  // pidfds refer to live processes, which a fixture proc_root does not hold.
+  // A trace needs every process poll to be a recorded walk, so exit
+  // watching and the walks it skips stay off while one is attached.
+  if (self->app_scopes == NULL && self->capture_fds == NULL &&
+      self->probe_trace == NULL && g_strcmp0(self->proc_root, "/proc") == 0) {
+    self->sharer_exits = sharer_exits_new(self->source);
+    self->walks_skipped = 0;
+  }
+  if (self->process_scope != DISPLAY_DETECTION_PROCESS_SCOPE_ALL) {
+    g_autofree gchar* session_id =
+        self->process_scope == DISPLAY_DETECTION_PROCESS_SCOPE_SESSION
+            ? proc_scope_get_own_session_id()
+            : NULL;
+    self->proc_scope = proc_scope_new(geteuid(), session_id);
+  }
+  if (self->scan_threads > 1) {
+    self->proc_shards = proc_shards_new(self->proc_root, self->scan_threads);
+    proc_shards_set_scope(self->proc_shards, self->proc_scope);
+  }
+
+  // Initial scan of the subscribed fields
+  self->observed_external_connected = FALSE;
+  self->observed_display_count = 1;
+  self->observed_screen_shared = FALSE;
+  self->poll_interval_ms = poll_interval_ms > 0 ? poll_interval_ms : 2000;
+  self->first_scan_pending = TRUE;
+  if (!self->await_first_scan) {
+    // Run it from the source's first dispatch so the caller returns right
+    // away; default priority gets it in ahead of idle work.
+    self->first_scan_due = TRUE;
+    update_deadline(self);
+    return;
+  }
+  probe_connectors(self);
+  self->observed_screen_shared =
+      processes_subscribed(self) && is_screen_sharing_active(self);
+  finish_first_scan(self);
 }
 
 void display_detection_stop(DisplayDetection* self) {
   if (self == NULL) return;
-  if (self->poll_timer_id != 0) {
-    g_source_remove(self->poll_timer_id);
-    self->poll_timer_id = 0;
+  self->polling = FALSE;
+  self->first_scan_due = FALSE;
+  self->first_scan_pending = FALSE;
+  abandon_process_scan(self);
+  app_scopes_free(self->app_scopes);
+  self->app_scopes = NULL;
+  self->app_scopes_watched = FALSE;
+  capture_fds_free(self->capture_fds);
+  self->capture_fds = NULL;
+  exe_signatures_free(self->exe_signatures);
+  self->exe_signatures = NULL;
+  sharer_exits_free(self->sharer_exits);
+  self->sharer_exits = NULL;
+  proc_shards_free(self->proc_shards);
+  self->proc_shards = NULL;
+  proc_scope_free(self->proc_scope);
+  self->proc_scope = NULL;
+
+  // After the modules above removed their fds from it.
+  if (self->source != NULL) {
+    g_source_destroy(self->source);
+    g_source_unref(self->source);
+    self->source = NULL;
   }
 }
 
@@ -199,5 +1111,10 @@ void display_detection_free(DisplayDetection* self) {
   if (self == NULL) return;
   display_detection_stop(self);
   g_strfreev(self->custom_processes);
+  delete self->matcher;
+  delete self->tracker;
+  batched_reads_free(self->reads);
+  g_free(self->proc_root);
+  g_free(self->drm_root);
   g_free(self);
 }
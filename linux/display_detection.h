@@ -3,10 +3,51 @@
 
 #include <glib.h>
 
+#include "metrics_export.h"
+#include "probe_trace.h"
+
 G_BEGIN_DECLS
 
 typedef struct _DisplayDetection DisplayDetection;
 
+// Where screen-sharing apps are looked up.
+typedef enum {
+  // Every process in /proc, matched by comm name. Matched processes are
+  // watched through pidfds, so sharing clears as soon as the last one exits
+  // and /proc is walked less often while one is alive.
+  DISPLAY_DETECTION_PROCESS_SOURCE_PROC,
+  // The user's systemd app scopes, matched by scope name. Catches sandboxed
+  // apps whose comm is bwrap or truncated; falls back to /proc when no cgroup
+  // v2 user session is available.
+  DISPLAY_DETECTION_PROCESS_SOURCE_APP_SCOPES,
+} DisplayDetectionProcessSource;
+
+// Which processes a /proc walk reads; see proc_scope.h.
+typedef enum {
+  // Every process on the system.
+  DISPLAY_DETECTION_PROCESS_SCOPE_ALL,
+  // Processes owned by the current user, skipping kernel threads.
+  DISPLAY_DETECTION_PROCESS_SCOPE_USER,
+  // Those of the current user's processes in this process's logind session;
+  // the same as USER when it has none.
+  DISPLAY_DETECTION_PROCESS_SCOPE_SESSION,
+} DisplayDetectionProcessScope;
+
+// Fields of the reported state, as a bitmask of subscribed fields. A probe
+// only runs while one of the fields it produces is subscribed.
+typedef enum {
+  // Produced by the connector probe.
+  DISPLAY_DETECTION_FIELD_EXTERNAL_DISPLAY = 1 << 0,
+  DISPLAY_DETECTION_FIELD_DISPLAY_COUNT = 1 << 1,
+  // Produced by the process (or app scope) probe.
+  DISPLAY_DETECTION_FIELD_SCREEN_SHARED = 1 << 2,
+} DisplayDetectionField;
+
+#define DISPLAY_DETECTION_FIELDS_ALL                                      \
+  (DISPLAY_DETECTION_FIELD_EXTERNAL_DISPLAY |                             \
+   DISPLAY_DETECTION_FIELD_DISPLAY_COUNT |                                \
+   DISPLAY_DETECTION_FIELD_SCREEN_SHARED)
+
 typedef void (*DisplayChangeCallback)(gboolean is_external_connected,
                                       gint display_count,
                                       gboolean is_screen_shared,
@@ -15,6 +56,128 @@ typedef void (*DisplayChangeCallback)(gboolean is_external_connected,
 DisplayDetection* display_detection_new(DisplayChangeCallback callback,
                                         gpointer user_data);
 
+// Takes effect on the next display_detection_start().
+void display_detection_set_process_source(
+    DisplayDetection* detection,
+    DisplayDetectionProcessSource process_source);
+
+// Maps a LinuxProcessScope name ("all", "user", "session") to its scope;
+// unknown names read every process.
+DisplayDetectionProcessScope display_detection_process_scope_from_name(
+    const gchar* name);
+
+// Filters /proc entries by owner (and session) with one fstatat() each
+// before reading them. Applies to the /proc source and takes effect on the
+// next display_detection_start().
+void display_detection_set_process_scope(
+    DisplayDetection* detection,
+    DisplayDetectionProcessScope process_scope);
+
+// Requires name-matched processes to also hold a capture resource open
+// (PipeWire buffers, a DRM render node, a v4l2loopback device), inspecting at
+// most |fd_budget| file descriptors per poll. 0 disables the check. Applies to
+// the /proc source and takes effect on the next display_detection_start().
+void display_detection_set_capture_fd_budget(DisplayDetection* detection,
+                                             guint fd_budget);
+
+// Also counts processes whose executable maps a known capture library (see
+// exe_signatures.h), whatever their comm. Applies to the /proc source and
+// takes effect on the next display_detection_start().
+void display_detection_set_library_signatures(DisplayDetection* detection,
+                                              gboolean enabled);
+
+// Splits each /proc walk into main-loop dispatches of at most |budget_us|
+// microseconds, yielding through an idle source in between. The state is
+// committed only once the whole pass completes. 0 walks /proc in one go.
+void display_detection_set_scan_slice_budget(DisplayDetection* detection,
+                                             guint budget_us);
+
+// Splits each unsliced /proc walk across |thread_count| worker threads, each
+// reading a contiguous range of PIDs; all workers stop at the first match
+// unless capture evidence is required or sharer exits are watched, since
+// both need every match. 1 walks /proc on the calling thread.
+// Ignored while a scan slice budget is set; takes effect on the next
+// display_detection_start().
+void display_detection_set_scan_threads(DisplayDetection* detection,
+                                        guint thread_count);
+
+// Polls display connectors every |connector_interval_ms| and the process
+// table (or app scopes) every |process_interval_ms|, each on its own
+// schedule; 0 uses the interval passed to display_detection_start(). Probes
+// that come due together are reported as one change. Takes effect on the
+// next display_detection_start().
+void display_detection_set_probe_intervals(DisplayDetection* detection,
+                                           guint connector_interval_ms,
+                                           guint process_interval_ms);
+
+// Low-power mode: probe deadlines are rounded up to the session-wide second
+// grid g_timeout_add_seconds() uses, so the two probes and other apps'
+// timers share wakeups instead of each waking the CPU, at the cost of up to
+// a second of extra latency per poll. Takes effect from the next deadline.
+void display_detection_set_low_power(DisplayDetection* detection,
+                                     gboolean low_power);
+
+// Reads the process table from |proc_root| instead of /proc. For tests and
+// fixtures; takes effect on the next display_detection_start().
+void display_detection_set_proc_root(DisplayDetection* detection,
+                                     const gchar* proc_root);
+
+// Reads display connectors from |drm_root| instead of /sys/class/drm. For
+// tests and fixtures; takes effect on the next poll.
+void display_detection_set_drm_root(DisplayDetection* detection,
+                                    const gchar* drm_root);
+
+// Records probe durations, probe errors and the process table size into
+// |metrics_export|, which stays owned by the caller; NULL stops recording.
+// Applies immediately.
+void display_detection_set_metrics(DisplayDetection* detection,
+                                   MetricsExport* metrics_export);
+
+// Records what the connector and process probes read on every tick into
+// |writer|, which stays owned by the caller; NULL stops recording. While a
+// writer is attached, sharer exits are not watched and every process poll
+// walks /proc. Applies immediately; watching resumes on the next
+// display_detection_start() after the writer is removed.
+void display_detection_set_probe_trace(DisplayDetection* detection,
+                                       ProbeTraceWriter* writer);
+
+// Maps a MirrorField name from Dart ("externalDisplayConnected",
+// "displayCount", "screenShared") to its DisplayDetectionField. Returns 0 for
+// fields no probe produces, such as "screenMirrored".
+guint display_detection_field_from_name(const gchar* name);
+
+// Limits polling to the probes behind |fields|, a mask of
+// DisplayDetectionField. Unsubscribed fields keep their last observed value.
+// Unlike the other setters this applies immediately: while started, a probe
+// that becomes subscribed runs right away instead of at the next poll.
+void display_detection_set_fields(DisplayDetection* detection, guint fields);
+
+// Whether display_detection_start() runs the first scan before returning
+// (the default) or schedules it on the main loop and returns right away. The
+// first scan's result is always reported, and polling starts after it; a
+// scan slice budget also applies to a scheduled first scan. Takes effect on
+// the next display_detection_start().
+void display_detection_set_await_first_scan(DisplayDetection* detection,
+                                            gboolean await_first_scan);
+
+// Runs the probes behind |fields|, a mask of DisplayDetectionField, right
+// away and reports the merged state if it changed, as if they had come due.
+// Their regular schedule is unaffected. Lets a trace replay drive the
+// detector without waiting for timers; does nothing unless started and
+// polling.
+void display_detection_poll(DisplayDetection* detection, guint fields);
+
+// Swaps in a new poll interval (0 keeps the current one) and custom process
+// list while running, without a restart or a gap in reporting. Pending
+// deadlines move to the new interval measured from the last run. If the
+// list changes which names match, the process probe alone runs again on the
+// next main-loop iteration (a sliced pass in flight starts over); otherwise
+// nothing is rescanned. Intervals set with
+// display_detection_set_probe_intervals() still take precedence.
+void display_detection_update_config(DisplayDetection* detection,
+                                     guint poll_interval_ms,
+                                     const gchar* const* custom_processes);
+
 void display_detection_start(DisplayDetection* detection,
                              guint poll_interval_ms,
                              const gchar* const* custom_processes);
@@ -0,0 +1,113 @@
+#include "exe_signatures.h"
+
+#include <string.h>
+#include <sys/stat.h>
+
+typedef struct {
+  dev_t device;
+  ino_t inode;
+} ExeKey;
+
+struct _ExeSignatures {
+  gchar* proc_root;
+  GMutex mutex;
+  GHashTable* verdicts;  // ExeKey* (owned) -> GINT_TO_POINTER(is_capture_tool)
+  guint inspected_count;
+};
+
+// Every fragment of a signature must appear in the maps file. Fragments start
+// at a path separator so "libobs" does not match "libobsolete".
+static const gchar* const kObsSignature[] = {"/libobs.so", NULL};
+static const gchar* const kX11GrabSignature[] = {"/libavdevice.so",
+                                                 "/libxcb-shm.so", NULL};
+static const gchar* const kPipeWireScreencastSignature[] = {
+    "/libgstpipewire.so", NULL};
+
+static const gchar* const* const kSignatures[] = {
+    kObsSignature,
+    kX11GrabSignature,
+    kPipeWireScreencastSignature,
+};
+
+static guint exe_key_hash(gconstpointer key) {
+  const ExeKey* exe = (const ExeKey*)key;
+  guint64 inode = (guint64)exe->inode;
+  guint64 device = (guint64)exe->device;
+  return g_int64_hash(&inode) ^ g_int64_hash(&device);
+}
+
+static gboolean exe_key_equal(gconstpointer a, gconstpointer b) {
+  const ExeKey* left = (const ExeKey*)a;
+  const ExeKey* right = (const ExeKey*)b;
+  return left->device == right->device && left->inode == right->inode;
+}
+
+static gboolean maps_match_signature(const gchar* maps,
+                                     const gchar* const* signature) {
+  for (; *signature != NULL; signature++) {
+    if (strstr(maps, *signature) == NULL) return FALSE;
+  }
+  return TRUE;
+}
+
+ExeSignatures* exe_signatures_new(const gchar* proc_root) {
+  ExeSignatures* self = g_new0(ExeSignatures, 1);
+  self->proc_root = g_strdup(proc_root);
+  g_mutex_init(&self->mutex);
+  self->verdicts =
+      g_hash_table_new_full(exe_key_hash, exe_key_equal, g_free, NULL);
+  return self;
+}
+
+gboolean exe_signatures_match(ExeSignatures* self, guint pid) {
+  gchar path[128];
+  g_snprintf(path, sizeof(path), "%s/%u/exe", self->proc_root, pid);
+  struct stat exe_stat;
+  if (stat(path, &exe_stat) != 0) return FALSE;
+  ExeKey key = {exe_stat.st_dev, exe_stat.st_ino};
+
+  gpointer cached = NULL;
+  g_mutex_lock(&self->mutex);
+  gboolean known =
+      g_hash_table_lookup_extended(self->verdicts, &key, NULL, &cached);
+  g_mutex_unlock(&self->mutex);
+  if (known) return GPOINTER_TO_INT(cached);
+
+  // Read outside the lock; two threads racing on a new binary both inspect
+  // it and store the same verdict.
+  g_snprintf(path, sizeof(path), "%s/%u/maps", self->proc_root, pid);
+  g_autofree gchar* maps = NULL;
+  if (!g_file_get_contents(path, &maps, NULL, NULL)) return FALSE;
+
+  gboolean is_capture_tool = FALSE;
+  for (const gchar* const* signature : kSignatures) {
+    if (maps_match_signature(maps, signature)) {
+      is_capture_tool = TRUE;
+      break;
+    }
+  }
+
+  ExeKey* owned_key = g_new(ExeKey, 1);
+  *owned_key = key;
+  g_mutex_lock(&self->mutex);
+  self->inspected_count++;
+  g_hash_table_insert(self->verdicts, owned_key,
+                      GINT_TO_POINTER(is_capture_tool));
+  g_mutex_unlock(&self->mutex);
+  return is_capture_tool;
+}
+
+guint exe_signatures_get_inspected_count(ExeSignatures* self) {
+  g_mutex_lock(&self->mutex);
+  guint count = self->inspected_count;
+  g_mutex_unlock(&self->mutex);
+  return count;
+}
+
+void exe_signatures_free(ExeSignatures* self) {
+  if (self == NULL) return;
+  g_hash_table_unref(self->verdicts);
+  g_mutex_clear(&self->mutex);
+  g_free(self->proc_root);
+  g_free(self);
+}
@@ -0,0 +1,37 @@
+#ifndef EXE_SIGNATURES_H_
+#define EXE_SIGNATURES_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// Recognizes capture tools by the libraries mapped into their process rather
+// than by comm, which any process can set and which the kernel truncates to
+// 15 characters:
+//   - libobs (OBS Studio and anything embedding it),
+//   - libavdevice with libxcb-shm (ffmpeg's x11grab),
+//   - the GStreamer PipeWire plugin (portal screencast pipelines).
+//
+// Verdicts are cached per executable, keyed by the (device, inode) of
+// /proc/<pid>/exe: the first process running a binary costs a read of its
+// maps, every later one a single stat(). Libraries loaded after that first
+// inspection are not seen, and interpreters (python, java) share one verdict
+// for every script they run.
+typedef struct _ExeSignatures ExeSignatures;
+
+// |proc_root| is normally "/proc".
+ExeSignatures* exe_signatures_new(const gchar* proc_root);
+
+// TRUE if |pid|'s executable maps a capture library. Processes whose exe or
+// maps cannot be read (exited, kernel threads, other users) do not match and
+// are not cached. Thread-safe.
+gboolean exe_signatures_match(ExeSignatures* signatures, guint pid);
+
+// Number of maps files read so far, i.e. distinct executables classified.
+guint exe_signatures_get_inspected_count(ExeSignatures* signatures);
+
+void exe_signatures_free(ExeSignatures* signatures);
+
+G_END_DECLS
+
+#endif  // EXE_SIGNATURES_H_
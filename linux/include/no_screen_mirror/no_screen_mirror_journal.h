@@ -0,0 +1,155 @@
+#ifndef NO_SCREEN_MIRROR_JOURNAL_H_
+#define NO_SCREEN_MIRROR_JOURNAL_H_
+
+// Reader for the state transition journal a no_screen_mirror detector keeps
+// (LinuxScanOptions.journalPath or nsm-monitor --journal): a fixed-size file
+// holding a header and a ring of 32-byte records, one per state change.
+// Self-contained C99 with GCC/Clang atomics, like no_screen_mirror_state.h;
+// nsm-journal dumps a journal with it:
+//
+//   size_t size;
+//   const NsmJournalHeader* journal = nsm_journal_map(path, &size);
+//   uint64_t head = nsm_journal_head(journal);
+//   NsmJournalRecord record;
+//   for (uint64_t p = nsm_journal_tail(journal); p < head; p++) {
+//     if (nsm_journal_read(journal, p, &record)) { ... }
+//   }
+//   munmap((void*)journal, size);
+//
+// Every record carries its own commit stamp, stored last with release
+// semantics, so a record torn by a crash mid-write (or being overwritten
+// while a live journal is read) is skipped rather than misread. The file can
+// be read while the writer runs and after it crashed. The writer only
+// forces records to disk when it closes the journal, so a process crash
+// loses nothing, but a power loss or kernel panic can lose the records the
+// kernel had not yet written back.
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "no_screen_mirror_state.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NSM_JOURNAL_MAGIC 0x4a4d534eu  // "NSMJ"
+#define NSM_JOURNAL_VERSION 1u
+
+// NsmJournalRecord.state packs the NSM_STATE_* flags into the low byte and
+// the display count into the high 16 bits.
+#define NSM_JOURNAL_STATE_FLAGS(state) ((state)&0xffu)
+#define NSM_JOURNAL_STATE_DISPLAY_COUNT(state) ((int32_t)((state) >> 16))
+
+// Bits of NsmJournalRecord.cause.
+// The external display or display count changed.
+#define NSM_JOURNAL_CAUSE_DISPLAYS (1u << 0)
+// Screen sharing started or stopped.
+#define NSM_JOURNAL_CAUSE_SHARING (1u << 1)
+// First state detected since the plugin started, recorded even if it equals
+// the last one before.
+#define NSM_JOURNAL_CAUSE_FIRST_SCAN (1u << 2)
+// Detected by another app's shared session detector.
+#define NSM_JOURNAL_CAUSE_SHARED_DETECTOR (1u << 3)
+
+// Start of the file; the records follow it.
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  // Records in the ring, and the size of each.
+  uint32_t capacity;
+  uint32_t record_size;
+  // Records appended since the file was created. Advanced with a release
+  // store after the record it counts.
+  uint64_t head;
+  uint8_t reserved[40];
+} NsmJournalHeader;
+
+typedef struct {
+  // Position in the journal plus one; 0 while the slot is being written.
+  uint64_t commit;
+  // CLOCK_REALTIME microseconds at detection, comparable across reboots.
+  int64_t detected_at_wall_us;
+  // MirrorSnapshot.sequence; restarts with every detector run.
+  uint64_t sequence;
+  uint32_t state;
+  uint32_t cause;
+} NsmJournalRecord;
+
+static inline const NsmJournalRecord* nsm_journal_records(
+    const NsmJournalHeader* journal) {
+  return (const NsmJournalRecord*)(journal + 1);
+}
+
+// Maps the journal at |path| read-only and stores the mapping's size in
+// |out_size|. Returns NULL if it doesn't exist or wasn't written by a
+// compatible detector. Unmap with munmap(journal, *out_size).
+static inline const NsmJournalHeader* nsm_journal_map(const char* path,
+                                                       size_t* out_size) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return NULL;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(NsmJournalHeader)) {
+    close(fd);
+    return NULL;
+  }
+  size_t size = (size_t)st.st_size;
+  void* mapping = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) return NULL;
+
+  const NsmJournalHeader* journal = (const NsmJournalHeader*)mapping;
+  if (__atomic_load_n(&journal->magic, __ATOMIC_ACQUIRE) !=
+          NSM_JOURNAL_MAGIC ||
+      journal->version != NSM_JOURNAL_VERSION ||
+      journal->record_size != sizeof(NsmJournalRecord) ||
+      journal->capacity == 0 ||
+      size < sizeof(NsmJournalHeader) +
+                 (size_t)journal->capacity * sizeof(NsmJournalRecord)) {
+    munmap(mapping, size);
+    return NULL;
+  }
+  *out_size = size;
+  return journal;
+}
+
+// One past the last record appended.
+static inline uint64_t nsm_journal_head(const NsmJournalHeader* journal) {
+  uint64_t head = __atomic_load_n(&journal->head, __ATOMIC_ACQUIRE);
+  // A writer that died between committing a record and advancing head left
+  // that record complete, one past head.
+  const NsmJournalRecord* next =
+      &nsm_journal_records(journal)[head % journal->capacity];
+  if (__atomic_load_n(&next->commit, __ATOMIC_ACQUIRE) == head + 1) head++;
+  return head;
+}
+
+// The oldest record still in the ring.
+static inline uint64_t nsm_journal_tail(const NsmJournalHeader* journal) {
+  uint64_t head = nsm_journal_head(journal);
+  return head > journal->capacity ? head - journal->capacity : 0;
+}
+
+// Copies the record at |position| into |out|. Returns 0 if it was
+// overwritten, not written yet or torn.
+static inline int nsm_journal_read(const NsmJournalHeader* journal,
+                                   uint64_t position, NsmJournalRecord* out) {
+  const NsmJournalRecord* slot =
+      &nsm_journal_records(journal)[position % journal->capacity];
+  uint64_t commit = __atomic_load_n(&slot->commit, __ATOMIC_ACQUIRE);
+  if (commit != position + 1) return 0;
+  memcpy(out, slot, sizeof(*out));
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  // Overwritten while copying.
+  return __atomic_load_n(&slot->commit, __ATOMIC_RELAXED) == commit;
+}
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // NO_SCREEN_MIRROR_JOURNAL_H_
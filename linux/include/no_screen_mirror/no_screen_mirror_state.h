@@ -0,0 +1,116 @@
+#ifndef NO_SCREEN_MIRROR_STATE_H_
+#define NO_SCREEN_MIRROR_STATE_H_
+
+// Lock-free reader for the detection state a no_screen_mirror detector
+// publishes into POSIX shared memory (LinuxScanOptions.stateExportName or
+// nsm-monitor --export-shm). Self-contained C99 with GCC/Clang atomics; copy
+// it into any local process that needs the state:
+//
+//   const NsmSharedState* shared = nsm_shared_state_map("/no_screen_mirror");
+//   NsmStateSnapshot snapshot;
+//   if (shared != NULL && nsm_shared_state_read(shared, &snapshot)) {
+//     if (snapshot.flags & NSM_STATE_SCREEN_SHARED) { ... }
+//   }
+//
+// Mapping costs one shm_open() and mmap(); every read after that is a few
+// loads with no syscalls and no locks. The writer updates the segment under
+// a seqlock, so a reader retries instead of ever seeing a torn state.
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NSM_SHARED_STATE_MAGIC 0x534d534eu  // "NSMS"
+#define NSM_SHARED_STATE_VERSION 1u
+
+// Bits of NsmStateSnapshot.flags.
+#define NSM_STATE_SCREEN_MIRRORED (1u << 0)
+#define NSM_STATE_EXTERNAL_DISPLAY_CONNECTED (1u << 1)
+#define NSM_STATE_SCREEN_SHARED (1u << 2)
+
+// Layout of the shared segment. Only the writer stores to it; every field is
+// accessed with atomics.
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  // Odd while the writer is updating the fields below.
+  uint32_t seqlock;
+  uint32_t flags;
+  int32_t display_count;
+  // Process id of the publishing detector, to spot a stale segment.
+  int32_t writer_pid;
+  // Event sequence number, as in MirrorSnapshot.sequence.
+  uint64_t sequence;
+  // CLOCK_MONOTONIC microseconds, as in MirrorSnapshot.detectedAtUs.
+  int64_t detected_at_us;
+} NsmSharedState;
+
+// A consistent copy of the published state.
+typedef struct {
+  uint32_t flags;
+  int32_t display_count;
+  int32_t writer_pid;
+  uint64_t sequence;
+  int64_t detected_at_us;
+} NsmStateSnapshot;
+
+// Maps the segment published under |name| (e.g. "/no_screen_mirror")
+// read-only. Returns NULL if it doesn't exist or wasn't written by a
+// compatible detector. Unmap with munmap(state, sizeof(NsmSharedState)).
+static inline const NsmSharedState* nsm_shared_state_map(const char* name) {
+  int fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+  if (fd < 0) return NULL;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(NsmSharedState)) {
+    close(fd);
+    return NULL;
+  }
+  void* mapping =
+      mmap(NULL, sizeof(NsmSharedState), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) return NULL;
+
+  const NsmSharedState* state = (const NsmSharedState*)mapping;
+  if (__atomic_load_n(&state->magic, __ATOMIC_ACQUIRE) !=
+          NSM_SHARED_STATE_MAGIC ||
+      __atomic_load_n(&state->version, __ATOMIC_RELAXED) !=
+          NSM_SHARED_STATE_VERSION) {
+    munmap(mapping, sizeof(NsmSharedState));
+    return NULL;
+  }
+  return state;
+}
+
+// Copies the current state into |out|. Returns 0 if the writer kept
+// updating it for the whole retry budget, or nothing was published yet.
+static inline int nsm_shared_state_read(const NsmSharedState* state,
+                                        NsmStateSnapshot* out) {
+  for (int attempt = 0; attempt < 1000; attempt++) {
+    uint32_t begin = __atomic_load_n(&state->seqlock, __ATOMIC_ACQUIRE);
+    if (begin & 1u) continue;
+    out->flags = __atomic_load_n(&state->flags, __ATOMIC_RELAXED);
+    out->display_count =
+        __atomic_load_n(&state->display_count, __ATOMIC_RELAXED);
+    out->writer_pid = __atomic_load_n(&state->writer_pid, __ATOMIC_RELAXED);
+    out->sequence = __atomic_load_n(&state->sequence, __ATOMIC_RELAXED);
+    out->detected_at_us =
+        __atomic_load_n(&state->detected_at_us, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&state->seqlock, __ATOMIC_RELAXED) == begin) {
+      return out->sequence != 0;
+    }
+  }
+  return 0;
+}
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // NO_SCREEN_MIRROR_STATE_H_
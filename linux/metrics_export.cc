@@ -0,0 +1,249 @@
+#include "metrics_export.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "metrics.h"
+
+using no_screen_mirror::DetectionState;
+using no_screen_mirror::Metrics;
+
+struct _MetricsExport {
+  Metrics* metrics;
+  gchar* socket_path;
+  gchar* textfile_path;
+  int listen_fd;
+  // Written once by metrics_export_free() to wake and stop the thread.
+  int stop_fds[2];
+  GThread* thread;
+};
+
+// node-exporter reads textfiles on every scrape, typically every 15 to 60
+// seconds.
+static const gint kTextfileIntervalSeconds = 10;
+
+// How long a socket client gets to send an HTTP request line before it is
+// answered with the plain exposition, and to read the answer.
+static const gint kClientTimeoutMs = 100;
+static const gint kClientSendTimeoutSeconds = 1;
+
+static const gchar kHttpHeader[] =
+    "HTTP/1.0 200 OK\r\n"
+    "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+    "Connection: close\r\n"
+    "\r\n";
+
+// Whether something accepts connections on the socket at |address|.
+static gboolean is_listening(const struct sockaddr_un* address) {
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) return FALSE;
+  gboolean listening =
+      connect(fd, (const struct sockaddr*)address, sizeof(*address)) == 0;
+  close(fd);
+  return listening;
+}
+
+static int listen_on(const gchar* path) {
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(address.sun_path)) return -1;
+  g_strlcpy(address.sun_path, path, sizeof(address.sun_path));
+
+  // Only a socket left behind by an earlier run that did not shut down
+  // cleanly is replaced; never a file, nor another instance's live exporter.
+  struct stat st;
+  if (lstat(path, &st) == 0) {
+    if (!S_ISSOCK(st.st_mode) || is_listening(&address)) return -1;
+    unlink(path);
+  }
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) return -1;
+  if (bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+      listen(fd, 8) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static void send_all(int fd, const gchar* data, gsize length) {
+  while (length > 0) {
+    ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+    if (sent <= 0) return;
+    data += sent;
+    length -= (gsize)sent;
+  }
+}
+
+static void serve_client(MetricsExport* self, int client_fd,
+                         std::string* text) {
+  struct timeval send_timeout = {kClientSendTimeoutSeconds, 0};
+  setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &send_timeout,
+             sizeof(send_timeout));
+
+  // HTTP clients (curl --unix-socket, scrapers' unix transports) speak
+  // first; a plain reader such as socat just waits for the exposition.
+  gboolean http = FALSE;
+  struct pollfd request = {client_fd, POLLIN, 0};
+  if (poll(&request, 1, kClientTimeoutMs) > 0) {
+    gchar buffer[512];
+    ssize_t received = recv(client_fd, buffer, sizeof(buffer), 0);
+    http = received >= 4 && memcmp(buffer, "GET ", 4) == 0;
+  }
+
+  self->metrics->Render(text);
+  if (http) send_all(client_fd, kHttpHeader, sizeof(kHttpHeader) - 1);
+  send_all(client_fd, text->data(), text->size());
+}
+
+static void write_textfile(MetricsExport* self, std::string* text) {
+  self->metrics->Render(text);
+  // Written to a temporary file and renamed, so node-exporter never reads a
+  // partial exposition.
+  g_file_set_contents(self->textfile_path, text->data(),
+                      (gssize)text->size(), NULL);
+}
+
+static gpointer run_export(gpointer user_data) {
+  MetricsExport* self = (MetricsExport*)user_data;
+  std::string text;
+  gint64 next_write_us = 0;
+
+  while (TRUE) {
+    gint timeout_ms = -1;
+    if (self->textfile_path != NULL) {
+      gint64 now_us = g_get_monotonic_time();
+      if (now_us >= next_write_us) {
+        write_textfile(self, &text);
+        next_write_us = now_us + kTextfileIntervalSeconds * G_USEC_PER_SEC;
+      }
+      timeout_ms = (gint)((next_write_us - now_us + 999) / 1000);
+    }
+
+    struct pollfd fds[2] = {{self->stop_fds[0], POLLIN, 0},
+                            {self->listen_fd, POLLIN, 0}};
+    int ready = poll(fds, self->listen_fd >= 0 ? 2 : 1, timeout_ms);
+    if (ready < 0 && errno != EINTR) break;
+    if (fds[0].revents != 0) break;
+    if (self->listen_fd >= 0 && (fds[1].revents & POLLIN) != 0) {
+      int client_fd = accept4(self->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+      if (client_fd >= 0) {
+        serve_client(self, client_fd, &text);
+        close(client_fd);
+      }
+    }
+  }
+  return NULL;
+}
+
+MetricsExport* metrics_export_new(const gchar* socket_path,
+                                  const gchar* textfile_path) {
+  if (socket_path == NULL && textfile_path == NULL) return NULL;
+
+  int listen_fd = -1;
+  if (socket_path != NULL) {
+    listen_fd = listen_on(socket_path);
+    if (listen_fd < 0) return NULL;
+  }
+  int stop_fds[2];
+  if (pipe2(stop_fds, O_CLOEXEC) != 0) {
+    if (listen_fd >= 0) {
+      close(listen_fd);
+      unlink(socket_path);
+    }
+    return NULL;
+  }
+
+  MetricsExport* self = g_new0(MetricsExport, 1);
+  self->metrics = new Metrics();
+  self->socket_path = g_strdup(socket_path);
+  self->textfile_path = g_strdup(textfile_path);
+  self->listen_fd = listen_fd;
+  self->stop_fds[0] = stop_fds[0];
+  self->stop_fds[1] = stop_fds[1];
+  self->thread = g_thread_try_new("nsm-metrics", run_export, self, NULL);
+  if (self->thread == NULL) {
+    metrics_export_free(self);
+    return NULL;
+  }
+  return self;
+}
+
+static Metrics::Probe to_probe(MetricsExportProbe probe) {
+  return probe == METRICS_EXPORT_PROBE_CONNECTORS
+             ? Metrics::Probe::kConnectors
+             : Metrics::Probe::kProcesses;
+}
+
+void metrics_export_record_scan(MetricsExport* self,
+                                MetricsExportProbe probe,
+                                gint64 duration_us) {
+  if (self == NULL) return;
+  self->metrics->RecordScan(to_probe(probe), duration_us);
+}
+
+void metrics_export_record_error(MetricsExport* self,
+                                 MetricsExportProbe probe) {
+  if (self == NULL) return;
+  self->metrics->RecordProbeError(to_probe(probe));
+}
+
+void metrics_export_set_process_count(MetricsExport* self, guint count) {
+  if (self == NULL) return;
+  self->metrics->SetProcessCount(count);
+}
+
+void metrics_export_record_event(MetricsExport* self, guint64 coalesced) {
+  if (self == NULL) return;
+  self->metrics->RecordEvent(coalesced);
+}
+
+void metrics_export_record_wakeup(MetricsExport* self) {
+  if (self == NULL) return;
+  self->metrics->RecordWakeup(g_get_monotonic_time());
+}
+
+void metrics_export_set_state(MetricsExport* self,
+                              gboolean is_screen_mirrored,
+                              gboolean is_external_connected,
+                              gint display_count,
+                              gboolean is_screen_shared) {
+  if (self == NULL) return;
+  DetectionState state;
+  state.is_screen_mirrored = is_screen_mirrored;
+  state.is_external_display_connected = is_external_connected;
+  state.display_count = display_count;
+  state.is_screen_shared = is_screen_shared;
+  self->metrics->SetState(state);
+}
+
+void metrics_export_free(MetricsExport* self) {
+  if (self == NULL) return;
+  if (self->thread != NULL) {
+    gchar stop = 1;
+    while (write(self->stop_fds[1], &stop, 1) < 0 && errno == EINTR) {
+    }
+    g_thread_join(self->thread);
+  }
+  close(self->stop_fds[0]);
+  close(self->stop_fds[1]);
+  if (self->listen_fd >= 0) {
+    close(self->listen_fd);
+    unlink(self->socket_path);
+  }
+  if (self->textfile_path != NULL) unlink(self->textfile_path);
+  delete self->metrics;
+  g_free(self->socket_path);
+  g_free(self->textfile_path);
+  g_free(self);
+}
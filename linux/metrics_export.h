@@ -0,0 +1,66 @@
+#ifndef METRICS_EXPORT_H_
+#define METRICS_EXPORT_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// Serves the detector's metrics in the Prometheus text format: scan duration
+// histograms, probe errors, events delivered and coalesced, the current state,
+// the process table size and main-loop wakeups.
+//
+// Updates are lock-free counter increments from the main loop. A background
+// thread does all rendering and I/O, answering each connection to a unix
+// socket with one exposition (plain, or as an HTTP/1.0 response when the
+// client sends a request first) and rewriting a node-exporter textfile every
+// kTextfileIntervalSeconds.
+typedef struct _MetricsExport MetricsExport;
+
+typedef enum {
+  METRICS_EXPORT_PROBE_CONNECTORS,
+  METRICS_EXPORT_PROBE_PROCESSES,
+} MetricsExportProbe;
+
+// Listens on the unix socket |socket_path| and/or writes |textfile_path|
+// (which should end in .prom); either may be NULL, not both. A stale socket
+// at |socket_path| is replaced. Returns NULL if the socket cannot be bound,
+// including when |socket_path| is not a socket or another exporter still
+// listens on it, or if the thread cannot start.
+MetricsExport* metrics_export_new(const gchar* socket_path,
+                                  const gchar* textfile_path);
+
+// Every update below ignores a NULL |metrics_export|.
+
+// One completed probe run.
+void metrics_export_record_scan(MetricsExport* metrics_export,
+                                MetricsExportProbe probe,
+                                gint64 duration_us);
+
+// A probe run that could not read its source.
+void metrics_export_record_error(MetricsExport* metrics_export,
+                                 MetricsExportProbe probe);
+
+// Processes examined by the last /proc walk.
+void metrics_export_set_process_count(MetricsExport* metrics_export,
+                                      guint count);
+
+// An event delivered to Dart, replacing |coalesced| earlier changes.
+void metrics_export_record_event(MetricsExport* metrics_export,
+                                 guint64 coalesced);
+
+// A main-loop wakeup on the detector's or the event stream's behalf.
+void metrics_export_record_wakeup(MetricsExport* metrics_export);
+
+void metrics_export_set_state(MetricsExport* metrics_export,
+                              gboolean is_screen_mirrored,
+                              gboolean is_external_connected,
+                              gint display_count,
+                              gboolean is_screen_shared);
+
+// Stops the thread, then removes the socket and the textfile so scrapers do
+// not keep reading stale gauges.
+void metrics_export_free(MetricsExport* metrics_export);
+
+G_END_DECLS
+
+#endif  // METRICS_EXPORT_H_
@@ -4,6 +4,8 @@
 
 #include "no_screen_mirror_plugin_private.h"
 #include "display_detection.h"
+#include "event_outbox.h"
+#include "include/no_screen_mirror/no_screen_mirror_journal.h"
 
 #define NO_SCREEN_MIRROR_PLUGIN(obj) \
   (G_TYPE_CHECK_INSTANCE_CAST((obj), no_screen_mirror_plugin_get_type(), \
@@ -20,17 +22,110 @@ G_DEFINE_TYPE(NoScreenMirrorPlugin, no_screen_mirror_plugin, g_object_get_type()
 // Helpers
 // ---------------------------------------------------------------------------
 
-gchar* build_mirror_event_json(gboolean is_screen_mirrored,
-                               gboolean is_external_display_connected,
-                               gint display_count,
-                               gboolean is_screen_shared) {
-  return g_strdup_printf(
-      "{\"is_screen_mirrored\":%s,\"is_external_display_connected\":%s,"
-      "\"display_count\":%d,\"is_screen_shared\":%s}",
-      is_screen_mirrored ? "true" : "false",
-      is_external_display_connected ? "true" : "false",
-      display_count,
-      is_screen_shared ? "true" : "false");
+// Copies the outbox's latest state to the shared memory export, the metrics
+// gauges and, when this instance scans for the session, to the other apps
+// over D-Bus.
+static void publish_state(NoScreenMirrorPlugin* self) {
+  // A provisional state was never detected; others only get confirmed ones.
+  if (self->outbox->sequence() == 0 || self->outbox->provisional()) return;
+  const no_screen_mirror::DetectionState& state = self->outbox->state();
+  metrics_export_set_state(self->metrics_export, state.is_screen_mirrored,
+                           state.is_external_display_connected,
+                           state.display_count, state.is_screen_shared);
+  state_export_publish(self->state_export, state.is_screen_mirrored,
+                       state.is_external_display_connected,
+                       state.display_count, state.is_screen_shared,
+                       self->outbox->sequence(),
+                       self->outbox->detected_at_us());
+  session_service_publish(self->session_service, state.is_screen_mirrored,
+                          state.is_external_display_connected,
+                          state.display_count, state.is_screen_shared,
+                          self->outbox->sequence(),
+                          self->outbox->detected_at_us());
+}
+
+static void save_state(NoScreenMirrorPlugin* self) {
+  const no_screen_mirror::DetectionState& state = self->outbox->state();
+  CachedState cached;
+  cached.is_screen_mirrored = state.is_screen_mirrored;
+  cached.is_external_connected = state.is_external_display_connected;
+  cached.display_count = state.display_count;
+  cached.is_screen_shared = state.is_screen_shared;
+  cached.detected_at_us = self->outbox->detected_at_us();
+  state_cache_save(self->state_cache_path, self->boot_id, &cached);
+}
+
+static gboolean on_save_state(gpointer user_data) {
+  NoScreenMirrorPlugin* self = NO_SCREEN_MIRROR_PLUGIN(user_data);
+  self->state_save_id = 0;
+  save_state(self);
+  return G_SOURCE_REMOVE;
+}
+
+// The save fsyncs a temporary file and renames it, which is too slow to do
+// on every change; changes within a second are written once, at low
+// priority, and dispose writes any still pending.
+static void schedule_save_state(NoScreenMirrorPlugin* self) {
+  if (self->state_save_id != 0) return;
+  self->state_save_id = g_timeout_add_seconds_full(
+      G_PRIORITY_LOW, 1, on_save_state, self, NULL);
+}
+
+// Appends the outbox's latest state to the journal as a transition from
+// |previous|; |cause| holds the NSM_JOURNAL_CAUSE_* bits known to the caller.
+static void journal_state(NoScreenMirrorPlugin* self,
+                          const no_screen_mirror::DetectionState& previous,
+                          guint cause) {
+  const no_screen_mirror::DetectionState& state = self->outbox->state();
+  if (state.is_external_display_connected !=
+          previous.is_external_display_connected ||
+      state.display_count != previous.display_count) {
+    cause |= NSM_JOURNAL_CAUSE_DISPLAYS;
+  }
+  if (state.is_screen_shared != previous.is_screen_shared) {
+    cause |= NSM_JOURNAL_CAUSE_SHARING;
+  }
+  state_journal_append(self->state_journal, state.is_screen_mirrored,
+                       state.is_external_display_connected,
+                       state.display_count, state.is_screen_shared,
+                       self->outbox->sequence(),
+                       self->outbox->detected_at_us(), cause);
+}
+
+static void schedule_delivery(NoScreenMirrorPlugin* self);
+
+static void record_state(NoScreenMirrorPlugin* self,
+                         const no_screen_mirror::DetectionState& state,
+                         gint64 detected_at_us, guint cause) {
+  no_screen_mirror::DetectionState previous = self->outbox->state();
+  // The first state detected confirms or replaces a provisional one.
+  if (self->outbox->sequence() == 0 || self->outbox->provisional()) {
+    cause |= NSM_JOURNAL_CAUSE_FIRST_SCAN;
+  }
+  if (self->outbox->Record(state, detected_at_us)) {
+    publish_state(self);
+    schedule_save_state(self);
+    journal_state(self, previous, cause);
+    schedule_delivery(self);
+  }
+}
+
+// Queues the last state committed during this boot, or the default state if
+// there is none, as provisional until the first scan confirms or replaces
+// it.
+static void restore_cached_state(NoScreenMirrorPlugin* self) {
+  no_screen_mirror::DetectionState state;
+  gint64 detected_at_us = g_get_monotonic_time();
+  CachedState cached;
+  if (state_cache_load(self->state_cache_path, self->boot_id, &cached)) {
+    state.is_screen_mirrored = cached.is_screen_mirrored;
+    state.is_external_display_connected = cached.is_external_connected;
+    state.display_count = cached.display_count;
+    state.is_screen_shared = cached.is_screen_shared;
+    // Same boot, so still on this process's CLOCK_MONOTONIC.
+    detected_at_us = cached.detected_at_us;
+  }
+  self->outbox->RecordProvisional(state, detected_at_us);
 }
 
 static void update_shared_state(NoScreenMirrorPlugin* self,
@@ -38,15 +133,14 @@ static void update_shared_state(NoScreenMirrorPlugin* self,
                                 gint display_count,
                                 gboolean is_screen_shared) {
   // Linux: is_screen_mirrored is always false (no kernel mirroring concept)
-  g_autofree gchar* json =
-      build_mirror_event_json(FALSE, is_external_connected, display_count,
-                              is_screen_shared);
-
-  if (g_strcmp0(json, self->last_event_json) != 0) {
-    g_free(self->last_event_json);
-    self->last_event_json = g_strdup(json);
-    self->has_pending_event = TRUE;
-  }
+  no_screen_mirror::DetectionState state;
+  state.is_external_display_connected = is_external_connected;
+  state.display_count = display_count;
+  state.is_screen_shared = is_screen_shared;
+
+  // g_get_monotonic_time() is CLOCK_MONOTONIC, the clock behind Dart's
+  // Timeline.now.
+  record_state(self, state, g_get_monotonic_time(), 0);
 }
 
 // ---------------------------------------------------------------------------
@@ -62,10 +156,336 @@ static void on_display_changed(gboolean is_external_connected,
                       is_screen_shared);
 }
 
+// ---------------------------------------------------------------------------
+// Shared detector (session bus)
+// ---------------------------------------------------------------------------
+
+static void on_session_role_changed(SessionServiceRole role,
+                                    gpointer user_data) {
+  NoScreenMirrorPlugin* self = NO_SCREEN_MIRROR_PLUGIN(user_data);
+  if (role == SESSION_SERVICE_ROLE_OWNER) {
+    display_detection_start(self->detection, self->poll_interval_ms,
+                            self->custom_processes);
+    // Subscribers catch up through GetState.
+    publish_state(self);
+  } else if (role == SESSION_SERVICE_ROLE_SUBSCRIBER) {
+    display_detection_stop(self->detection);
+  }
+}
+
+static void on_remote_state(gboolean is_screen_mirrored,
+                            gboolean is_external_connected,
+                            gint display_count,
+                            gboolean is_screen_shared,
+                            guint64 sequence,
+                            gint64 detected_at_us,
+                            gpointer user_data) {
+  NoScreenMirrorPlugin* self = NO_SCREEN_MIRROR_PLUGIN(user_data);
+  no_screen_mirror::DetectionState state;
+  state.is_screen_mirrored = is_screen_mirrored;
+  state.is_external_display_connected = is_external_connected;
+  state.display_count = display_count;
+  state.is_screen_shared = is_screen_shared;
+  // CLOCK_MONOTONIC is shared by every process, so the owner's detection
+  // time stays meaningful here. Events keep this instance's own sequence.
+  record_state(self, state, detected_at_us,
+               NSM_JOURNAL_CAUSE_SHARED_DETECTOR);
+}
+
+static void on_session_bus_ready(GObject* source,
+                                 GAsyncResult* result,
+                                 gpointer user_data) {
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GDBusConnection) connection = g_bus_get_finish(result, &error);
+  // Cancelled by stop_listening() or dispose; |user_data| may be gone.
+  if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) return;
+
+  NoScreenMirrorPlugin* self = NO_SCREEN_MIRROR_PLUGIN(user_data);
+  g_clear_object(&self->session_bus_cancel);
+  // No session bus: keep scanning locally.
+  if (connection == NULL) return;
+
+  // Other apps may need any field, so the shared detector probes all.
+  display_detection_set_fields(self->detection, DISPLAY_DETECTION_FIELDS_ALL);
+  self->session_service = session_service_new(
+      connection, NULL, on_session_role_changed, on_remote_state, self);
+}
+
+// Starts scanning, and joins the session's shared detector when requested.
+// Connecting to the bus would block the platform thread, so this instance
+// scans on its own until the service decides its role.
+static void start_listening(NoScreenMirrorPlugin* self,
+                            guint poll_interval_ms,
+                            const gchar* const* custom_processes) {
+  self->poll_interval_ms = poll_interval_ms;
+  g_strfreev(self->custom_processes);
+  self->custom_processes = g_strdupv((gchar**)custom_processes);
+  display_detection_start(self->detection, poll_interval_ms, custom_processes);
+  if (self->share_detector) {
+    self->session_bus_cancel = g_cancellable_new();
+    g_bus_get(G_BUS_TYPE_SESSION, self->session_bus_cancel,
+              on_session_bus_ready, self);
+  }
+}
+
+// Applies updateConfig()'s arguments while listening; absent ones keep
+// their current value.
+static void update_config(NoScreenMirrorPlugin* self, FlValue* args) {
+  FlValue* interval_val = fl_value_lookup_string(args, "pollingIntervalMs");
+  if (interval_val != NULL &&
+      fl_value_get_type(interval_val) == FL_VALUE_TYPE_INT) {
+    gint64 val = fl_value_get_int(interval_val);
+    if (val > 0) self->poll_interval_ms = (guint)val;
+  }
+
+  FlValue* processes_val = fl_value_lookup_string(args, "customProcesses");
+  if (processes_val != NULL &&
+      fl_value_get_type(processes_val) == FL_VALUE_TYPE_LIST) {
+    guint count = fl_value_get_length(processes_val);
+    g_strfreev(self->custom_processes);
+    self->custom_processes = g_new0(gchar*, count + 1);
+    for (guint i = 0; i < count; i++) {
+      FlValue* item = fl_value_get_list_value(processes_val, i);
+      self->custom_processes[i] = g_strdup(fl_value_get_string(item));
+    }
+  }
+
+  // A subscriber's detection is stopped; it just keeps the settings for
+  // when it takes over.
+  display_detection_update_config(self->detection, self->poll_interval_ms,
+                                  self->custom_processes);
+
+  FlValue* rate_val = fl_value_lookup_string(args, "maxEventsPerSecond");
+  if (rate_val != NULL && fl_value_get_type(rate_val) == FL_VALUE_TYPE_INT) {
+    gint64 val = fl_value_get_int(rate_val);
+    if (val >= 0) {
+      self->outbox->set_max_events_per_second((gint)MIN(val, G_MAXINT));
+      // A pending event waits out the new limit instead of the old one.
+      if (self->stream_timer_id != 0) {
+        g_source_remove(self->stream_timer_id);
+        self->stream_timer_id = 0;
+        schedule_delivery(self);
+      }
+    }
+  }
+}
+
+static void stop_listening(NoScreenMirrorPlugin* self) {
+  g_cancellable_cancel(self->session_bus_cancel);
+  g_clear_object(&self->session_bus_cancel);
+  session_service_free(self->session_service);
+  self->session_service = NULL;
+  display_detection_stop(self->detection);
+  state_export_free(self->state_export);
+  self->state_export = NULL;
+  display_detection_set_metrics(self->detection, NULL);
+  metrics_export_free(self->metrics_export);
+  self->metrics_export = NULL;
+  state_journal_free(self->state_journal);
+  self->state_journal = NULL;
+  display_detection_set_probe_trace(self->detection, NULL);
+  probe_trace_writer_free(self->probe_trace);
+  self->probe_trace = NULL;
+  self->low_power = FALSE;
+  display_detection_set_low_power(self->detection, FALSE);
+  self->share_detector = FALSE;
+  self->poll_interval_ms = 2000;
+  g_strfreev(self->custom_processes);
+  self->custom_processes = NULL;
+}
+
 // ---------------------------------------------------------------------------
 // Method channel handler
 // ---------------------------------------------------------------------------
 
+// Applies every LinuxScanOptions field to the detector; absent ones, or
+// absent options, restore the defaults rather than keep an earlier session's.
+static void apply_linux_scan_options(NoScreenMirrorPlugin* self,
+                                     FlValue* options) {
+  g_autoptr(FlValue) defaults = NULL;
+  if (options == NULL || fl_value_get_type(options) != FL_VALUE_TYPE_MAP) {
+    options = defaults = fl_value_new_map();
+  }
+
+  FlValue* source_val = fl_value_lookup_string(options, "processSource");
+  display_detection_set_process_source(
+      self->detection,
+      source_val != NULL &&
+              fl_value_get_type(source_val) == FL_VALUE_TYPE_STRING &&
+              g_strcmp0(fl_value_get_string(source_val), "appScopes") == 0
+          ? DISPLAY_DETECTION_PROCESS_SOURCE_APP_SCOPES
+          : DISPLAY_DETECTION_PROCESS_SOURCE_PROC);
+
+  FlValue* scope_val = fl_value_lookup_string(options, "processScope");
+  display_detection_set_process_scope(
+      self->detection,
+      display_detection_process_scope_from_name(
+          scope_val != NULL &&
+                  fl_value_get_type(scope_val) == FL_VALUE_TYPE_STRING
+              ? fl_value_get_string(scope_val)
+              : NULL));
+
+  guint capture_fd_budget = 0;
+  FlValue* evidence_val =
+      fl_value_lookup_string(options, "requireCaptureEvidence");
+  if (evidence_val != NULL && fl_value_get_type(evidence_val) == FL_VALUE_TYPE_BOOL &&
+      fl_value_get_bool(evidence_val)) {
+    capture_fd_budget = 256;
+    FlValue* budget_val = fl_value_lookup_string(options, "captureFdBudget");
+    if (budget_val != NULL && fl_value_get_type(budget_val) == FL_VALUE_TYPE_INT) {
+      gint64 val = fl_value_get_int(budget_val);
+      if (val > 0) capture_fd_budget = (guint)val;
+    }
+  }
+  display_detection_set_capture_fd_budget(self->detection, capture_fd_budget);
+
+  FlValue* libraries_val = fl_value_lookup_string(options, "matchLibraries");
+  display_detection_set_library_signatures(
+      self->detection, libraries_val != NULL &&
+                           fl_value_get_type(libraries_val) == FL_VALUE_TYPE_BOOL &&
+                           fl_value_get_bool(libraries_val));
+
+  guint slice_budget_us = 0;
+  FlValue* slice_val = fl_value_lookup_string(options, "scanSliceBudgetUs");
+  if (slice_val != NULL && fl_value_get_type(slice_val) == FL_VALUE_TYPE_INT) {
+    gint64 val = fl_value_get_int(slice_val);
+    if (val > 0) slice_budget_us = (guint)val;
+  }
+  display_detection_set_scan_slice_budget(self->detection, slice_budget_us);
+
+  guint scan_threads = 1;
+  FlValue* threads_val = fl_value_lookup_string(options, "scanThreads");
+  if (threads_val != NULL && fl_value_get_type(threads_val) == FL_VALUE_TYPE_INT) {
+    gint64 val = fl_value_get_int(threads_val);
+    if (val > 1) scan_threads = (guint)val;
+  }
+  display_detection_set_scan_threads(self->detection, scan_threads);
+
+  guint connector_interval_ms = 0;
+  FlValue* connector_val =
+      fl_value_lookup_string(options, "connectorPollingIntervalMs");
+  if (connector_val != NULL &&
+      fl_value_get_type(connector_val) == FL_VALUE_TYPE_INT) {
+    gint64 val = fl_value_get_int(connector_val);
+    if (val > 0) connector_interval_ms = (guint)val;
+  }
+  guint process_interval_ms = 0;
+  FlValue* process_val =
+      fl_value_lookup_string(options, "processPollingIntervalMs");
+  if (process_val != NULL &&
+      fl_value_get_type(process_val) == FL_VALUE_TYPE_INT) {
+    gint64 val = fl_value_get_int(process_val);
+    if (val > 0) process_interval_ms = (guint)val;
+  }
+  display_detection_set_probe_intervals(self->detection, connector_interval_ms,
+                                        process_interval_ms);
+
+  state_export_free(self->state_export);
+  self->state_export = NULL;
+  FlValue* export_val = fl_value_lookup_string(options, "stateExportName");
+  if (export_val != NULL &&
+      fl_value_get_type(export_val) == FL_VALUE_TYPE_STRING) {
+    self->state_export = state_export_new(fl_value_get_string(export_val));
+    publish_state(self);
+  }
+
+  display_detection_set_metrics(self->detection, NULL);
+  metrics_export_free(self->metrics_export);
+  self->metrics_export = NULL;
+  FlValue* socket_val = fl_value_lookup_string(options, "metricsSocketPath");
+  FlValue* textfile_val = fl_value_lookup_string(options, "metricsTextfilePath");
+  const gchar* metrics_socket_path =
+      socket_val != NULL && fl_value_get_type(socket_val) == FL_VALUE_TYPE_STRING
+          ? fl_value_get_string(socket_val)
+          : NULL;
+  const gchar* metrics_textfile_path =
+      textfile_val != NULL &&
+              fl_value_get_type(textfile_val) == FL_VALUE_TYPE_STRING
+          ? fl_value_get_string(textfile_val)
+          : NULL;
+  if (metrics_socket_path != NULL || metrics_textfile_path != NULL) {
+    self->metrics_export =
+        metrics_export_new(metrics_socket_path, metrics_textfile_path);
+    display_detection_set_metrics(self->detection, self->metrics_export);
+    publish_state(self);
+  }
+
+  state_journal_free(self->state_journal);
+  self->state_journal = NULL;
+  FlValue* journal_val = fl_value_lookup_string(options, "journalPath");
+  if (journal_val != NULL &&
+      fl_value_get_type(journal_val) == FL_VALUE_TYPE_STRING) {
+    guint journal_capacity = 4096;
+    FlValue* capacity_val = fl_value_lookup_string(options, "journalCapacity");
+    if (capacity_val != NULL &&
+        fl_value_get_type(capacity_val) == FL_VALUE_TYPE_INT) {
+      gint64 val = fl_value_get_int(capacity_val);
+      if (val > 0) journal_capacity = (guint)MIN(val, G_MAXUINT32);
+    }
+    self->state_journal =
+        state_journal_new(fl_value_get_string(journal_val), journal_capacity);
+  }
+
+  display_detection_set_probe_trace(self->detection, NULL);
+  probe_trace_writer_free(self->probe_trace);
+  self->probe_trace = NULL;
+  FlValue* trace_val = fl_value_lookup_string(options, "probeTracePath");
+  if (trace_val != NULL &&
+      fl_value_get_type(trace_val) == FL_VALUE_TYPE_STRING) {
+    self->probe_trace = probe_trace_writer_new(fl_value_get_string(trace_val));
+    display_detection_set_probe_trace(self->detection, self->probe_trace);
+  }
+
+  FlValue* low_power_val = fl_value_lookup_string(options, "lowPower");
+  self->low_power = low_power_val != NULL &&
+                    fl_value_get_type(low_power_val) == FL_VALUE_TYPE_BOOL &&
+                    fl_value_get_bool(low_power_val);
+  display_detection_set_low_power(self->detection, self->low_power);
+
+  FlValue* await_val = fl_value_lookup_string(options, "awaitFirstScan");
+  display_detection_set_await_first_scan(
+      self->detection,
+      await_val != NULL && fl_value_get_type(await_val) == FL_VALUE_TYPE_BOOL &&
+          fl_value_get_bool(await_val));
+
+  FlValue* share_val = fl_value_lookup_string(options, "shareDetector");
+  self->share_detector =
+      share_val != NULL && fl_value_get_type(share_val) == FL_VALUE_TYPE_BOOL &&
+      fl_value_get_bool(share_val);
+
+  // Fixture roots used by tests and the latency benchmark.
+  FlValue* proc_root_val = fl_value_lookup_string(options, "procRoot");
+  display_detection_set_proc_root(
+      self->detection,
+      proc_root_val != NULL &&
+              fl_value_get_type(proc_root_val) == FL_VALUE_TYPE_STRING
+          ? fl_value_get_string(proc_root_val)
+          : NULL);
+  FlValue* drm_root_val = fl_value_lookup_string(options, "drmRoot");
+  display_detection_set_drm_root(
+      self->detection,
+      drm_root_val != NULL &&
+              fl_value_get_type(drm_root_val) == FL_VALUE_TYPE_STRING
+          ? fl_value_get_string(drm_root_val)
+          : NULL);
+}
+
+// Maps startListening's "fields" list of MirrorField names to a
+// DisplayDetectionField mask. Every field is subscribed when it is absent.
+static guint parse_fields(FlValue* fields_val) {
+  if (fields_val == NULL || fl_value_get_type(fields_val) != FL_VALUE_TYPE_LIST)
+    return DISPLAY_DETECTION_FIELDS_ALL;
+
+  guint fields = 0;
+  for (size_t i = 0; i < fl_value_get_length(fields_val); i++) {
+    FlValue* item = fl_value_get_list_value(fields_val, i);
+    if (fl_value_get_type(item) == FL_VALUE_TYPE_STRING) {
+      fields |= display_detection_field_from_name(fl_value_get_string(item));
+    }
+  }
+  return fields;
+}
+
 static void handle_method_call(FlMethodChannel* channel,
                                FlMethodCall* method_call,
                                gpointer user_data) {
@@ -99,11 +519,33 @@ static void handle_method_call(FlMethodChannel* channel,
           custom_processes[custom_count] = NULL;
         }
       }
+
+      if (!self->is_listening) {
+        apply_linux_scan_options(
+            self, fl_value_lookup_string(args, "linuxScanOptions"));
+      }
+
+      gint max_events_per_second = 1;
+      FlValue* rate_val = fl_value_lookup_string(args, "maxEventsPerSecond");
+      if (rate_val != NULL && fl_value_get_type(rate_val) == FL_VALUE_TYPE_INT) {
+        gint64 val = fl_value_get_int(rate_val);
+        if (val >= 0) max_events_per_second = (gint)MIN(val, G_MAXINT);
+      }
+      self->outbox->set_max_events_per_second(max_events_per_second);
+
+      // Applies right away, so calling startListening again while listening
+      // subscribes to more (or fewer) fields without a restart. The shared
+      // detector keeps probing everything.
+      if (self->session_service == NULL) {
+        display_detection_set_fields(
+            self->detection,
+            parse_fields(fl_value_lookup_string(args, "fields")));
+      }
     }
 
     if (!self->is_listening) {
       self->is_listening = TRUE;
-      display_detection_start(self->detection, poll_interval_ms, custom_processes);
+      start_listening(self, poll_interval_ms, custom_processes);
     }
 
     g_free(custom_processes);
@@ -111,10 +553,19 @@ static void handle_method_call(FlMethodChannel* channel,
     g_autoptr(FlValue) msg = fl_value_new_string("Listening started");
     response = FL_METHOD_RESPONSE(fl_method_success_response_new(msg));
 
+  } else if (g_strcmp0(method, "updateConfig") == 0) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    if (self->is_listening && args != NULL &&
+        fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+      update_config(self, args);
+    }
+    g_autoptr(FlValue) msg = fl_value_new_string("Config updated");
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(msg));
+
   } else if (g_strcmp0(method, "stopListening") == 0) {
     if (self->is_listening) {
       self->is_listening = FALSE;
-      display_detection_stop(self->detection);
+      stop_listening(self);
     }
     g_autoptr(FlValue) msg = fl_value_new_string("Listening stopped");
     response = FL_METHOD_RESPONSE(fl_method_success_response_new(msg));
@@ -130,16 +581,43 @@ static void handle_method_call(FlMethodChannel* channel,
 // Event channel (stream) handler
 // ---------------------------------------------------------------------------
 
+static void deliver_pending(NoScreenMirrorPlugin* self) {
+  if (self->event_sink == NULL) return;
+  guint64 coalesced = self->outbox->coalesced();
+  if (self->outbox->TakePending(g_get_monotonic_time(), self->event_json)) {
+    g_autoptr(FlValue) value = fl_value_new_string(self->event_json->c_str());
+    fl_event_sink_success(self->event_sink, value, NULL);
+    metrics_export_record_event(self->metrics_export, coalesced);
+  }
+}
+
 static gboolean stream_tick(gpointer user_data) {
   NoScreenMirrorPlugin* self = NO_SCREEN_MIRROR_PLUGIN(user_data);
+  self->stream_timer_id = 0;
+  metrics_export_record_wakeup(self->metrics_export);
+  deliver_pending(self);
+  return G_SOURCE_REMOVE;
+}
 
-  if (self->has_pending_event && self->event_sink != NULL) {
-    g_autoptr(FlValue) value = fl_value_new_string(self->last_event_json);
-    fl_event_sink_success(self->event_sink, value, NULL);
-    self->has_pending_event = FALSE;
-  }
+// Sends the pending event now if the rate limit allows, otherwise once it
+// does; changes until then replace it.
+static void schedule_delivery(NoScreenMirrorPlugin* self) {
+  if (self->event_sink == NULL || self->stream_timer_id != 0) return;
 
-  return G_SOURCE_CONTINUE;
+  gint64 now_us = g_get_monotonic_time();
+  gint64 take_at_us = self->outbox->NextTakeUs(now_us);
+  if (take_at_us <= now_us) {
+    deliver_pending(self);
+    return;
+  }
+  if (self->low_power) {
+    self->stream_timer_id = g_timeout_add_seconds(
+        (guint)((take_at_us - now_us + G_USEC_PER_SEC - 1) / G_USEC_PER_SEC),
+        stream_tick, self);
+    return;
+  }
+  self->stream_timer_id = g_timeout_add(
+      (guint)((take_at_us - now_us + 999) / 1000), stream_tick, self);
 }
 
 static FlMethodErrorResponse* on_listen(FlEventChannel* channel,
@@ -149,9 +627,9 @@ static FlMethodErrorResponse* on_listen(FlEventChannel* channel,
   NoScreenMirrorPlugin* self = NO_SCREEN_MIRROR_PLUGIN(user_data);
   self->event_sink = event_sink;
 
-  if (self->stream_timer_id == 0) {
-    self->stream_timer_id = g_timeout_add(1000, stream_tick, self);
-  }
+  // The current (possibly provisional) state goes out right away; later
+  // changes are sent as they are recorded.
+  deliver_pending(self);
 
   return NULL;
 }
@@ -181,15 +659,47 @@ static void no_screen_mirror_plugin_dispose(GObject* object) {
     g_source_remove(self->stream_timer_id);
     self->stream_timer_id = 0;
   }
+  if (self->state_save_id != 0) {
+    g_source_remove(self->state_save_id);
+    self->state_save_id = 0;
+    save_state(self);
+  }
 
   g_clear_object(&self->method_channel);
   g_clear_object(&self->event_channel);
 
+  g_cancellable_cancel(self->session_bus_cancel);
+  g_clear_object(&self->session_bus_cancel);
+  session_service_free(self->session_service);
+  self->session_service = NULL;
+
   display_detection_free(self->detection);
   self->detection = NULL;
 
-  g_free(self->last_event_json);
-  self->last_event_json = NULL;
+  state_export_free(self->state_export);
+  self->state_export = NULL;
+
+  metrics_export_free(self->metrics_export);
+  self->metrics_export = NULL;
+
+  state_journal_free(self->state_journal);
+  self->state_journal = NULL;
+
+  probe_trace_writer_free(self->probe_trace);
+  self->probe_trace = NULL;
+
+  g_strfreev(self->custom_processes);
+  self->custom_processes = NULL;
+
+  g_free(self->state_cache_path);
+  self->state_cache_path = NULL;
+  g_free(self->boot_id);
+  self->boot_id = NULL;
+
+  delete self->outbox;
+  self->outbox = NULL;
+  delete self->event_json;
+  self->event_json = NULL;
 
   G_OBJECT_CLASS(no_screen_mirror_plugin_parent_class)->dispose(object);
 }
@@ -200,11 +710,23 @@ static void no_screen_mirror_plugin_class_init(NoScreenMirrorPluginClass* klass)
 
 static void no_screen_mirror_plugin_init(NoScreenMirrorPlugin* self) {
   self->is_listening = FALSE;
-  self->last_event_json = NULL;
-  self->has_pending_event = FALSE;
+  self->outbox = new no_screen_mirror::EventOutbox();
+  self->event_json = new std::string();
   self->stream_timer_id = 0;
+  self->low_power = FALSE;
   self->event_sink = NULL;
   self->detection = NULL;
+  self->state_export = NULL;
+  self->metrics_export = NULL;
+  self->state_journal = NULL;
+  self->probe_trace = NULL;
+  self->state_cache_path = state_cache_default_path();
+  self->boot_id = state_cache_read_boot_id();
+  self->state_save_id = 0;
+  self->share_detector = FALSE;
+  self->session_service = NULL;
+  self->poll_interval_ms = 2000;
+  self->custom_processes = NULL;
 }
 
 // ---------------------------------------------------------------------------
@@ -218,8 +740,10 @@ void no_screen_mirror_plugin_register_with_registrar(
 
   self->registrar = registrar;
 
-  // Display detection subsystem
+  // Display detection subsystem. The first scan runs after the
+  // startListening reply unless LinuxScanOptions.awaitFirstScan is set.
   self->detection = display_detection_new(on_display_changed, self);
+  display_detection_set_await_first_scan(self->detection, FALSE);
 
   // Method channel
   g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
@@ -240,8 +764,8 @@ void no_screen_mirror_plugin_register_with_registrar(
                                        on_cancel, g_object_ref(self),
                                        g_object_unref);
 
-  // Initial state push
-  update_shared_state(self, FALSE, 1, FALSE);
+  // Initial state push: what this boot last saw, until a scan confirms it
+  restore_cached_state(self);
 
   g_object_unref(self);
 }
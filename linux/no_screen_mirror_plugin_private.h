@@ -3,7 +3,16 @@
 
 #include <flutter_linux/flutter_linux.h>
 
+#include <string>
+
 #include "display_detection.h"
+#include "event_outbox.h"
+#include "metrics_export.h"
+#include "probe_trace.h"
+#include "session_service.h"
+#include "state_cache.h"
+#include "state_export.h"
+#include "state_journal.h"
 
 G_BEGIN_DECLS
 
@@ -17,20 +26,46 @@ struct _NoScreenMirrorPlugin {
   // State
   gboolean is_listening;
 
-  // Event stream
-  gchar* last_event_json;
-  gboolean has_pending_event;
+  // Event stream: the state waiting to be sent, and the buffer it is encoded
+  // into. stream_timer_id is pending while the rate limit holds an event back;
+  // in low-power mode it is a whole-second timer aligned with the detector's.
+  no_screen_mirror::EventOutbox* outbox;
+  std::string* event_json;
   guint stream_timer_id;
+  gboolean low_power;
   FlEventSink* event_sink;
 
   // Display detection
   DisplayDetection* detection;
-};
 
-gchar* build_mirror_event_json(gboolean is_screen_mirrored,
-                               gboolean is_external_display_connected,
-                               gint display_count,
-                               gboolean is_screen_shared);
+  // Shared memory copy of the state for other processes, or NULL.
+  StateExport* state_export;
+
+  // Prometheus metrics endpoint, or NULL.
+  MetricsExport* metrics_export;
+
+  // On-disk ring of state transitions for post-mortem analysis, or NULL.
+  StateJournal* state_journal;
+
+  // Record of every probe read for nsm-replay, or NULL.
+  ProbeTraceWriter* probe_trace;
+
+  // Where the last committed state is kept for the next launch, and the
+  // boot it is tagged with (NULL if unknown, which disables the cache).
+  // state_save_id is pending while a save is coalescing changes.
+  gchar* state_cache_path;
+  gchar* boot_id;
+  guint state_save_id;
+
+  // Shared detector mode: the session bus service deciding whether this
+  // instance scans, and the startListening() arguments for when it does.
+  // The bus connection is set up asynchronously under |session_bus_cancel|.
+  gboolean share_detector;
+  GCancellable* session_bus_cancel;
+  SessionService* session_service;
+  guint poll_interval_ms;
+  gchar** custom_processes;
+};
 
 G_END_DECLS
 
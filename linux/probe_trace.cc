@@ -0,0 +1,246 @@
+#include "probe_trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const gchar kTraceMagic[] = "nsm-probe-trace 1";
+
+static const gchar kProbeTags[] = {'C', 'P'};
+
+// File each probe reads inside an entry's directory.
+static const gchar* const kProbeFiles[] = {"status", "comm"};
+
+struct _ProbeTraceWriter {
+  FILE* file;
+  GMutex mutex;
+  // Start of the trace, set by the first tick.
+  gboolean started;
+  gint64 start_us;
+  // What each probe read on its previous tick, and what its current tick
+  // read so far (NULL between ticks): key -> value, both owned.
+  GHashTable* previous[2];
+  GHashTable* current[2];
+  gint64 tick_us[2];
+  // Stamp of the last tick written.
+  gint64 written_us;
+};
+
+struct _ProbeTraceReader {
+  FILE* file;
+  // Header line of the next tick, read ahead while finishing the previous
+  // one.
+  gchar* line;
+  size_t line_size;
+  gboolean at_tick;
+  guint64 change_count;
+};
+
+static GHashTable* new_table(void) {
+  return g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+}
+
+ProbeTraceWriter* probe_trace_writer_new(const gchar* path) {
+  if (path == NULL) return NULL;
+  FILE* file = fopen(path, "we");
+  if (file == NULL) return NULL;
+  fprintf(file, "%s\n", kTraceMagic);
+
+  ProbeTraceWriter* self = g_new0(ProbeTraceWriter, 1);
+  self->file = file;
+  g_mutex_init(&self->mutex);
+  self->previous[PROBE_TRACE_CONNECTORS] = new_table();
+  self->previous[PROBE_TRACE_PROCESSES] = new_table();
+  return self;
+}
+
+void probe_trace_writer_begin_tick(ProbeTraceWriter* self,
+                                   ProbeTraceProbe probe,
+                                   gint64 monotonic_us) {
+  if (self == NULL) return;
+  g_mutex_lock(&self->mutex);
+  if (!self->started) {
+    self->started = TRUE;
+    self->start_us = monotonic_us;
+  }
+  if (self->current[probe] != NULL) g_hash_table_unref(self->current[probe]);
+  self->current[probe] = new_table();
+  self->tick_us[probe] = monotonic_us - self->start_us;
+  g_mutex_unlock(&self->mutex);
+}
+
+void probe_trace_writer_add(ProbeTraceWriter* self,
+                            ProbeTraceProbe probe,
+                            const gchar* key,
+                            const gchar* value) {
+  if (self == NULL) return;
+  g_mutex_lock(&self->mutex);
+  if (self->current[probe] != NULL) {
+    g_hash_table_replace(self->current[probe], g_strdup(key), g_strdup(value));
+  }
+  g_mutex_unlock(&self->mutex);
+}
+
+void probe_trace_writer_end_tick(ProbeTraceWriter* self,
+                                 ProbeTraceProbe probe) {
+  if (self == NULL) return;
+  g_mutex_lock(&self->mutex);
+  GHashTable* current = self->current[probe];
+  if (current == NULL) {
+    g_mutex_unlock(&self->mutex);
+    return;
+  }
+
+  // A sliced walk ends after ticks of the other probe that began later.
+  self->written_us = MAX(self->written_us, self->tick_us[probe]);
+  GHashTable* previous = self->previous[probe];
+  GString* lines = g_string_new(NULL);
+  g_string_append_printf(lines, "%c %" G_GINT64_FORMAT "\n",
+                         kProbeTags[probe], self->written_us);
+  GHashTableIter iter;
+  gpointer key, value;
+  g_hash_table_iter_init(&iter, current);
+  while (g_hash_table_iter_next(&iter, &key, &value)) {
+    const gchar* before = (const gchar*)g_hash_table_lookup(previous, key);
+    if (g_strcmp0(before, (const gchar*)value) == 0) continue;
+    g_autofree gchar* escaped = g_strescape((const gchar*)value, NULL);
+    g_string_append_printf(lines, "+%s %s\n", (const gchar*)key, escaped);
+  }
+  g_hash_table_iter_init(&iter, previous);
+  while (g_hash_table_iter_next(&iter, &key, NULL)) {
+    if (!g_hash_table_contains(current, key)) {
+      g_string_append_printf(lines, "-%s\n", (const gchar*)key);
+    }
+  }
+  // One write per tick; a crash loses at most the tick in progress.
+  fwrite(lines->str, 1, lines->len, self->file);
+  fflush(self->file);
+  g_string_free(lines, TRUE);
+
+  g_hash_table_unref(previous);
+  self->previous[probe] = current;
+  self->current[probe] = NULL;
+  g_mutex_unlock(&self->mutex);
+}
+
+void probe_trace_writer_abort_tick(ProbeTraceWriter* self,
+                                   ProbeTraceProbe probe) {
+  if (self == NULL) return;
+  g_mutex_lock(&self->mutex);
+  if (self->current[probe] != NULL) {
+    g_hash_table_unref(self->current[probe]);
+    self->current[probe] = NULL;
+  }
+  g_mutex_unlock(&self->mutex);
+}
+
+void probe_trace_writer_free(ProbeTraceWriter* self) {
+  if (self == NULL) return;
+  fclose(self->file);
+  g_mutex_clear(&self->mutex);
+  g_hash_table_unref(self->previous[PROBE_TRACE_CONNECTORS]);
+  g_hash_table_unref(self->previous[PROBE_TRACE_PROCESSES]);
+  if (self->current[PROBE_TRACE_CONNECTORS] != NULL) {
+    g_hash_table_unref(self->current[PROBE_TRACE_CONNECTORS]);
+  }
+  if (self->current[PROBE_TRACE_PROCESSES] != NULL) {
+    g_hash_table_unref(self->current[PROBE_TRACE_PROCESSES]);
+  }
+  g_free(self);
+}
+
+static gboolean read_line(ProbeTraceReader* self) {
+  ssize_t length = getline(&self->line, &self->line_size, self->file);
+  if (length <= 0) return FALSE;
+  if (self->line[length - 1] == '\n') self->line[length - 1] = '\0';
+  return TRUE;
+}
+
+ProbeTraceReader* probe_trace_reader_new(const gchar* path) {
+  if (path == NULL) return NULL;
+  FILE* file = fopen(path, "re");
+  if (file == NULL) return NULL;
+
+  ProbeTraceReader* self = g_new0(ProbeTraceReader, 1);
+  self->file = file;
+  if (!read_line(self) || strcmp(self->line, kTraceMagic) != 0) {
+    probe_trace_reader_free(self);
+    return NULL;
+  }
+  self->at_tick = read_line(self);
+  return self;
+}
+
+// Makes <root>/<key>/<file> hold |value|, or removes the entry when |value|
+// is NULL.
+static gboolean apply_change(const gchar* root, const gchar* file,
+                             const gchar* key, const gchar* value) {
+  // Keys become path components.
+  if (key[0] == '\0' || strchr(key, '/') != NULL || key[0] == '.') {
+    return FALSE;
+  }
+  g_autofree gchar* dir = g_build_filename(root, key, NULL);
+  g_autofree gchar* path = g_build_filename(dir, file, NULL);
+  if (value == NULL) {
+    unlink(path);
+    rmdir(dir);
+    return TRUE;
+  }
+  g_mkdir_with_parents(dir, 0755);
+  // Both files end in a newline, which the probes strip.
+  g_autofree gchar* contents = g_strconcat(value, "\n", NULL);
+  return g_file_set_contents(path, contents, -1, NULL);
+}
+
+gboolean probe_trace_reader_next(ProbeTraceReader* self,
+                                 const gchar* proc_root,
+                                 const gchar* drm_root,
+                                 ProbeTraceProbe* out_probe,
+                                 gint64* out_offset_us) {
+  if (self == NULL || !self->at_tick) return FALSE;
+
+  ProbeTraceProbe probe;
+  if (self->line[0] == kProbeTags[PROBE_TRACE_CONNECTORS]) {
+    probe = PROBE_TRACE_CONNECTORS;
+  } else if (self->line[0] == kProbeTags[PROBE_TRACE_PROCESSES]) {
+    probe = PROBE_TRACE_PROCESSES;
+  } else {
+    return FALSE;
+  }
+  if (self->line[1] != ' ') return FALSE;
+  *out_probe = probe;
+  *out_offset_us = g_ascii_strtoll(self->line + 2, NULL, 10);
+  const gchar* root = probe == PROBE_TRACE_CONNECTORS ? drm_root : proc_root;
+
+  while ((self->at_tick = read_line(self))) {
+    gchar* line = self->line;
+    if (line[0] != '+' && line[0] != '-') break;
+    gchar* value = NULL;
+    if (line[0] == '+') {
+      gchar* space = strchr(line, ' ');
+      if (space == NULL) return FALSE;
+      *space = '\0';
+      value = space + 1;
+    }
+    g_autofree gchar* unescaped = value != NULL ? g_strcompress(value) : NULL;
+    if (!apply_change(root, kProbeFiles[probe], line + 1, unescaped)) {
+      return FALSE;
+    }
+    self->change_count++;
+  }
+  return TRUE;
+}
+
+guint64 probe_trace_reader_get_change_count(ProbeTraceReader* self) {
+  if (self == NULL) return 0;
+  return self->change_count;
+}
+
+void probe_trace_reader_free(ProbeTraceReader* self) {
+  if (self == NULL) return;
+  fclose(self->file);
+  free(self->line);
+  g_free(self);
+}
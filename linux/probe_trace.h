@@ -0,0 +1,90 @@
+#ifndef PROBE_TRACE_H_
+#define PROBE_TRACE_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// Records what the connector and process probes read on each tick into a
+// trace file, and plays such a trace back into fixture directories, so a
+// field recording can be replayed through DisplayDetection deterministically
+// and faster than real time.
+//
+// A trace is a text file: a "nsm-probe-trace 1" line, then one header line
+// per tick ("C <us>" for connectors, "P <us>" for processes, in microseconds
+// since the first tick) followed by what changed since that probe's previous
+// tick: "+<key> <value>" for an entry that appeared or changed, "-<key>" for
+// one that disappeared. Keys are connector directory names
+// (card0-HDMI-A-1) or PIDs; values are the connector status or comm,
+// escaped with g_strescape(). Process tables barely change between ticks,
+// so most ticks are a single line.
+//
+// Each probe has its own tick in progress, so a sliced /proc walk can span a
+// connector tick. Ticks are written in the order they end, stamped with the
+// time they began or, if later, the previous tick's stamp, so offsets never
+// go backwards.
+//
+// Only the connector status files and /proc/<pid>/comm are recorded; app
+// scopes, capture evidence and mapped libraries are not. A walk that stops
+// at its first match records the processes it did not reach as gone, which
+// replays to the same result. Sharer exits are not recorded either, so
+// DisplayDetection stops watching them, and stops skipping walks while a
+// sharer is watched, for as long as a writer is attached.
+typedef enum {
+  PROBE_TRACE_CONNECTORS,
+  PROBE_TRACE_PROCESSES,
+} ProbeTraceProbe;
+
+typedef struct _ProbeTraceWriter ProbeTraceWriter;
+
+// Creates or truncates the trace at |path|. Returns NULL if it cannot be
+// written.
+ProbeTraceWriter* probe_trace_writer_new(const gchar* path);
+
+// Starts the tick of |probe| at |monotonic_us|, discarding one still in
+// progress. Every writer function ignores a NULL |writer|.
+void probe_trace_writer_begin_tick(ProbeTraceWriter* writer,
+                                   ProbeTraceProbe probe,
+                                   gint64 monotonic_us);
+
+// Records that |probe|'s current tick read |value| for |key|. Thread-safe,
+// for sharded walks.
+void probe_trace_writer_add(ProbeTraceWriter* writer,
+                            ProbeTraceProbe probe,
+                            const gchar* key,
+                            const gchar* value);
+
+// Writes the changes of |probe|'s current tick to the file.
+void probe_trace_writer_end_tick(ProbeTraceWriter* writer,
+                                 ProbeTraceProbe probe);
+
+// Drops |probe|'s current tick without writing it, for a walk that was
+// abandoned part way; the next tick is compared with the last one written.
+void probe_trace_writer_abort_tick(ProbeTraceWriter* writer,
+                                   ProbeTraceProbe probe);
+
+void probe_trace_writer_free(ProbeTraceWriter* writer);
+
+typedef struct _ProbeTraceReader ProbeTraceReader;
+
+// Opens the trace at |path|. Returns NULL if it is not a probe trace.
+ProbeTraceReader* probe_trace_reader_new(const gchar* path);
+
+// Reads the next tick and applies its changes to |proc_root|
+// (<pid>/comm) or |drm_root| (<connector>/status), which then hold what the
+// probe read at that tick. Stores the probe and the tick's time offset.
+// Returns FALSE at the end of the trace or on a malformed line.
+gboolean probe_trace_reader_next(ProbeTraceReader* reader,
+                                 const gchar* proc_root,
+                                 const gchar* drm_root,
+                                 ProbeTraceProbe* out_probe,
+                                 gint64* out_offset_us);
+
+// Lines applied so far that changed an entry, for reporting.
+guint64 probe_trace_reader_get_change_count(ProbeTraceReader* reader);
+
+void probe_trace_reader_free(ProbeTraceReader* reader);
+
+G_END_DECLS
+
+#endif  // PROBE_TRACE_H_
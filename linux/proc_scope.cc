@@ -0,0 +1,67 @@
+#include "proc_scope.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct _ProcScope {
+  uid_t uid;
+  gchar* session_id;  // NULL for any session
+};
+
+// /proc/<pid>/sessionid is a decimal number, 4294967295 when unset.
+static gboolean read_session_id(int dir_fd, const gchar* path,
+                                gchar* out, gsize size) {
+  int fd = openat(dir_fd, path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return FALSE;
+  ssize_t length = read(fd, out, size - 1);
+  close(fd);
+  if (length <= 0) return FALSE;
+  out[length] = '\0';
+  g_strstrip(out);
+  return out[0] != '\0' && g_strcmp0(out, "4294967295") != 0;
+}
+
+ProcScope* proc_scope_new(uid_t uid, const gchar* session_id) {
+  ProcScope* self = g_new0(ProcScope, 1);
+  self->uid = uid;
+  self->session_id = g_strdup(session_id);
+  return self;
+}
+
+gchar* proc_scope_get_own_session_id(void) {
+  gchar session_id[32];
+  if (!read_session_id(AT_FDCWD, "/proc/self/sessionid", session_id,
+                       sizeof(session_id))) {
+    return NULL;
+  }
+  return g_strdup(session_id);
+}
+
+gboolean proc_scope_contains(ProcScope* self, int proc_fd, const gchar* name) {
+  if (self == NULL) return TRUE;
+
+  struct stat info;
+  if (fstatat(proc_fd, name, &info, 0) != 0) return FALSE;
+  if (info.st_uid != self->uid) return FALSE;
+
+  gchar path[64];
+  if (info.st_uid == 0) {
+    g_snprintf(path, sizeof(path), "%s/exe", name);
+    gchar target[1];
+    if (readlinkat(proc_fd, path, target, sizeof(target)) < 0) return FALSE;
+  }
+
+  if (self->session_id == NULL) return TRUE;
+  g_snprintf(path, sizeof(path), "%s/sessionid", name);
+  gchar session_id[32];
+  return read_session_id(proc_fd, path, session_id, sizeof(session_id)) &&
+         g_strcmp0(session_id, self->session_id) == 0;
+}
+
+void proc_scope_free(ProcScope* self) {
+  if (self == NULL) return;
+  g_free(self->session_id);
+  g_free(self);
+}
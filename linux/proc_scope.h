@@ -0,0 +1,38 @@
+#ifndef PROC_SCOPE_H_
+#define PROC_SCOPE_H_
+
+#include <glib.h>
+#include <sys/types.h>
+
+G_BEGIN_DECLS
+
+// Narrows a /proc walk to the processes that could be sharing the user's
+// screen, before anything is read from them.
+//
+// An entry is kept when its /proc/<pid> directory, which the kernel gives the
+// process's effective owner, belongs to the scope's user: one fstatat() that
+// also drops other users' processes and, for non-root users, every kernel
+// thread. Root-owned entries are additionally checked for an exe link, which
+// kernel threads lack. A scope can further be limited to one logind session,
+// compared through /proc/<pid>/sessionid (logind reuses the audit session
+// ID); processes started by the systemd user manager carry the manager's
+// session, not the login's.
+typedef struct _ProcScope ProcScope;
+
+// Keeps processes owned by |uid| and, unless |session_id| is NULL, in that
+// session.
+ProcScope* proc_scope_new(uid_t uid, const gchar* session_id);
+
+// The calling process's session ID, or NULL if it has none (no audit
+// support, or not started from a login session). Free with g_free().
+gchar* proc_scope_get_own_session_id(void);
+
+// Whether the process whose directory is |name| under |proc_fd| (an open
+// /proc-like directory) is in scope. Thread-safe.
+gboolean proc_scope_contains(ProcScope* scope, int proc_fd, const gchar* name);
+
+void proc_scope_free(ProcScope* scope);
+
+G_END_DECLS
+
+#endif  // PROC_SCOPE_H_
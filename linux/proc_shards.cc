@@ -0,0 +1,230 @@
+#include "proc_shards.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "batched_reads.h"
+
+typedef struct {
+  guint index;
+  // Range of the sorted PID listing handled by this shard.
+  guint begin;
+  guint end;
+  GArray* matches;  // guint PIDs, ascending
+  guint examined;
+} Shard;
+
+struct _ProcShards {
+  gchar* proc_root;
+  guint thread_count;
+  // NULL with a single thread, which scans on the calling thread.
+  GThreadPool* pool;
+  // Not owned; NULL lists every process.
+  ProcScope* scope;
+  // One reader and one shard per thread; a shard only ever runs on one worker
+  // at a time, so its reader needs no locking.
+  BatchedReads** readers;
+  Shard* shards;
+
+  // State of the scan in flight, read-only for workers.
+  GArray* pids;
+  int proc_fd;  // -1 without a scope
+  ProcShardsMatchFunc match_func;
+  gpointer user_data;
+  gboolean stop_at_first_match;
+  gint cancelled;
+
+  GMutex lock;
+  GCond done;
+  guint pending;
+};
+
+typedef struct {
+  ProcShards* self;
+  Shard* shard;
+  const guint* pids;
+} ShardBatch;
+
+static void on_comm_read(guint index, const gchar* contents,
+                         gpointer user_data) {
+  ShardBatch* batch = (ShardBatch*)user_data;
+  ProcShards* self = batch->self;
+  if (contents == NULL || g_atomic_int_get(&self->cancelled)) return;
+
+  gchar comm[BATCHED_READS_MAX_LENGTH + 1];
+  g_strlcpy(comm, contents, sizeof(comm));
+  g_strstrip(comm);
+  batch->shard->examined++;
+
+  if (!self->match_func(batch->pids[index], comm, self->user_data)) return;
+
+  g_array_append_val(batch->shard->matches, batch->pids[index]);
+  if (self->stop_at_first_match) g_atomic_int_set(&self->cancelled, 1);
+}
+
+static void scan_shard(ProcShards* self, Shard* shard) {
+  BatchedReads* reads = self->readers[shard->index];
+  guint batch_size = batched_reads_batch_size(reads);
+  const guint* pids = (const guint*)self->pids->data;
+  gchar* comm_paths[BATCHED_READS_MAX_BATCH];
+  guint batch_pids[BATCHED_READS_MAX_BATCH];
+
+  guint offset = shard->begin;
+  while (offset < shard->end) {
+    if (g_atomic_int_get(&self->cancelled)) return;
+
+    guint count = 0;
+    for (; offset < shard->end && count < batch_size; offset++) {
+      gchar name[16];
+      g_snprintf(name, sizeof(name), "%u", pids[offset]);
+      if (self->scope != NULL &&
+          !proc_scope_contains(self->scope, self->proc_fd, name)) {
+        continue;
+      }
+      batch_pids[count] = pids[offset];
+      comm_paths[count] =
+          g_strdup_printf("%s/%s/comm", self->proc_root, name);
+      count++;
+    }
+    ShardBatch batch = {self, shard, batch_pids};
+    batched_reads_run(reads, (const gchar* const*)comm_paths, count,
+                      on_comm_read, &batch);
+    for (guint i = 0; i < count; i++) g_free(comm_paths[i]);
+  }
+}
+
+static void run_shard(gpointer data, gpointer user_data) {
+  ProcShards* self = (ProcShards*)user_data;
+  scan_shard(self, (Shard*)data);
+
+  g_mutex_lock(&self->lock);
+  if (--self->pending == 0) g_cond_signal(&self->done);
+  g_mutex_unlock(&self->lock);
+}
+
+static gint compare_pids(gconstpointer a, gconstpointer b) {
+  guint pid_a = *(const guint*)a;
+  guint pid_b = *(const guint*)b;
+  return pid_a < pid_b ? -1 : pid_a > pid_b;
+}
+
+// One readdir pass (a handful of getdents64 calls) over the whole table.
+static void list_pids(ProcShards* self) {
+  g_array_set_size(self->pids, 0);
+
+  DIR* dir = opendir(self->proc_root);
+  if (dir == NULL) return;
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != NULL) {
+    if (entry->d_name[0] < '0' || entry->d_name[0] > '9') continue;
+    guint pid = (guint)strtoul(entry->d_name, NULL, 10);
+    g_array_append_val(self->pids, pid);
+  }
+  closedir(dir);
+
+  // readdir order depends on the filesystem; sorting makes shard boundaries,
+  // and so the order of reported matches, independent of it.
+  g_array_sort(self->pids, compare_pids);
+}
+
+ProcShards* proc_shards_new(const gchar* proc_root, guint thread_count) {
+  ProcShards* self = g_new0(ProcShards, 1);
+  self->proc_root = g_strdup(proc_root);
+  self->thread_count = MAX(thread_count, 1);
+  self->readers = g_new0(BatchedReads*, self->thread_count);
+  self->shards = g_new0(Shard, self->thread_count);
+  for (guint i = 0; i < self->thread_count; i++) {
+    self->readers[i] = batched_reads_new(TRUE);
+    self->shards[i].index = i;
+    self->shards[i].matches = g_array_new(FALSE, FALSE, sizeof(guint));
+  }
+  self->pids = g_array_new(FALSE, FALSE, sizeof(guint));
+  self->proc_fd = -1;
+  g_mutex_init(&self->lock);
+  g_cond_init(&self->done);
+  if (self->thread_count > 1) {
+    // Exclusive threads stay alive between polls.
+    self->pool =
+        g_thread_pool_new(run_shard, self, self->thread_count, TRUE, NULL);
+  }
+  return self;
+}
+
+void proc_shards_set_scope(ProcShards* self, ProcScope* scope) {
+  if (self == NULL) return;
+  self->scope = scope;
+}
+
+guint proc_shards_get_thread_count(ProcShards* self) {
+  return self != NULL ? self->thread_count : 0;
+}
+
+guint proc_shards_scan(ProcShards* self, ProcShardsMatchFunc match_func,
+                       gpointer user_data, gboolean stop_at_first_match,
+                       GArray* matches) {
+  if (self == NULL || match_func == NULL) return 0;
+
+  list_pids(self);
+  if (self->scope != NULL) {
+    self->proc_fd = open(self->proc_root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  }
+  self->match_func = match_func;
+  self->user_data = user_data;
+  self->stop_at_first_match = stop_at_first_match;
+  g_atomic_int_set(&self->cancelled, 0);
+
+  guint total = self->pids->len;
+  for (guint i = 0; i < self->thread_count; i++) {
+    Shard* shard = &self->shards[i];
+    shard->begin = (guint)((guint64)total * i / self->thread_count);
+    shard->end = (guint)((guint64)total * (i + 1) / self->thread_count);
+    shard->examined = 0;
+    g_array_set_size(shard->matches, 0);
+  }
+
+  if (self->pool == NULL) {
+    scan_shard(self, &self->shards[0]);
+  } else {
+    self->pending = self->thread_count;
+    for (guint i = 0; i < self->thread_count; i++) {
+      g_thread_pool_push(self->pool, &self->shards[i], NULL);
+    }
+    g_mutex_lock(&self->lock);
+    while (self->pending > 0) g_cond_wait(&self->done, &self->lock);
+    g_mutex_unlock(&self->lock);
+  }
+
+  if (self->proc_fd >= 0) {
+    close(self->proc_fd);
+    self->proc_fd = -1;
+  }
+
+  // Shards cover ascending PID ranges, so concatenating keeps PID order.
+  guint examined = 0;
+  for (guint i = 0; i < self->thread_count; i++) {
+    Shard* shard = &self->shards[i];
+    examined += shard->examined;
+    if (matches != NULL && shard->matches->len > 0) {
+      g_array_append_vals(matches, shard->matches->data, shard->matches->len);
+    }
+  }
+  return examined;
+}
+
+void proc_shards_free(ProcShards* self) {
+  if (self == NULL) return;
+  if (self->pool != NULL) g_thread_pool_free(self->pool, FALSE, TRUE);
+  for (guint i = 0; i < self->thread_count; i++) {
+    batched_reads_free(self->readers[i]);
+    g_array_unref(self->shards[i].matches);
+  }
+  g_free(self->readers);
+  g_free(self->shards);
+  g_array_unref(self->pids);
+  g_mutex_clear(&self->lock);
+  g_cond_clear(&self->done);
+  g_free(self->proc_root);
+  g_free(self);
+}
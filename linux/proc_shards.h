@@ -0,0 +1,44 @@
+#ifndef PROC_SHARDS_H_
+#define PROC_SHARDS_H_
+
+#include <glib.h>
+
+#include "proc_scope.h"
+
+G_BEGIN_DECLS
+
+// Walks a /proc-like directory on a small pool of worker threads.
+//
+// Each scan lists the directory once, sorts the PIDs and splits them into one
+// contiguous shard per thread. Workers drop out-of-scope PIDs, read
+// <pid>/comm for the rest of their shard and report matches; the calling
+// thread blocks until every shard is done.
+typedef struct _ProcShards ProcShards;
+
+// Called from worker threads with the PID and stripped comm of each process;
+// must be thread-safe.
+typedef gboolean (*ProcShardsMatchFunc)(guint pid, const gchar* comm,
+                                        gpointer user_data);
+
+ProcShards* proc_shards_new(const gchar* proc_root, guint thread_count);
+
+guint proc_shards_get_thread_count(ProcShards* shards);
+
+// Only reads processes in |scope|, which stays owned by the caller and is
+// checked on the worker threads; NULL reads every process.
+void proc_shards_set_scope(ProcShards* shards, ProcScope* scope);
+
+// Appends the PID of every process whose comm satisfies |match_func| to
+// |matches| (a GArray of guint), in ascending PID order. With
+// |stop_at_first_match|, every shard stops as soon as any shard finds a
+// match; whether anything matched is still deterministic, but |matches| may
+// then hold more than one PID. Returns the number of processes examined.
+guint proc_shards_scan(ProcShards* shards, ProcShardsMatchFunc match_func,
+                       gpointer user_data, gboolean stop_at_first_match,
+                       GArray* matches);
+
+void proc_shards_free(ProcShards* shards);
+
+G_END_DECLS
+
+#endif  // PROC_SHARDS_H_
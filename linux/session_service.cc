@@ -0,0 +1,293 @@
+#include "session_service.h"
+
+#define SESSION_SERVICE_OBJECT_PATH "/com/flutterplaza/NoScreenMirror"
+#define SESSION_SERVICE_INTERFACE "com.flutterplaza.NoScreenMirror1"
+#define SESSION_SERVICE_STATE_TYPE "(bbibtx)"
+
+static const gchar kIntrospectionXml[] =
+    "<node>"
+    "  <interface name='" SESSION_SERVICE_INTERFACE "'>"
+    "    <method name='GetState'>"
+    "      <arg type='b' name='is_screen_mirrored' direction='out'/>"
+    "      <arg type='b' name='is_external_display_connected' direction='out'/>"
+    "      <arg type='i' name='display_count' direction='out'/>"
+    "      <arg type='b' name='is_screen_shared' direction='out'/>"
+    "      <arg type='t' name='sequence' direction='out'/>"
+    "      <arg type='x' name='detected_at_us' direction='out'/>"
+    "    </method>"
+    "    <signal name='Changed'>"
+    "      <arg type='b' name='is_screen_mirrored'/>"
+    "      <arg type='b' name='is_external_display_connected'/>"
+    "      <arg type='i' name='display_count'/>"
+    "      <arg type='b' name='is_screen_shared'/>"
+    "      <arg type='t' name='sequence'/>"
+    "      <arg type='x' name='detected_at_us'/>"
+    "    </signal>"
+    "  </interface>"
+    "</node>";
+
+struct _SessionService {
+  GDBusConnection* connection;
+  SessionServiceRoleFunc role_changed;
+  SessionServiceStateFunc remote_state;
+  gpointer user_data;
+  SessionServiceRole role;
+
+  guint registration_id;
+  guint owner_id;
+  guint watch_id;
+
+  // Owner: the last published state, returned by GetState.
+  GVariant* state;
+
+  // Subscriber: the Changed subscription on the current owner, the pending
+  // GetState call and the newest sequence number delivered from that owner.
+  guint signal_id;
+  GCancellable* cancellable;
+  guint64 remote_sequence;
+};
+
+static GDBusNodeInfo* get_node_info(void) {
+  static GDBusNodeInfo* node_info = NULL;
+  if (g_once_init_enter(&node_info)) {
+    GDBusNodeInfo* info =
+        g_dbus_node_info_new_for_xml(kIntrospectionXml, NULL);
+    g_once_init_leave(&node_info, info);
+  }
+  return node_info;
+}
+
+static void set_role(SessionService* self, SessionServiceRole role) {
+  if (self->role == role) return;
+  self->role = role;
+  if (self->role_changed != NULL) self->role_changed(role, self->user_data);
+}
+
+// Hands a state received from the owner to the caller, dropping any older
+// than one already delivered (a GetState reply can race a Changed signal).
+static void deliver_remote_state(SessionService* self, GVariant* state) {
+  gboolean mirrored, external, shared;
+  gint display_count;
+  guint64 sequence;
+  gint64 detected_at_us;
+  g_variant_get(state, SESSION_SERVICE_STATE_TYPE, &mirrored, &external,
+                &display_count, &shared, &sequence, &detected_at_us);
+  if (sequence == 0 || sequence <= self->remote_sequence) return;
+  self->remote_sequence = sequence;
+  if (self->remote_state != NULL) {
+    self->remote_state(mirrored, external, display_count, shared, sequence,
+                       detected_at_us, self->user_data);
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Owner side
+// ---------------------------------------------------------------------------
+
+static void handle_method_call(GDBusConnection* connection,
+                               const gchar* sender,
+                               const gchar* object_path,
+                               const gchar* interface_name,
+                               const gchar* method_name,
+                               GVariant* parameters,
+                               GDBusMethodInvocation* invocation,
+                               gpointer user_data) {
+  SessionService* self = (SessionService*)user_data;
+  if (g_strcmp0(method_name, "GetState") != 0) {
+    g_dbus_method_invocation_return_error(
+        invocation, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD,
+        "Unknown method %s", method_name);
+    return;
+  }
+  if (self->state != NULL) {
+    g_dbus_method_invocation_return_value(invocation, self->state);
+  } else {
+    g_dbus_method_invocation_return_value(
+        invocation, g_variant_new(SESSION_SERVICE_STATE_TYPE, FALSE, FALSE, 1,
+                                  FALSE, (guint64)0, (gint64)0));
+  }
+}
+
+static const GDBusInterfaceVTable kInterfaceVTable = {handle_method_call,
+                                                      NULL, NULL, {NULL}};
+
+// ---------------------------------------------------------------------------
+// Subscriber side
+// ---------------------------------------------------------------------------
+
+static void on_changed_signal(GDBusConnection* connection,
+                              const gchar* sender_name,
+                              const gchar* object_path,
+                              const gchar* interface_name,
+                              const gchar* signal_name,
+                              GVariant* parameters,
+                              gpointer user_data) {
+  SessionService* self = (SessionService*)user_data;
+  if (!g_variant_is_of_type(parameters,
+                            G_VARIANT_TYPE(SESSION_SERVICE_STATE_TYPE))) {
+    return;
+  }
+  deliver_remote_state(self, parameters);
+}
+
+static void on_get_state_done(GObject* source,
+                              GAsyncResult* result,
+                              gpointer user_data) {
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GVariant) state = g_dbus_connection_call_finish(
+      G_DBUS_CONNECTION(source), result, &error);
+  // Cancelled calls may outlive the service; don't touch it.
+  if (state == NULL) return;
+  deliver_remote_state((SessionService*)user_data, state);
+}
+
+static void unsubscribe(SessionService* self) {
+  if (self->signal_id != 0) {
+    g_dbus_connection_signal_unsubscribe(self->connection, self->signal_id);
+    self->signal_id = 0;
+  }
+  if (self->cancellable != NULL) {
+    g_cancellable_cancel(self->cancellable);
+    g_clear_object(&self->cancellable);
+  }
+  self->remote_sequence = 0;
+}
+
+static void subscribe(SessionService* self, const gchar* owner) {
+  unsubscribe(self);
+  self->signal_id = g_dbus_connection_signal_subscribe(
+      self->connection, owner, SESSION_SERVICE_INTERFACE, "Changed",
+      SESSION_SERVICE_OBJECT_PATH, NULL, G_DBUS_SIGNAL_FLAGS_NONE,
+      on_changed_signal, self, NULL);
+  // Catch up with the state published before we subscribed.
+  self->cancellable = g_cancellable_new();
+  g_dbus_connection_call(
+      self->connection, owner, SESSION_SERVICE_OBJECT_PATH,
+      SESSION_SERVICE_INTERFACE, "GetState", NULL,
+      G_VARIANT_TYPE(SESSION_SERVICE_STATE_TYPE), G_DBUS_CALL_FLAGS_NONE, -1,
+      self->cancellable, on_get_state_done, self);
+}
+
+// ---------------------------------------------------------------------------
+// Name ownership
+// ---------------------------------------------------------------------------
+
+static void on_name_acquired(GDBusConnection* connection,
+                             const gchar* name,
+                             gpointer user_data) {
+  SessionService* self = (SessionService*)user_data;
+  unsubscribe(self);
+  set_role(self, SESSION_SERVICE_ROLE_OWNER);
+}
+
+static void on_name_lost(GDBusConnection* connection,
+                         const gchar* name,
+                         gpointer user_data) {
+  // Only reached when the connection closes: without
+  // G_BUS_NAME_OWNER_FLAGS_ALLOW_REPLACEMENT nobody can take the name away,
+  // and a queued request reports nothing until the name is acquired.
+  SessionService* self = (SessionService*)user_data;
+  if (self->role == SESSION_SERVICE_ROLE_OWNER) {
+    set_role(self, SESSION_SERVICE_ROLE_PENDING);
+  }
+}
+
+static void on_name_appeared(GDBusConnection* connection,
+                             const gchar* name,
+                             const gchar* name_owner,
+                             gpointer user_data) {
+  SessionService* self = (SessionService*)user_data;
+  // Our own acquisition is reported by on_name_acquired().
+  if (g_strcmp0(name_owner, g_dbus_connection_get_unique_name(connection)) ==
+      0) {
+    return;
+  }
+  subscribe(self, name_owner);
+  set_role(self, SESSION_SERVICE_ROLE_SUBSCRIBER);
+}
+
+static void on_name_vanished(GDBusConnection* connection,
+                             const gchar* name,
+                             gpointer user_data) {
+  SessionService* self = (SessionService*)user_data;
+  unsubscribe(self);
+  // The next instance in the queue, possibly this one, takes over.
+  if (self->role == SESSION_SERVICE_ROLE_SUBSCRIBER) {
+    set_role(self, SESSION_SERVICE_ROLE_PENDING);
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+SessionService* session_service_new(GDBusConnection* connection,
+                                    const gchar* name,
+                                    SessionServiceRoleFunc role_changed,
+                                    SessionServiceStateFunc remote_state,
+                                    gpointer user_data) {
+  g_return_val_if_fail(G_IS_DBUS_CONNECTION(connection), NULL);
+  if (name == NULL) name = SESSION_SERVICE_DEFAULT_NAME;
+
+  SessionService* self = g_new0(SessionService, 1);
+  self->connection = G_DBUS_CONNECTION(g_object_ref(connection));
+  self->role_changed = role_changed;
+  self->remote_state = remote_state;
+  self->user_data = user_data;
+  self->role = SESSION_SERVICE_ROLE_PENDING;
+
+  self->registration_id = g_dbus_connection_register_object(
+      connection, SESSION_SERVICE_OBJECT_PATH,
+      get_node_info()->interfaces[0], &kInterfaceVTable, self, NULL, NULL);
+  if (self->registration_id == 0) {
+    g_object_unref(self->connection);
+    g_free(self);
+    return NULL;
+  }
+
+  self->owner_id = g_bus_own_name_on_connection(
+      connection, name, G_BUS_NAME_OWNER_FLAGS_NONE, on_name_acquired,
+      on_name_lost, self, NULL);
+  self->watch_id = g_bus_watch_name_on_connection(
+      connection, name, G_BUS_NAME_WATCHER_FLAGS_NONE, on_name_appeared,
+      on_name_vanished, self, NULL);
+  return self;
+}
+
+SessionServiceRole session_service_get_role(SessionService* self) {
+  if (self == NULL) return SESSION_SERVICE_ROLE_PENDING;
+  return self->role;
+}
+
+void session_service_publish(SessionService* self,
+                             gboolean is_screen_mirrored,
+                             gboolean is_external_connected,
+                             gint display_count,
+                             gboolean is_screen_shared,
+                             guint64 sequence,
+                             gint64 detected_at_us) {
+  if (self == NULL) return;
+  g_clear_pointer(&self->state, g_variant_unref);
+  self->state = g_variant_ref_sink(g_variant_new(
+      SESSION_SERVICE_STATE_TYPE, is_screen_mirrored, is_external_connected,
+      display_count, is_screen_shared, sequence, detected_at_us));
+  if (self->role != SESSION_SERVICE_ROLE_OWNER) return;
+  g_dbus_connection_emit_signal(self->connection, NULL,
+                                SESSION_SERVICE_OBJECT_PATH,
+                                SESSION_SERVICE_INTERFACE, "Changed",
+                                self->state, NULL);
+}
+
+void session_service_free(SessionService* self) {
+  if (self == NULL) return;
+  unsubscribe(self);
+  g_bus_unwatch_name(self->watch_id);
+  g_bus_unown_name(self->owner_id);
+  g_dbus_connection_unregister_object(self->connection,
+                                      self->registration_id);
+  // Let the release reach the bus before the caller can drop the connection.
+  g_dbus_connection_flush_sync(self->connection, NULL, NULL);
+  g_clear_pointer(&self->state, g_variant_unref);
+  g_object_unref(self->connection);
+  g_free(self);
+}
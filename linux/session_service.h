@@ -0,0 +1,68 @@
+#ifndef SESSION_SERVICE_H_
+#define SESSION_SERVICE_H_
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+// Lets every app on the session share one detector over D-Bus. Each instance
+// queues for a well-known name on the bus. The owner scans and broadcasts
+// each state with a Changed signal; the others subscribe to it instead of
+// scanning. When the owner exits, the bus hands the name to the next
+// instance in the queue, which takes over scanning.
+//
+// Object /com/flutterplaza/NoScreenMirror, interface
+// com.flutterplaza.NoScreenMirror1:
+//   GetState() -> (b mirrored, b external, i displays, b shared,
+//                  t sequence, x detected_at_us)
+//   signal Changed(<same arguments>)
+// detected_at_us is CLOCK_MONOTONIC, which every process on the host shares.
+typedef struct _SessionService SessionService;
+
+#define SESSION_SERVICE_DEFAULT_NAME "com.flutterplaza.NoScreenMirror"
+
+typedef enum {
+  // Waiting for the bus to answer.
+  SESSION_SERVICE_ROLE_PENDING,
+  // This instance scans and publishes.
+  SESSION_SERVICE_ROLE_OWNER,
+  // Another instance scans; states arrive through the remote state callback.
+  SESSION_SERVICE_ROLE_SUBSCRIBER,
+} SessionServiceRole;
+
+typedef void (*SessionServiceRoleFunc)(SessionServiceRole role,
+                                       gpointer user_data);
+
+typedef void (*SessionServiceStateFunc)(gboolean is_screen_mirrored,
+                                        gboolean is_external_connected,
+                                        gint display_count,
+                                        gboolean is_screen_shared,
+                                        guint64 sequence,
+                                        gint64 detected_at_us,
+                                        gpointer user_data);
+
+// Queues for |name| on |connection|. Callbacks run on the thread-default
+// main context. Returns NULL if the object can't be exported.
+SessionService* session_service_new(GDBusConnection* connection,
+                                    const gchar* name,
+                                    SessionServiceRoleFunc role_changed,
+                                    SessionServiceStateFunc remote_state,
+                                    gpointer user_data);
+
+SessionServiceRole session_service_get_role(SessionService* service);
+
+// Broadcasts a state while this instance owns the name; a no-op otherwise.
+void session_service_publish(SessionService* service,
+                             gboolean is_screen_mirrored,
+                             gboolean is_external_connected,
+                             gint display_count,
+                             gboolean is_screen_shared,
+                             guint64 sequence,
+                             gint64 detected_at_us);
+
+// Releases the name, handing it to the next instance in the queue.
+void session_service_free(SessionService* service);
+
+G_END_DECLS
+
+#endif  // SESSION_SERVICE_H_
@@ -0,0 +1,118 @@
+#include "sharer_exits.h"
+
+#include <errno.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+typedef struct {
+  GSource* source;
+  gint pidfd;
+  gpointer fd_tag;
+  gboolean seen;
+} Watch;
+
+struct _SharerExits {
+  GSource* source;
+  GHashTable* watches;  // pid -> Watch* (owned)
+  // A match of the current walk had no pidfd.
+  gboolean walk_unwatched;
+  gboolean complete;
+};
+
+static gint open_pidfd(guint pid) {
+#ifdef SYS_pidfd_open
+  return (gint)syscall(SYS_pidfd_open, (pid_t)pid, 0);
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+static void watch_free(gpointer data) {
+  Watch* watch = (Watch*)data;
+  g_source_remove_unix_fd(watch->source, watch->fd_tag);
+  close(watch->pidfd);
+  g_free(watch);
+}
+
+static gboolean is_unseen(gpointer key, gpointer value, gpointer user_data) {
+  return !((Watch*)value)->seen;
+}
+
+// A pidfd becomes readable once its process has exited.
+static gboolean has_exited(gpointer key, gpointer value, gpointer user_data) {
+  Watch* watch = (Watch*)value;
+  return (g_source_query_unix_fd(watch->source, watch->fd_tag) & G_IO_IN) != 0;
+}
+
+SharerExits* sharer_exits_new(GSource* source) {
+  SharerExits* self = g_new0(SharerExits, 1);
+  self->source = g_source_ref(source);
+  self->watches = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                                        watch_free);
+  return self;
+}
+
+void sharer_exits_begin_walk(SharerExits* self) {
+  if (self == NULL) return;
+  GHashTableIter iter;
+  gpointer value;
+  g_hash_table_iter_init(&iter, self->watches);
+  while (g_hash_table_iter_next(&iter, NULL, &value)) {
+    ((Watch*)value)->seen = FALSE;
+  }
+  self->walk_unwatched = FALSE;
+}
+
+void sharer_exits_add(SharerExits* self, guint pid) {
+  if (self == NULL) return;
+  Watch* watch =
+      (Watch*)g_hash_table_lookup(self->watches, GUINT_TO_POINTER(pid));
+  if (watch != NULL) {
+    watch->seen = TRUE;
+    return;
+  }
+
+  // The PID was read from /proc moments ago; if the process exited and the
+  // PID was reused in between, the next walk no longer matches it and drops
+  // the watch.
+  gint pidfd = open_pidfd(pid);
+  if (pidfd < 0) {
+    // Already exited, or no pidfd support.
+    self->walk_unwatched = TRUE;
+    return;
+  }
+
+  watch = g_new0(Watch, 1);
+  watch->source = self->source;
+  watch->pidfd = pidfd;
+  watch->fd_tag = g_source_add_unix_fd(self->source, pidfd, G_IO_IN);
+  watch->seen = TRUE;
+  g_hash_table_insert(self->watches, GUINT_TO_POINTER(pid), watch);
+}
+
+void sharer_exits_end_walk(SharerExits* self) {
+  if (self == NULL) return;
+  g_hash_table_foreach_remove(self->watches, is_unseen, NULL);
+  self->complete =
+      !self->walk_unwatched && g_hash_table_size(self->watches) > 0;
+}
+
+gboolean sharer_exits_dispatch(SharerExits* self) {
+  if (self == NULL || g_hash_table_size(self->watches) == 0) return FALSE;
+  g_hash_table_foreach_remove(self->watches, has_exited, NULL);
+  if (g_hash_table_size(self->watches) > 0) return FALSE;
+  self->complete = FALSE;
+  return TRUE;
+}
+
+gboolean sharer_exits_is_complete(SharerExits* self) {
+  return self != NULL && self->complete;
+}
+
+void sharer_exits_free(SharerExits* self) {
+  if (self == NULL) return;
+  g_hash_table_destroy(self->watches);
+  g_source_unref(self->source);
+  g_free(self);
+}
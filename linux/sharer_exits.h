@@ -0,0 +1,43 @@
+#ifndef SHARER_EXITS_H_
+#define SHARER_EXITS_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// Watches the processes found sharing the screen for their exit through
+// pidfds polled by the owner's GSource, so the detector learns that the last
+// one is gone without walking /proc again.
+//
+// Each walk reports the PIDs it matched between begin and end; PIDs not
+// matched again stop being watched. Requires pidfd_open() (Linux 5.3).
+typedef struct _SharerExits SharerExits;
+
+// Adds pidfds to |source|, which must call sharer_exits_dispatch() whenever
+// it dispatches. Free the SharerExits before destroying |source|.
+SharerExits* sharer_exits_new(GSource* source);
+
+// Forgets watched processes that have exited. Returns TRUE if the last one
+// just did.
+gboolean sharer_exits_dispatch(SharerExits* exits);
+
+// Call once per walk, before adding that walk's matches. A walk that was
+// never ended is discarded.
+void sharer_exits_begin_walk(SharerExits* exits);
+
+// Watches |pid| unless it already is.
+void sharer_exits_add(SharerExits* exits, guint pid);
+
+// Stops watching processes that were not added since
+// sharer_exits_begin_walk().
+void sharer_exits_end_walk(SharerExits* exits);
+
+// TRUE when at least one process is watched and every match of the last
+// walk could be watched, i.e. an exit cannot go unnoticed.
+gboolean sharer_exits_is_complete(SharerExits* exits);
+
+void sharer_exits_free(SharerExits* exits);
+
+G_END_DECLS
+
+#endif  // SHARER_EXITS_H_
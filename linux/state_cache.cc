@@ -0,0 +1,88 @@
+#include "state_cache.h"
+
+static const gchar kGroup[] = "State";
+
+gchar* state_cache_default_path(void) {
+  return g_build_filename(g_get_user_cache_dir(), "no_screen_mirror",
+                          "last_state", NULL);
+}
+
+gchar* state_cache_read_boot_id(void) {
+  gchar* contents = NULL;
+  if (!g_file_get_contents("/proc/sys/kernel/random/boot_id", &contents, NULL,
+                           NULL)) {
+    return NULL;
+  }
+  return g_strstrip(contents);
+}
+
+gboolean state_cache_save(const gchar* path,
+                          const gchar* boot_id,
+                          const CachedState* state) {
+  if (path == NULL || boot_id == NULL || state == NULL) return FALSE;
+
+  g_autoptr(GKeyFile) key_file = g_key_file_new();
+  g_key_file_set_string(key_file, kGroup, "BootId", boot_id);
+  g_key_file_set_int64(key_file, kGroup, "DetectedAtUs",
+                       state->detected_at_us);
+  g_key_file_set_boolean(key_file, kGroup, "ScreenMirrored",
+                         state->is_screen_mirrored);
+  g_key_file_set_boolean(key_file, kGroup, "ExternalDisplayConnected",
+                         state->is_external_connected);
+  g_key_file_set_integer(key_file, kGroup, "DisplayCount",
+                         state->display_count);
+  g_key_file_set_boolean(key_file, kGroup, "ScreenShared",
+                         state->is_screen_shared);
+
+  g_autofree gchar* dir = g_path_get_dirname(path);
+  g_mkdir_with_parents(dir, 0700);
+  // Goes through a temporary file and a rename, so a crash mid-write leaves
+  // the previous state rather than a torn one.
+  return g_key_file_save_to_file(key_file, path, NULL);
+}
+
+gboolean state_cache_load(const gchar* path,
+                          const gchar* boot_id,
+                          CachedState* out) {
+  if (path == NULL || boot_id == NULL || out == NULL) return FALSE;
+
+  g_autoptr(GKeyFile) key_file = g_key_file_new();
+  if (!g_key_file_load_from_file(key_file, path, G_KEY_FILE_NONE, NULL)) {
+    return FALSE;
+  }
+
+  // Displays may have changed across a reboot, and the monotonic timestamp
+  // no longer means anything.
+  g_autofree gchar* saved_boot_id =
+      g_key_file_get_string(key_file, kGroup, "BootId", NULL);
+  if (g_strcmp0(saved_boot_id, boot_id) != 0) return FALSE;
+
+  CachedState state;
+  GError* error = NULL;
+  state.detected_at_us =
+      g_key_file_get_int64(key_file, kGroup, "DetectedAtUs", &error);
+  if (error == NULL) {
+    state.is_screen_mirrored =
+        g_key_file_get_boolean(key_file, kGroup, "ScreenMirrored", &error);
+  }
+  if (error == NULL) {
+    state.is_external_connected = g_key_file_get_boolean(
+        key_file, kGroup, "ExternalDisplayConnected", &error);
+  }
+  if (error == NULL) {
+    state.display_count =
+        g_key_file_get_integer(key_file, kGroup, "DisplayCount", &error);
+  }
+  if (error == NULL) {
+    state.is_screen_shared =
+        g_key_file_get_boolean(key_file, kGroup, "ScreenShared", &error);
+  }
+  if (error != NULL) {
+    g_error_free(error);
+    return FALSE;
+  }
+  if (state.display_count < 1) return FALSE;
+
+  *out = state;
+  return TRUE;
+}
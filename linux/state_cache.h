@@ -0,0 +1,44 @@
+#ifndef STATE_CACHE_H_
+#define STATE_CACHE_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// Persists the last committed detection state between runs, so the plugin
+// can report it at startup instead of a hardcoded default while the first
+// scan is pending. A saved state is only trusted within the boot it was
+// detected in.
+
+typedef struct {
+  gboolean is_screen_mirrored;
+  gboolean is_external_connected;
+  gint display_count;
+  gboolean is_screen_shared;
+  // CLOCK_MONOTONIC microseconds, which stay comparable across processes
+  // until the next reboot.
+  gint64 detected_at_us;
+} CachedState;
+
+// $XDG_CACHE_HOME/no_screen_mirror/last_state. Free with g_free().
+gchar* state_cache_default_path(void);
+
+// The kernel's random ID for the current boot, or NULL if unavailable. Free
+// with g_free().
+gchar* state_cache_read_boot_id(void);
+
+// Writes |state| to |path| tagged with |boot_id|, replacing the file
+// atomically. Returns FALSE if it couldn't be written.
+gboolean state_cache_save(const gchar* path,
+                          const gchar* boot_id,
+                          const CachedState* state);
+
+// Reads the state saved at |path| into |out|. Returns FALSE if there is none,
+// it is malformed, or it was saved during a different boot than |boot_id|.
+gboolean state_cache_load(const gchar* path,
+                          const gchar* boot_id,
+                          CachedState* out);
+
+G_END_DECLS
+
+#endif  // STATE_CACHE_H_
@@ -0,0 +1,84 @@
+#include "state_export.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "include/no_screen_mirror/no_screen_mirror_state.h"
+
+struct _StateExport {
+  gchar* name;
+  NsmSharedState* shared;
+};
+
+StateExport* state_export_new(const gchar* name) {
+  if (name == NULL || name[0] != '/') return NULL;
+
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) return NULL;
+  // shm_open()'s mode is filtered by the umask.
+  fchmod(fd, 0644);
+  if (ftruncate(fd, sizeof(NsmSharedState)) != 0) {
+    close(fd);
+    return NULL;
+  }
+  void* mapping = mmap(NULL, sizeof(NsmSharedState), PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) return NULL;
+
+  StateExport* self = g_new0(StateExport, 1);
+  self->name = g_strdup(name);
+  self->shared = (NsmSharedState*)mapping;
+
+  // Readers check the magic last, so publish it after everything else. A
+  // segment left behind by a previous writer is reused with its seqlock
+  // intact, which keeps a reader mid-read from accepting a torn copy.
+  NsmSharedState* shared = self->shared;
+  __atomic_store_n(&shared->version, NSM_SHARED_STATE_VERSION,
+                   __ATOMIC_RELAXED);
+  __atomic_store_n(&shared->writer_pid, (int32_t)getpid(), __ATOMIC_RELAXED);
+  __atomic_store_n(&shared->magic, NSM_SHARED_STATE_MAGIC, __ATOMIC_RELEASE);
+  return self;
+}
+
+void state_export_publish(StateExport* self,
+                          gboolean is_screen_mirrored,
+                          gboolean is_external_connected,
+                          gint display_count,
+                          gboolean is_screen_shared,
+                          guint64 sequence,
+                          gint64 detected_at_us) {
+  if (self == NULL) return;
+  NsmSharedState* shared = self->shared;
+
+  uint32_t flags = 0;
+  if (is_screen_mirrored) flags |= NSM_STATE_SCREEN_MIRRORED;
+  if (is_external_connected) flags |= NSM_STATE_EXTERNAL_DISPLAY_CONNECTED;
+  if (is_screen_shared) flags |= NSM_STATE_SCREEN_SHARED;
+
+  // Single writer: make the seqlock odd, store the fields, make it even.
+  uint32_t seqlock = __atomic_load_n(&shared->seqlock, __ATOMIC_RELAXED);
+  if (seqlock & 1u) seqlock++;  // A previous writer died mid-update.
+  __atomic_store_n(&shared->seqlock, seqlock + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  __atomic_store_n(&shared->flags, flags, __ATOMIC_RELAXED);
+  __atomic_store_n(&shared->display_count, (int32_t)display_count,
+                   __ATOMIC_RELAXED);
+  __atomic_store_n(&shared->writer_pid, (int32_t)getpid(), __ATOMIC_RELAXED);
+  __atomic_store_n(&shared->sequence, (uint64_t)sequence, __ATOMIC_RELAXED);
+  __atomic_store_n(&shared->detected_at_us, (int64_t)detected_at_us,
+                   __ATOMIC_RELAXED);
+
+  __atomic_store_n(&shared->seqlock, seqlock + 2, __ATOMIC_RELEASE);
+}
+
+void state_export_free(StateExport* self) {
+  if (self == NULL) return;
+  munmap(self->shared, sizeof(NsmSharedState));
+  shm_unlink(self->name);
+  g_free(self->name);
+  g_free(self);
+}
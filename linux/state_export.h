@@ -0,0 +1,34 @@
+#ifndef STATE_EXPORT_H_
+#define STATE_EXPORT_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// Publishes the detection state into a named POSIX shared memory segment so
+// other local processes can read it without scanning /proc themselves. The
+// layout and the lock-free reader are in
+// include/no_screen_mirror/no_screen_mirror_state.h.
+typedef struct _StateExport StateExport;
+
+// Creates (or takes over) the segment |name|, e.g. "/no_screen_mirror". It
+// is readable by every local user. Returns NULL if shared memory is
+// unavailable.
+StateExport* state_export_new(const gchar* name);
+
+// Stores a new state under the seqlock. Never blocks readers.
+void state_export_publish(StateExport* state_export,
+                          gboolean is_screen_mirrored,
+                          gboolean is_external_connected,
+                          gint display_count,
+                          gboolean is_screen_shared,
+                          guint64 sequence,
+                          gint64 detected_at_us);
+
+// Unmaps and removes the segment. Readers that already mapped it keep their
+// last state.
+void state_export_free(StateExport* state_export);
+
+G_END_DECLS
+
+#endif  // STATE_EXPORT_H_
@@ -0,0 +1,131 @@
+#include "state_journal.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "include/no_screen_mirror/no_screen_mirror_journal.h"
+
+struct _StateJournal {
+  // Kept open for the lock that keeps a second writer out.
+  int fd;
+  gsize size;
+  NsmJournalHeader* header;
+  NsmJournalRecord* records;
+};
+
+static gboolean is_compatible(const NsmJournalHeader* header,
+                              guint capacity) {
+  return header->magic == NSM_JOURNAL_MAGIC &&
+         header->version == NSM_JOURNAL_VERSION &&
+         header->capacity == capacity &&
+         header->record_size == sizeof(NsmJournalRecord);
+}
+
+StateJournal* state_journal_new(const gchar* path, guint capacity) {
+  if (path == NULL || capacity == 0) return NULL;
+
+  int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) return NULL;
+  if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+    close(fd);
+    return NULL;
+  }
+  gsize size =
+      sizeof(NsmJournalHeader) + (gsize)capacity * sizeof(NsmJournalRecord);
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (st.st_size != (off_t)size &&
+                              ftruncate(fd, 0) != 0)) {
+    close(fd);
+    return NULL;
+  }
+  // Allocates every block now, so a full disk fails here instead of raising
+  // SIGBUS on a later append.
+  if (posix_fallocate(fd, 0, (off_t)size) != 0) {
+    close(fd);
+    return NULL;
+  }
+  void* mapping =
+      mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (mapping == MAP_FAILED) {
+    close(fd);
+    return NULL;
+  }
+
+  StateJournal* self = g_new0(StateJournal, 1);
+  self->fd = fd;
+  self->size = size;
+  self->header = (NsmJournalHeader*)mapping;
+  self->records = (NsmJournalRecord*)(self->header + 1);
+
+  NsmJournalHeader* header = self->header;
+  if (!is_compatible(header, capacity)) {
+    // Readers check the magic first, so it is cleared before and published
+    // after everything else.
+    __atomic_store_n(&header->magic, 0u, __ATOMIC_RELAXED);
+    memset(mapping, 0, size);
+    header->version = NSM_JOURNAL_VERSION;
+    header->capacity = capacity;
+    header->record_size = sizeof(NsmJournalRecord);
+    __atomic_store_n(&header->magic, NSM_JOURNAL_MAGIC, __ATOMIC_RELEASE);
+  } else {
+    // Picks up a record committed by a writer that died before advancing
+    // head.
+    __atomic_store_n(&header->head, nsm_journal_head(header),
+                     __ATOMIC_RELEASE);
+  }
+  return self;
+}
+
+void state_journal_append(StateJournal* self,
+                          gboolean is_screen_mirrored,
+                          gboolean is_external_connected,
+                          gint display_count,
+                          gboolean is_screen_shared,
+                          guint64 sequence,
+                          gint64 detected_at_us,
+                          guint cause) {
+  if (self == NULL) return;
+
+  guint32 flags = 0;
+  if (is_screen_mirrored) flags |= NSM_STATE_SCREEN_MIRRORED;
+  if (is_external_connected) flags |= NSM_STATE_EXTERNAL_DISPLAY_CONNECTED;
+  if (is_screen_shared) flags |= NSM_STATE_SCREEN_SHARED;
+
+  NsmJournalRecord record;
+  record.commit = 0;
+  // Monotonic time means nothing after a reboot; wall time does.
+  record.detected_at_wall_us =
+      g_get_real_time() - (g_get_monotonic_time() - detected_at_us);
+  record.sequence = sequence;
+  record.state = flags | ((guint32)CLAMP(display_count, 0, 0xffff) << 16);
+  record.cause = cause;
+
+  // Single writer: head only changes here.
+  NsmJournalHeader* header = self->header;
+  guint64 position = __atomic_load_n(&header->head, __ATOMIC_RELAXED);
+  NsmJournalRecord* slot = &self->records[position % header->capacity];
+
+  // Invalidates the slot before overwriting it, so neither a concurrent
+  // reader nor one reading after a crash mid-copy takes a mix of the old
+  // and new fields for a record.
+  __atomic_store_n(&slot->commit, (guint64)0, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy((gchar*)slot + sizeof(slot->commit),
+         (const gchar*)&record + sizeof(record.commit),
+         sizeof(record) - sizeof(record.commit));
+  __atomic_store_n(&slot->commit, position + 1, __ATOMIC_RELEASE);
+  __atomic_store_n(&header->head, position + 1, __ATOMIC_RELEASE);
+}
+
+void state_journal_free(StateJournal* self) {
+  if (self == NULL) return;
+  // The only point where records are forced to disk; see state_journal.h.
+  msync(self->header, self->size, MS_SYNC);
+  munmap(self->header, self->size);
+  close(self->fd);
+  g_free(self);
+}
@@ -0,0 +1,43 @@
+#ifndef STATE_JOURNAL_H_
+#define STATE_JOURNAL_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// Appends every state transition to a fixed-size, memory-mapped journal file
+// that outlives the process, for post-mortem analysis after a crash or
+// reboot. The file layout and the reader are in
+// include/no_screen_mirror/no_screen_mirror_journal.h.
+//
+// The file is allocated up front and never grows: once the ring is full the
+// oldest records are overwritten. An append is a memcpy into the mapping and
+// two release stores, with no syscalls; the kernel writes the pages back
+// and state_journal_free() msyncs them. A process crash loses nothing, but
+// records the kernel has not yet written back (by default, up to about 30
+// seconds' worth) are lost to a power loss or kernel panic.
+typedef struct _StateJournal StateJournal;
+
+// Opens the journal at |path|, continuing after its last record, or creates
+// it with room for |capacity| records when it is missing or was created with
+// a different capacity. Returns NULL if the file cannot be allocated or
+// another process is writing it.
+StateJournal* state_journal_new(const gchar* path, guint capacity);
+
+// Records a transition to the given state. |cause| is a mask of
+// NSM_JOURNAL_CAUSE_* bits.
+void state_journal_append(StateJournal* journal,
+                          gboolean is_screen_mirrored,
+                          gboolean is_external_connected,
+                          gint display_count,
+                          gboolean is_screen_shared,
+                          guint64 sequence,
+                          gint64 detected_at_us,
+                          guint cause);
+
+// Writes the journal back to disk and unmaps it. The file stays.
+void state_journal_free(StateJournal* journal);
+
+G_END_DECLS
+
+#endif  // STATE_JOURNAL_H_
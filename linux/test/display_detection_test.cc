@@ -0,0 +1,1506 @@
+#include <dirent.h>
+#include <ftw.h>
+#include <signal.h>
+#include <gio/gio.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <list>
+#include <string>
+#include <vector>
+
+#include "batched_reads.h"
+#include "display_detection.h"
+#include "exe_signatures.h"
+#include "include/no_screen_mirror/no_screen_mirror_journal.h"
+#include "include/no_screen_mirror/no_screen_mirror_state.h"
+#include "metrics_export.h"
+#include "probe_trace.h"
+#include "proc_scope.h"
+#include "proc_shards.h"
+#include "session_service.h"
+#include "state_cache.h"
+#include "state_export.h"
+#include "state_journal.h"
+
+// Exercises DisplayDetection against a fake process table, so no real
+// screen-sharing app needs to be running.
+//
+// Once you have built the plugin's example app, you can run these tests
+// from the command line. For instance, for x64 debug, run:
+// $ build/linux/x64/debug/plugins/no_screen_mirror/no_screen_mirror_test
+//
+// Or build the detector on its own, without Flutter:
+// $ cmake -S linux -B build && cmake --build build && ctest --test-dir build
+
+namespace no_screen_mirror {
+namespace test {
+
+namespace {
+
+struct ReadRecorder {
+  std::vector<std::string> contents;
+};
+
+void record_read(guint index, const gchar* contents, gpointer user_data) {
+  auto* recorder = static_cast<ReadRecorder*>(user_data);
+  if (recorder->contents.size() <= index) recorder->contents.resize(index + 1);
+  recorder->contents[index] = contents != nullptr ? contents : "<unreadable>";
+}
+
+gboolean is_obs(guint pid, const gchar* comm, gpointer user_data) {
+  return g_strcmp0(comm, "obs") == 0;
+}
+
+struct ChangeRecorder {
+  gint calls = 0;
+  gboolean is_external_connected = FALSE;
+  gint display_count = 0;
+  gboolean is_screen_shared = FALSE;
+};
+
+void record_change(gboolean is_external_connected, gint display_count,
+                   gboolean is_screen_shared, gpointer user_data) {
+  auto* recorder = static_cast<ChangeRecorder*>(user_data);
+  recorder->calls++;
+  recorder->is_external_connected = is_external_connected;
+  recorder->display_count = display_count;
+  recorder->is_screen_shared = is_screen_shared;
+}
+
+void write_comm(const gchar* proc_root, guint pid, const gchar* comm) {
+  g_autofree gchar* pid_dir = g_strdup_printf("%s/%u", proc_root, pid);
+  g_mkdir_with_parents(pid_dir, 0755);
+  g_autofree gchar* comm_path = g_build_filename(pid_dir, "comm", NULL);
+  g_autofree gchar* contents = g_strdup_printf("%s\n", comm);
+  ASSERT_TRUE(g_file_set_contents(comm_path, contents, -1, NULL));
+}
+
+void write_connector(const gchar* drm_root, const gchar* name,
+                     const gchar* status) {
+  g_autofree gchar* connector_dir = g_build_filename(drm_root, name, NULL);
+  g_mkdir_with_parents(connector_dir, 0755);
+  g_autofree gchar* status_path =
+      g_build_filename(connector_dir, "status", NULL);
+  g_autofree gchar* contents = g_strdup_printf("%s\n", status);
+  ASSERT_TRUE(g_file_set_contents(status_path, contents, -1, NULL));
+}
+
+// Points <pid>/exe at |binary| (created under |proc_root| if missing) and
+// writes <pid>/maps listing |library|.
+void write_exe(const gchar* proc_root, guint pid, const gchar* binary,
+               const gchar* library) {
+  g_autofree gchar* binary_path = g_build_filename(proc_root, binary, NULL);
+  if (!g_file_test(binary_path, G_FILE_TEST_EXISTS)) {
+    ASSERT_TRUE(g_file_set_contents(binary_path, "", -1, NULL));
+  }
+  g_autofree gchar* pid_dir = g_strdup_printf("%s/%u", proc_root, pid);
+  g_mkdir_with_parents(pid_dir, 0755);
+  g_autofree gchar* exe_path = g_build_filename(pid_dir, "exe", NULL);
+  ASSERT_EQ(symlink(binary_path, exe_path), 0);
+  g_autofree gchar* maps_path = g_build_filename(pid_dir, "maps", NULL);
+  g_autofree gchar* maps = g_strdup_printf(
+      "7f0000000000-7f0000001000 r-xp 00000000 08:01 1234 %s\n", library);
+  ASSERT_TRUE(g_file_set_contents(maps_path, maps, -1, NULL));
+}
+
+// A temporary directory laid out like /proc, with one comm file per pid.
+class ProcFixture {
+ public:
+  explicit ProcFixture(guint pid_count) {
+    root_ = g_dir_make_tmp("nsm_proc_XXXXXX", NULL);
+    for (guint pid = 1; pid <= pid_count; pid++) {
+      write_comm(root_, pid, "bash");
+    }
+  }
+
+  ~ProcFixture() {
+    nftw(
+        root_,
+        [](const char* path, const struct stat*, int, struct FTW*) {
+          return remove(path);
+        },
+        64, FTW_DEPTH | FTW_PHYS);
+    g_free(root_);
+  }
+
+  const gchar* root() const { return root_; }
+
+ private:
+  gchar* root_;
+};
+
+}  // namespace
+
+TEST(DisplayDetection, FindsScreenSharingProcessInProcRoot) {
+  ProcFixture fixture(100);
+  write_comm(fixture.root(), 42, "zoom");
+
+  ChangeRecorder recorder;
+  DisplayDetection* detection = display_detection_new(record_change, &recorder);
+  display_detection_set_proc_root(detection, fixture.root());
+  display_detection_start(detection, 2000, nullptr);
+
+  EXPECT_EQ(recorder.calls, 1);
+  EXPECT_TRUE(recorder.is_screen_shared);
+
+  display_detection_free(detection);
+}
+
+TEST(DisplayDetection, ReadsConnectorsFromDrmRoot) {
+  ProcFixture proc(10);
+  ProcFixture drm(0);
+  write_connector(drm.root(), "card0-eDP-1", "connected");
+  write_connector(drm.root(), "card0-HDMI-A-1", "connected");
+  write_connector(drm.root(), "card0-DP-1", "disconnected");
+
+  ChangeRecorder recorder;
+  DisplayDetection* detection = display_detection_new(record_change, &recorder);
+  display_detection_set_proc_root(detection, proc.root());
+  display_detection_set_drm_root(detection, drm.root());
+  display_detection_start(detection, 2000, nullptr);
+
+  EXPECT_TRUE(recorder.is_external_connected);
+  EXPECT_EQ(recorder.display_count, 2);
+
+  display_detection_free(detection);
+}
+
+TEST(DisplayDetection, SkipsProbesForUnsubscribedFields) {
+  ProcFixture proc(10);
+  write_comm(proc.root(), 7, "zoom");
+  ProcFixture drm(0);
+  write_connector(drm.root(), "card0-HDMI-A-1", "connected");
+
+  ChangeRecorder recorder;
+  DisplayDetection* detection = display_detection_new(record_change, &recorder);
+  display_detection_set_proc_root(detection, proc.root());
+  display_detection_set_drm_root(detection, drm.root());
+  display_detection_set_fields(detection,
+                               DISPLAY_DETECTION_FIELD_EXTERNAL_DISPLAY |
+                                   DISPLAY_DETECTION_FIELD_DISPLAY_COUNT);
+  display_detection_start(detection, 2000, nullptr);
+
+  EXPECT_EQ(recorder.calls, 1);
+  EXPECT_TRUE(recorder.is_external_connected);
+  EXPECT_FALSE(recorder.is_screen_shared);
+
+  // Subscribing runs the process probe without waiting for the next poll,
+  // and only that probe: the connector change waits for its own poll.
+  write_connector(drm.root(), "card0-HDMI-A-1", "disconnected");
+  display_detection_set_fields(detection, DISPLAY_DETECTION_FIELDS_ALL);
+  EXPECT_EQ(recorder.calls, 2);
+  EXPECT_TRUE(recorder.is_screen_shared);
+  EXPECT_TRUE(recorder.is_external_connected);
+
+  // Dropping the connector fields freezes them at their last value.
+  write_connector(drm.root(), "card0-HDMI-A-1", "disconnected");
+  display_detection_set_fields(detection,
+                               DISPLAY_DETECTION_FIELD_SCREEN_SHARED);
+  EXPECT_EQ(recorder.calls, 2);
+  EXPECT_TRUE(recorder.is_external_connected);
+
+  display_detection_free(detection);
+}
+
+TEST(DisplayDetection, PollsEachProbeOnItsOwnInterval) {
+  ProcFixture proc(10);
+  ProcFixture drm(0);
+  write_connector(drm.root(), "card0-HDMI-A-1", "disconnected");
+
+  ChangeRecorder recorder;
+  DisplayDetection* detection = display_detection_new(record_change, &recorder);
+  display_detection_set_proc_root(detection, proc.root());
+  display_detection_set_drm_root(detection, drm.root());
+  display_detection_set_probe_intervals(detection, 10, 60 * 60 * 1000);
+  display_detection_start(detection, 2000, nullptr);
+  ASSERT_EQ(recorder.calls, 1);
+
+  write_connector(drm.root(), "card0-HDMI-A-1", "connected");
+  write_comm(proc.root(), 7, "zoom");
+  gint64 give_up_us = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+  while (recorder.calls == 1 && g_get_monotonic_time() < give_up_us) {
+    g_main_context_iteration(nullptr, FALSE);
+  }
+
+  // The connector probe picked up the display well before the poll interval
+  // passed; the process probe hasn't run again yet.
+  EXPECT_EQ(recorder.calls, 2);
+  EXPECT_TRUE(recorder.is_external_connected);
+  EXPECT_FALSE(recorder.is_screen_shared);
+
+  display_detection_free(detection);
+}
+
+TEST(DisplayDetection, MergesProbesDueTogetherIntoOneChange) {
+  ProcFixture proc(10);
+  ProcFixture drm(0);
+  write_connector(drm.root(), "card0-HDMI-A-1", "disconnected");
+
+  ChangeRecorder recorder;
+  DisplayDetection* detection = display_detection_new(record_change, &recorder);
+  display_detection_set_proc_root(detection, proc.root());
+  display_detection_set_drm_root(detection, drm.root());
+  display_detection_set_probe_intervals(detection, 20, 30);
+  display_detection_start(detection, 2000, nullptr);
+  ASSERT_EQ(recorder.calls, 1);
+
+  // Both timers are overdue by the time the loop runs again.
+  write_connector(drm.root(), "card0-HDMI-A-1", "connected");
+  write_comm(proc.root(), 7, "zoom");
+  g_usleep(100 * 1000);
+  gint64 give_up_us = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+  while (recorder.calls == 1 && g_get_monotonic_time() < give_up_us) {
+    g_main_context_iteration(nullptr, FALSE);
+  }
+
+  EXPECT_EQ(recorder.calls, 2);
+  EXPECT_TRUE(recorder.is_external_connected);
+  EXPECT_TRUE(recorder.is_screen_shared);
+
+  display_detection_free(detection);
+}
+
+TEST(DisplayDetection, ReportsAnUnawaitedFirstScanFromTheMainLoop) {
+  ProcFixture proc(10);
+  write_comm(proc.root(), 7, "zoom");
+
+  ChangeRecorder recorder;
+  DisplayDetection* detection = display_detection_new(record_change, &recorder);
+  display_detection_set_proc_root(detection, proc.root());
+  display_detection_set_await_first_scan(detection, FALSE);
+  display_detection_start(detection, 2000, nullptr);
+  EXPECT_EQ(recorder.calls, 0);
+
+  gint64 give_up_us = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+  while (recorder.calls == 0 && g_get_monotonic_time() < give_up_us) {
+    g_main_context_iteration(nullptr, FALSE);
+  }
+  EXPECT_EQ(recorder.calls, 1);
+  EXPECT_TRUE(recorder.is_screen_shared);
+
+  display_detection_free(detection);
+}
+
+TEST(DisplayDetection, SlicesAnUnawaitedFirstScan) {
+  ProcFixture proc(5000);
+
+  ChangeRecorder recorder;
+  DisplayDetection* detection = display_detection_new(record_change, &recorder);
+  display_detection_set_proc_root(detection, proc.root());
+  display_detection_set_scan_slice_budget(detection, 100);
+  display_detection_set_await_first_scan(detection, FALSE);
+  display_detection_start(detection, 2000, nullptr);
+
+  // Unchanged from the defaults, but the first scan is reported regardless.
+  gint dispatches = 0;
+  gint64 give_up_us = g_get_monotonic_time() + 10 * G_USEC_PER_SEC;
+  while (recorder.calls == 0 && g_get_monotonic_time() < give_up_us) {
+    if (g_main_context_iteration(nullptr, FALSE)) dispatches++;
+  }
+  EXPECT_EQ(recorder.calls, 1);
+  EXPECT_FALSE(recorder.is_screen_shared);
+  EXPECT_GT(dispatches, 1);
+
+  display_detection_free(detection);
+}
+
+TEST(DisplayDetection, StoppingBeforeTheFirstScanReportsNothing) {
+  ProcFixture proc(10);
+
+  ChangeRecorder recorder;
+  DisplayDetection* detection = display_detection_new(record_change, &recorder);
+  display_detection_set_proc_root(detection, proc.root());
+  display_detection_set_await_first_scan(detection, FALSE);
+  display_detection_start(detection, 2000, nullptr);
+  display_detection_stop(detection);
+  while (g_main_context_iteration(nullptr, FALSE)) {
+  }
+  EXPECT_EQ(recorder.calls, 0);
+
+  // And it can start over.
+  display_detection_set_await_first_scan(detection, TRUE);
+  display_detection_start(detection, 2000, nullptr);
+  EXPECT_EQ(recorder.calls, 1);
+
+  display_detection_free(detection);
+}
+
+TEST(DisplayDetection, MapsMirrorFieldNames) {
+  EXPECT_EQ(display_detection_field_from_name("externalDisplayConnected"),
+            (guint)DISPLAY_DETECTION_FIELD_EXTERNAL_DISPLAY);
+  EXPECT_EQ(display_detection_field_from_name("displayCount"),
+            (guint)DISPLAY_DETECTION_FIELD_DISPLAY_COUNT);
+  EXPECT_EQ(display_detection_field_from_name("screenShared"),
+            (guint)DISPLAY_DETECTION_FIELD_SCREEN_SHARED);
+  EXPECT_EQ(display_detection_field_from_name("screenMirrored"), 0u);
+}
+
+gboolean on_exit_timeout(gpointer user_data) {
+  *static_cast<gboolean*>(user_data) = TRUE;
+  return G_SOURCE_REMOVE;
+}
+
+// Runs a real process named nsm-test-share, since pidfds only watch live
+// ones; exec through a symlink in |dir| gives it that comm.
+void spawn_sharer(const gchar* dir, GPid* pid) {
+  g_autofree gchar* sharer_path =
+      g_build_filename(dir, "nsm-test-share", NULL);
+  if (!g_file_test(sharer_path, G_FILE_TEST_EXISTS)) {
+    g_autofree gchar* sleep_path = g_find_program_in_path("sleep");
+    ASSERT_NE(sleep_path, nullptr);
+    ASSERT_EQ(symlink(sleep_path, sharer_path), 0);
+  }
+  const gchar* argv[] = {sharer_path, "60", nullptr};
+  ASSERT_TRUE(g_spawn_async(nullptr, (gchar**)argv, nullptr,
+                            G_SPAWN_DO_NOT_REAP_CHILD, nullptr, nullptr, pid,
+                            nullptr));
+  // Wait for the exec to set the comm.
+  g_autofree gchar* comm_path = g_strdup_printf("/proc/%d/comm", (gint)*pid);
+  for (gint attempt = 0; attempt < 100; attempt++) {
+    g_autofree gchar* comm = nullptr;
+    if (g_file_get_contents(comm_path, &comm, nullptr, nullptr) &&
+        g_str_has_prefix(comm, "nsm-test-share")) {
+      break;
+    }
+    g_usleep(10000);
+  }
+}
+
+void reap_sharer(GPid pid) {
+  waitpid(pid, nullptr, 0);
+  g_spawn_close_pid(pid);
+}
+
+TEST(DisplayDetection, ClearsSharingWhenTheSharerExits) {
+  ProcFixture dir(0);
+  GPid sharer_pid;
+  ASSERT_NO_FATAL_FAILURE(spawn_sharer(dir.root(), &sharer_pid));
+
+  ChangeRecorder recorder;
+  DisplayDetection* detection = display_detection_new(record_change, &recorder);
+  const gchar* custom[] = {"nsm-test-share", nullptr};
+  // No poll comes due during the test; only the exit watch can clear it.
+  display_detection_start(detection, 600000, (gchar**)custom);
+  ASSERT_TRUE(recorder.is_screen_shared);
+
+  kill(sharer_pid, SIGTERM);
+  gboolean timed_out = FALSE;
+  guint timeout_id = g_timeout_add(5000, on_exit_timeout, &timed_out);
+  while (recorder.is_screen_shared && !timed_out) {
+    g_main_context_iteration(nullptr, TRUE);
+  }
+  if (!timed_out) g_source_remove(timeout_id);
+  EXPECT_FALSE(recorder.is_screen_shared);
+  EXPECT_EQ(recorder.calls, 2);
+
+  display_detection_free(detection);
+  reap_sharer(sharer_pid);
+}
+
+TEST(DisplayDetection, ReportsEverythingReadyTogetherAsOneChange) {
+  ProcFixture dir(0);
+  ProcFixture drm(0);
+  write_connector(drm.root(), "card0-HDMI-A-1", "disconnected");
+  GPid sharers[2];
+  for (GPid& sharer : sharers) {
+    ASSERT_NO_FATAL_FAILURE(spawn_sharer(dir.root(), &sharer));
+  }
+
+  ChangeRecorder recorder;
+  DisplayDetection* detection = display_detection_new(record_change, &recorder);
+  display_detection_set_drm_root(detection, drm.root());
+  display_detection_set_probe_intervals(detection, 20, 60 * 60 * 1000);
+  const gchar* custom[] = {"nsm-test-share", nullptr};
+  display_detection_start(detection, 2000, (gchar**)custom);
+  ASSERT_TRUE(recorder.is_screen_shared);
+
+  // Two pidfds and the connector deadline are all ready by the time the
+  // loop runs again.
+  write_connector(drm.root(), "card0-HDMI-A-1", "connected");
+  for (GPid sharer : sharers) kill(sharer, SIGTERM);
+  for (GPid sharer : sharers) reap_sharer(sharer);
+  g_usleep(100 * 1000);
+  gint64 give_up_us = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+  while (recorder.calls == 1 && g_get_monotonic_time() < give_up_us) {
+    g_main_context_iteration(nullptr, FALSE);
+  }
+
+  EXPECT_EQ(recorder.calls, 2);
+  EXPECT_TRUE(recorder.is_external_connected);
+  EXPECT_FALSE(recorder.is_screen_shared);
+
+  display_detection_free(detection);
+}
+
+TEST(DisplayDetection, MatchesCustomProcesses) {
+  ProcFixture fixture(100);
+  write_comm(fixture.root(), 7, "my-meetings");
+
+  ChangeRecorder recorder;
+  const gchar* custom_processes[] = {"my-meetings", nullptr};
+  DisplayDetection* detection = display_detection_new(record_change, &recorder);
+  display_detection_set_proc_root(detection, fixture.root());
+  display_detection_start(detection, 2000, custom_processes);
+
+  EXPECT_TRUE(recorder.is_screen_shared);
+
+  display_detection_free(detection);
+}
+
+TEST(DisplayDetection, RescansOnlyWhenUpdatedRulesChangeWhatMatches) {
+  ProcFixture fixture(100);
+
+  ChangeRecorder recorder;
+  const gchar* custom_processes[] = {"other", nullptr};
+  DisplayDetection* detection = display_detection_new(record_change, &recorder);
+  display_detection_set_proc_root(detection, fixture.root());
+  display_detection_start(detection, 60 * 60 * 1000, custom_processes);
+  ASSERT_EQ(recorder.calls, 1);
+  ASSERT_FALSE(recorder.is_screen_shared);
+
+  // The same rules: nothing is scanned, so the new sharer goes unseen.
+  write_comm(fixture.root(), 7, "my-meetings");
+  const gchar* same_processes[] = {"other", "other", nullptr};
+  display_detection_update_config(detection, 0, same_processes);
+  gint64 until_us = g_get_monotonic_time() + 100 * G_USEC_PER_SEC / 1000;
+  while (g_get_monotonic_time() < until_us) {
+    g_main_context_iteration(nullptr, FALSE);
+  }
+  EXPECT_EQ(recorder.calls, 1);
+
+  // New rules: the process probe runs again right away, without a restart.
+  const gchar* new_processes[] = {"my-meetings", "other", nullptr};
+  display_detection_update_config(detection, 0, new_processes);
+  gint64 give_up_us = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+  while (recorder.calls == 1 && g_get_monotonic_time() < give_up_us) {
+    g_main_context_iteration(nullptr, FALSE);
+  }
+  EXPECT_EQ(recorder.calls, 2);
+  EXPECT_TRUE(recorder.is_screen_shared);
+
+  display_detection_free(detection);
+}
+
+TEST(DisplayDetection, FindsScreenSharingProcessPastFirstBatch) {
+  ProcFixture fixture(BATCHED_READS_MAX_BATCH * 3);
+  write_comm(fixture.root(), BATCHED_READS_MAX_BATCH * 2 + 5, "discord");
+
+  ChangeRecorder recorder;
+  DisplayDetection* detection = display_detection_new(record_change, &recorder);
+  display_detection_set_proc_root(detection, fixture.root());
+  display_detection_start(detection, 2000, nullptr);
+
+  EXPECT_TRUE(recorder.is_screen_shared);
+
+  display_detection_free(detection);
+}
+
+TEST(BatchedReads, RingAndFallbackReadTheSameContents) {
+  constexpr guint kPidCount = BATCHED_READS_MAX_BATCH + 10;
+  ProcFixture fixture(kPidCount);
+
+  std::vector<gchar*> paths;
+  for (guint pid = 1; pid <= kPidCount; pid++) {
+    paths.push_back(g_strdup_printf("%s/%u/comm", fixture.root(), pid));
+  }
+  paths.push_back(g_strdup_printf("%s/missing/comm", fixture.root()));
+
+  ReadRecorder results[2];
+  for (gboolean use_io_uring : {FALSE, TRUE}) {
+    BatchedReads* reads = batched_reads_new(use_io_uring);
+    batched_reads_run(reads, paths.data(), paths.size(), record_read,
+                      &results[use_io_uring]);
+    batched_reads_free(reads);
+  }
+
+  ASSERT_EQ(results[0].contents.size(), paths.size());
+  EXPECT_EQ(results[0].contents, results[1].contents);
+  EXPECT_EQ(results[0].contents.front(), "bash\n");
+  EXPECT_EQ(results[0].contents.back(), "<unreadable>");
+
+  for (gchar* path : paths) g_free(path);
+}
+
+TEST(DisplayDetection, MatchesCaptureLibrariesDespiteProcessName) {
+  ProcFixture fixture(100);
+  write_exe(fixture.root(), 42, "renamed-obs", "/usr/lib/libobs.so.30");
+
+  for (guint threads : {1u, 4u}) {
+    ChangeRecorder recorder;
+    DisplayDetection* detection =
+        display_detection_new(record_change, &recorder);
+    display_detection_set_proc_root(detection, fixture.root());
+    display_detection_set_scan_threads(detection, threads);
+    display_detection_start(detection, 2000, nullptr);
+    EXPECT_FALSE(recorder.is_screen_shared) << threads << " threads";
+
+    display_detection_stop(detection);
+    display_detection_set_library_signatures(detection, TRUE);
+    display_detection_start(detection, 2000, nullptr);
+    EXPECT_TRUE(recorder.is_screen_shared) << threads << " threads";
+
+    display_detection_free(detection);
+  }
+}
+
+TEST(ExeSignatures, InspectsEachExecutableOnce) {
+  ProcFixture fixture(0);
+  write_exe(fixture.root(), 1, "obs", "/usr/lib/libobs.so.30");
+  write_exe(fixture.root(), 2, "obs", "/usr/lib/libobs.so.30");
+  write_exe(fixture.root(), 3, "ffmpeg", "/usr/lib/libavdevice.so.60");
+  write_exe(fixture.root(), 4, "editor", "/usr/lib/libobsolete.so.1");
+  write_comm(fixture.root(), 5, "kworker");
+
+  ExeSignatures* signatures = exe_signatures_new(fixture.root());
+  EXPECT_TRUE(exe_signatures_match(signatures, 1));
+  EXPECT_TRUE(exe_signatures_match(signatures, 2));
+  // x11grab needs libxcb-shm alongside libavdevice.
+  EXPECT_FALSE(exe_signatures_match(signatures, 3));
+  EXPECT_FALSE(exe_signatures_match(signatures, 4));
+  // No exe link, like a kernel thread; not cached.
+  EXPECT_FALSE(exe_signatures_match(signatures, 5));
+  EXPECT_FALSE(exe_signatures_match(signatures, 5));
+  EXPECT_EQ(exe_signatures_get_inspected_count(signatures), 3u);
+
+  // A known executable costs a stat, not another read of its maps.
+  EXPECT_TRUE(exe_signatures_match(signatures, 1));
+  EXPECT_EQ(exe_signatures_get_inspected_count(signatures), 3u);
+
+  exe_signatures_free(signatures);
+}
+
+TEST(DisplayDetection, ShardedScanFindsScreenSharingProcess) {
+  ProcFixture fixture(1000);
+  write_comm(fixture.root(), 900, "teams");
+
+  ChangeRecorder recorder;
+  DisplayDetection* detection = display_detection_new(record_change, &recorder);
+  display_detection_set_proc_root(detection, fixture.root());
+  display_detection_set_scan_threads(detection, 4);
+  display_detection_start(detection, 2000, nullptr);
+
+  EXPECT_TRUE(recorder.is_screen_shared);
+
+  display_detection_free(detection);
+}
+
+TEST(ProcShards, ReportsMatchesInPidOrderForAnyThreadCount) {
+  constexpr guint kPidCount = 500;
+  ProcFixture fixture(kPidCount);
+  for (guint pid : {499u, 3u, 250u}) write_comm(fixture.root(), pid, "obs");
+
+  for (guint threads : {1u, 2u, 4u, 7u}) {
+    ProcShards* shards = proc_shards_new(fixture.root(), threads);
+    GArray* matches = g_array_new(FALSE, FALSE, sizeof(guint));
+    guint examined = proc_shards_scan(shards, is_obs, nullptr, FALSE, matches);
+
+    EXPECT_EQ(examined, kPidCount) << threads << " threads";
+    ASSERT_EQ(matches->len, 3u) << threads << " threads";
+    EXPECT_EQ(g_array_index(matches, guint, 0), 3u);
+    EXPECT_EQ(g_array_index(matches, guint, 1), 250u);
+    EXPECT_EQ(g_array_index(matches, guint, 2), 499u);
+
+    g_array_unref(matches);
+    proc_shards_free(shards);
+  }
+}
+
+TEST(ProcShards, StopsEveryShardOnceAnyMatches) {
+  ProcFixture fixture(2000);
+  write_comm(fixture.root(), 1, "obs");
+
+  ProcShards* shards = proc_shards_new(fixture.root(), 4);
+  GArray* matches = g_array_new(FALSE, FALSE, sizeof(guint));
+  for (gint i = 0; i < 10; i++) {
+    g_array_set_size(matches, 0);
+    proc_shards_scan(shards, is_obs, nullptr, TRUE, matches);
+    ASSERT_EQ(matches->len, 1u);
+    EXPECT_EQ(g_array_index(matches, guint, 0), 1u);
+  }
+
+  g_array_unref(matches);
+  proc_shards_free(shards);
+}
+
+TEST(ProcScope, KeepsTheUsersProcessesInTheSession) {
+  ProcFixture fixture(0);
+  for (guint pid = 1; pid <= 3; pid++) {
+    write_comm(fixture.root(), pid, "bash");
+    write_exe(fixture.root(), pid, "bash", "/usr/lib/libc.so.6");
+  }
+  write_comm(fixture.root(), 5, "kworker/0:1");
+  g_autofree gchar* session_2 =
+      g_build_filename(fixture.root(), "2", "sessionid", NULL);
+  ASSERT_TRUE(g_file_set_contents(session_2, "3", -1, NULL));
+  g_autofree gchar* session_3 =
+      g_build_filename(fixture.root(), "3", "sessionid", NULL);
+  ASSERT_TRUE(g_file_set_contents(session_3, "4", -1, NULL));
+  DIR* dir = opendir(fixture.root());
+  ASSERT_NE(dir, nullptr);
+  int fd = dirfd(dir);
+
+  ProcScope* user = proc_scope_new(geteuid(), nullptr);
+  EXPECT_TRUE(proc_scope_contains(user, fd, "1"));
+  EXPECT_TRUE(proc_scope_contains(user, fd, "2"));
+  EXPECT_TRUE(proc_scope_contains(user, fd, "3"));
+  EXPECT_FALSE(proc_scope_contains(user, fd, "4"));
+  // Only root's entries need an exe link; kernel threads have none.
+  EXPECT_EQ(proc_scope_contains(user, fd, "5"), geteuid() != 0);
+  proc_scope_free(user);
+
+  ProcScope* other_user = proc_scope_new(geteuid() + 1, nullptr);
+  EXPECT_FALSE(proc_scope_contains(other_user, fd, "1"));
+  proc_scope_free(other_user);
+
+  ProcScope* session = proc_scope_new(geteuid(), "3");
+  EXPECT_FALSE(proc_scope_contains(session, fd, "1"));
+  EXPECT_TRUE(proc_scope_contains(session, fd, "2"));
+  EXPECT_FALSE(proc_scope_contains(session, fd, "3"));
+  proc_scope_free(session);
+
+  EXPECT_TRUE(proc_scope_contains(nullptr, fd, "5"));
+  closedir(dir);
+}
+
+TEST(ProcShards, ReadsOnlyProcessesInScope) {
+  ProcFixture fixture(0);
+  for (guint pid = 1; pid <= 40; pid++) {
+    write_comm(fixture.root(), pid, "obs");
+    write_exe(fixture.root(), pid, "obs", "/usr/lib/libc.so.6");
+    g_autofree gchar* name = g_strdup_printf("%u", pid);
+    g_autofree gchar* session_path =
+        g_build_filename(fixture.root(), name, "sessionid", NULL);
+    ASSERT_TRUE(
+        g_file_set_contents(session_path, pid % 4 == 0 ? "3" : "4", -1, NULL));
+  }
+
+  ProcScope* session = proc_scope_new(geteuid(), "3");
+  for (guint threads : {1u, 4u}) {
+    ProcShards* shards = proc_shards_new(fixture.root(), threads);
+    proc_shards_set_scope(shards, session);
+    GArray* matches = g_array_new(FALSE, FALSE, sizeof(guint));
+    EXPECT_EQ(proc_shards_scan(shards, is_obs, nullptr, FALSE, matches), 10u)
+        << threads << " threads";
+    ASSERT_EQ(matches->len, 10u) << threads << " threads";
+    for (guint i = 0; i < matches->len; i++) {
+      EXPECT_EQ(g_array_index(matches, guint, i), 4 * (i + 1));
+    }
+    g_array_unref(matches);
+    proc_shards_free(shards);
+  }
+  proc_scope_free(session);
+}
+
+TEST(DisplayDetection, ScopedScanFindsTheUsersScreenSharingProcess) {
+  ProcFixture fixture(0);
+  for (guint pid = 1; pid <= 50; pid++) {
+    write_comm(fixture.root(), pid, pid == 42 ? "zoom" : "bash");
+    write_exe(fixture.root(), pid, "bin", "/usr/lib/libc.so.6");
+  }
+
+  for (guint threads : {1u, 4u}) {
+    ChangeRecorder recorder;
+    DisplayDetection* detection =
+        display_detection_new(record_change, &recorder);
+    display_detection_set_proc_root(detection, fixture.root());
+    display_detection_set_process_scope(detection,
+                                        DISPLAY_DETECTION_PROCESS_SCOPE_USER);
+    display_detection_set_scan_threads(detection, threads);
+    display_detection_start(detection, 2000, nullptr);
+
+    EXPECT_TRUE(recorder.is_screen_shared) << threads << " threads";
+
+    display_detection_free(detection);
+  }
+}
+
+// CPU time of the calling thread, which unlike wall time does not include
+// the time other processes preempted it for.
+gint64 thread_cpu_us() {
+  struct timespec now;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  return (gint64)now.tv_sec * G_USEC_PER_SEC + now.tv_nsec / 1000;
+}
+
+// Runs one main-loop iteration without blocking and returns the CPU time the
+// dispatch itself took, or -1 if nothing was ready.
+gint64 time_dispatch(GMainContext* context) {
+  gint priority;
+  g_main_context_prepare(context, &priority);
+  GPollFD fds[16];
+  gint timeout;
+  gint count = g_main_context_query(context, priority, &timeout, fds, 16);
+  g_poll(fds, MIN(count, 16), 0);
+  if (!g_main_context_check(context, priority, fds, MIN(count, 16))) {
+    return -1;
+  }
+  gint64 start_us = thread_cpu_us();
+  g_main_context_dispatch(context);
+  return thread_cpu_us() - start_us;
+}
+
+TEST(DisplayDetection, SlicedScanKeepsEveryDispatchWithinBudget) {
+  constexpr guint kPidCount = 50000;
+  constexpr guint kSliceBudgetUs = 500;
+  // The entry being read when the deadline passes still completes, and its
+  // readdir() may first refill glibc's 32 KiB directory buffer, about a
+  // thousand entries at once (up to half a millisecond here). Slices are
+  // timed in CPU time, so preemption on a loaded machine does not count
+  // against them.
+  constexpr gint64 kToleranceUs = 600;
+  // Interrupts and page faults are charged to the thread too; a few slices
+  // may take that much longer, but never another whole budget.
+  constexpr size_t kMaxSlowSlices = 3;
+  constexpr gint64 kSlowSliceCapUs = 2 * kSliceBudgetUs + kToleranceUs;
+
+  ProcFixture fixture(kPidCount);
+  ProcFixture drm(0);
+  write_connector(drm.root(), "card0-eDP-1", "connected");
+  write_comm(fixture.root(), kPidCount, "obs");
+
+  ChangeRecorder recorder;
+  DisplayDetection* detection = display_detection_new(record_change, &recorder);
+  display_detection_set_proc_root(detection, fixture.root());
+  display_detection_set_drm_root(detection, drm.root());
+  display_detection_set_scan_slice_budget(detection, kSliceBudgetUs);
+  // Nothing but the slices is dispatched while the pass runs.
+  display_detection_start(detection, 60 * 60 * 1000, nullptr);
+  ASSERT_EQ(recorder.calls, 1);
+  ASSERT_TRUE(recorder.is_screen_shared);
+
+  // Concluding that nothing is shared takes a walk over every entry.
+  write_comm(fixture.root(), kPidCount, "bash");
+  std::vector<gint64> slice_us;
+  // The first slice runs right inside the poll.
+  gint64 poll_start_us = thread_cpu_us();
+  display_detection_poll(detection, DISPLAY_DETECTION_FIELD_SCREEN_SHARED);
+  slice_us.push_back(thread_cpu_us() - poll_start_us);
+
+  GMainContext* context = g_main_context_default();
+  ASSERT_TRUE(g_main_context_acquire(context));
+  gint64 give_up_us = g_get_monotonic_time() + 30 * G_USEC_PER_SEC;
+  while (recorder.calls == 1 && g_get_monotonic_time() < give_up_us) {
+    gint64 elapsed_us = time_dispatch(context);
+    if (elapsed_us >= 0) slice_us.push_back(elapsed_us);
+  }
+  g_main_context_release(context);
+
+  EXPECT_EQ(recorder.calls, 2);
+  EXPECT_FALSE(recorder.is_screen_shared);
+  // The pass was spread over several dispatches and committed once.
+  ASSERT_GT(slice_us.size(), 2u);
+  size_t slow_slices = 0;
+  for (size_t i = 0; i < slice_us.size(); i++) {
+    EXPECT_LE(slice_us[i], kSlowSliceCapUs)
+        << "slice " << i << " of " << slice_us.size();
+    if (slice_us[i] > kSliceBudgetUs + kToleranceUs) slow_slices++;
+  }
+  EXPECT_LE(slow_slices, kMaxSlowSlices) << "of " << slice_us.size();
+
+  display_detection_free(detection);
+}
+
+TEST(StateCache, RestoresStateSavedDuringTheSameBoot) {
+  ProcFixture dir(0);
+  g_autofree gchar* path = g_build_filename(dir.root(), "cache", "state", NULL);
+  CachedState saved = {FALSE, TRUE, 2, TRUE, 123456789};
+  ASSERT_TRUE(state_cache_save(path, "boot-a", &saved));
+
+  CachedState loaded = {};
+  ASSERT_TRUE(state_cache_load(path, "boot-a", &loaded));
+  EXPECT_FALSE(loaded.is_screen_mirrored);
+  EXPECT_TRUE(loaded.is_external_connected);
+  EXPECT_EQ(loaded.display_count, 2);
+  EXPECT_TRUE(loaded.is_screen_shared);
+  EXPECT_EQ(loaded.detected_at_us, 123456789);
+}
+
+TEST(StateCache, IgnoresStateFromAnotherBoot) {
+  ProcFixture dir(0);
+  g_autofree gchar* path = g_build_filename(dir.root(), "state", NULL);
+  CachedState saved = {FALSE, TRUE, 2, FALSE, 42};
+  ASSERT_TRUE(state_cache_save(path, "boot-a", &saved));
+
+  CachedState loaded;
+  EXPECT_FALSE(state_cache_load(path, "boot-b", &loaded));
+  EXPECT_FALSE(state_cache_load(path, NULL, &loaded));
+}
+
+TEST(StateCache, IgnoresMissingOrMalformedFiles) {
+  ProcFixture dir(0);
+  g_autofree gchar* path = g_build_filename(dir.root(), "state", NULL);
+  CachedState loaded;
+  EXPECT_FALSE(state_cache_load(path, "boot-a", &loaded));
+
+  ASSERT_TRUE(g_file_set_contents(
+      path, "[State]\nBootId=boot-a\nDisplayCount=two\n", -1, NULL));
+  EXPECT_FALSE(state_cache_load(path, "boot-a", &loaded));
+}
+
+TEST(StateCache, ReadsTheCurrentBootId) {
+  g_autofree gchar* first = state_cache_read_boot_id();
+  g_autofree gchar* second = state_cache_read_boot_id();
+  if (first == nullptr) GTEST_SKIP() << "no boot_id in /proc";
+  EXPECT_STREQ(first, second);
+  EXPECT_EQ(strchr(first, '\n'), nullptr);
+}
+
+TEST(StateExport, ReaderSeesPublishedState) {
+  g_autofree gchar* name = g_strdup_printf("/nsm_test_%d", getpid());
+  StateExport* state_export = state_export_new(name);
+  ASSERT_NE(state_export, nullptr);
+
+  const NsmSharedState* shared = nsm_shared_state_map(name);
+  ASSERT_NE(shared, nullptr);
+  NsmStateSnapshot snapshot;
+  // Nothing published yet.
+  EXPECT_FALSE(nsm_shared_state_read(shared, &snapshot));
+
+  state_export_publish(state_export, FALSE, TRUE, 2, TRUE, 7, 123456);
+  ASSERT_TRUE(nsm_shared_state_read(shared, &snapshot));
+  EXPECT_EQ(snapshot.flags,
+            NSM_STATE_EXTERNAL_DISPLAY_CONNECTED | NSM_STATE_SCREEN_SHARED);
+  EXPECT_EQ(snapshot.display_count, 2);
+  EXPECT_EQ(snapshot.writer_pid, getpid());
+  EXPECT_EQ(snapshot.sequence, 7u);
+  EXPECT_EQ(snapshot.detected_at_us, 123456);
+
+  munmap((void*)shared, sizeof(NsmSharedState));
+  state_export_free(state_export);
+  // Freeing removes the segment.
+  EXPECT_EQ(nsm_shared_state_map(name), nullptr);
+}
+
+TEST(StateExport, ReaderNeverSeesTornState) {
+  g_autofree gchar* name = g_strdup_printf("/nsm_test_torn_%d", getpid());
+  StateExport* state_export = state_export_new(name);
+  ASSERT_NE(state_export, nullptr);
+  const NsmSharedState* shared = nsm_shared_state_map(name);
+  ASSERT_NE(shared, nullptr);
+
+  // Every published state derives its fields from the sequence number, so a
+  // mix of two updates is detectable.
+  static constexpr guint64 kUpdates = 200000;
+  GThread* writer = g_thread_new(
+      "writer",
+      [](gpointer data) -> gpointer {
+        auto* state_export = static_cast<StateExport*>(data);
+        for (guint64 sequence = 1; sequence <= kUpdates; sequence++) {
+          state_export_publish(state_export, sequence & 1, sequence & 2,
+                               (gint)(sequence % 1000), sequence & 4,
+                               sequence, (gint64)sequence * 3);
+        }
+        return nullptr;
+      },
+      state_export);
+
+  guint64 last_sequence = 0;
+  guint torn = 0;
+  while (last_sequence < kUpdates) {
+    NsmStateSnapshot snapshot;
+    if (!nsm_shared_state_read(shared, &snapshot)) continue;
+    if (snapshot.display_count != (gint)(snapshot.sequence % 1000) ||
+        snapshot.flags != (snapshot.sequence & 7) ||
+        snapshot.detected_at_us != (gint64)snapshot.sequence * 3 ||
+        snapshot.sequence < last_sequence) {
+      torn++;
+    }
+    last_sequence = snapshot.sequence;
+  }
+  g_thread_join(writer);
+
+  EXPECT_EQ(torn, 0u);
+
+  munmap((void*)shared, sizeof(NsmSharedState));
+  state_export_free(state_export);
+}
+
+TEST(StateJournal, ReaderSeesTransitionsAcrossRestarts) {
+  ProcFixture dir(0);
+  g_autofree gchar* path = g_build_filename(dir.root(), "journal", NULL);
+  StateJournal* journal = state_journal_new(path, 8);
+  ASSERT_NE(journal, nullptr);
+  // One writer per file.
+  EXPECT_EQ(state_journal_new(path, 8), nullptr);
+  state_journal_append(journal, FALSE, FALSE, 1, FALSE, 1,
+                       g_get_monotonic_time(), NSM_JOURNAL_CAUSE_FIRST_SCAN);
+  state_journal_append(journal, FALSE, TRUE, 2, FALSE, 2,
+                       g_get_monotonic_time(), NSM_JOURNAL_CAUSE_DISPLAYS);
+  state_journal_free(journal);
+
+  gint64 before_us = g_get_real_time();
+  journal = state_journal_new(path, 8);
+  ASSERT_NE(journal, nullptr);
+  state_journal_append(journal, FALSE, TRUE, 2, TRUE, 1,
+                       g_get_monotonic_time(),
+                       NSM_JOURNAL_CAUSE_FIRST_SCAN |
+                           NSM_JOURNAL_CAUSE_SHARING);
+
+  size_t size;
+  const NsmJournalHeader* header = nsm_journal_map(path, &size);
+  ASSERT_NE(header, nullptr);
+  EXPECT_EQ(size, sizeof(NsmJournalHeader) + 8 * sizeof(NsmJournalRecord));
+  EXPECT_EQ(nsm_journal_tail(header), 0u);
+  ASSERT_EQ(nsm_journal_head(header), 3u);
+  NsmJournalRecord record;
+  ASSERT_TRUE(nsm_journal_read(header, 1, &record));
+  EXPECT_EQ(record.sequence, 2u);
+  EXPECT_EQ(NSM_JOURNAL_STATE_FLAGS(record.state),
+            NSM_STATE_EXTERNAL_DISPLAY_CONNECTED);
+  EXPECT_EQ(NSM_JOURNAL_STATE_DISPLAY_COUNT(record.state), 2);
+  EXPECT_EQ(record.cause, NSM_JOURNAL_CAUSE_DISPLAYS);
+  ASSERT_TRUE(nsm_journal_read(header, 2, &record));
+  EXPECT_EQ(record.sequence, 1u);
+  EXPECT_EQ(NSM_JOURNAL_STATE_FLAGS(record.state),
+            NSM_STATE_EXTERNAL_DISPLAY_CONNECTED | NSM_STATE_SCREEN_SHARED);
+  EXPECT_GE(record.detected_at_wall_us, before_us - G_USEC_PER_SEC);
+  EXPECT_LE(record.detected_at_wall_us, g_get_real_time());
+
+  munmap((void*)header, size);
+  state_journal_free(journal);
+}
+
+TEST(StateJournal, KeepsTheNewestRecordsAndSkipsTornOnes) {
+  ProcFixture dir(0);
+  g_autofree gchar* path = g_build_filename(dir.root(), "journal", NULL);
+  StateJournal* journal = state_journal_new(path, 4);
+  ASSERT_NE(journal, nullptr);
+  for (guint64 sequence = 1; sequence <= 6; sequence++) {
+    state_journal_append(journal, FALSE, FALSE, 1, sequence % 2 == 0,
+                         sequence, g_get_monotonic_time(),
+                         NSM_JOURNAL_CAUSE_SHARING);
+  }
+  state_journal_free(journal);
+
+  // Simulate crashes: one mid-copy into position 3's slot, one between
+  // committing position 5 and advancing head.
+  int fd = open(path, O_RDWR);
+  ASSERT_GE(fd, 0);
+  size_t size = sizeof(NsmJournalHeader) + 4 * sizeof(NsmJournalRecord);
+  NsmJournalHeader* writable = (NsmJournalHeader*)mmap(
+      nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  ASSERT_NE(writable, MAP_FAILED);
+  ((NsmJournalRecord*)(writable + 1))[3 % 4].commit = 0;
+  writable->head = 5;
+  munmap(writable, size);
+
+  const NsmJournalHeader* header = nsm_journal_map(path, &size);
+  ASSERT_NE(header, nullptr);
+  EXPECT_EQ(nsm_journal_head(header), 6u);
+  EXPECT_EQ(nsm_journal_tail(header), 2u);
+  NsmJournalRecord record;
+  // Overwritten by the ring.
+  EXPECT_FALSE(nsm_journal_read(header, 1, &record));
+  ASSERT_TRUE(nsm_journal_read(header, 2, &record));
+  EXPECT_EQ(record.sequence, 3u);
+  EXPECT_FALSE(nsm_journal_read(header, 3, &record));
+  ASSERT_TRUE(nsm_journal_read(header, 5, &record));
+  EXPECT_EQ(record.sequence, 6u);
+  munmap((void*)header, size);
+
+  // A restarted writer continues after the recovered record.
+  journal = state_journal_new(path, 4);
+  ASSERT_NE(journal, nullptr);
+  state_journal_append(journal, FALSE, FALSE, 1, FALSE, 1,
+                       g_get_monotonic_time(), NSM_JOURNAL_CAUSE_FIRST_SCAN);
+  state_journal_free(journal);
+  header = nsm_journal_map(path, &size);
+  ASSERT_NE(header, nullptr);
+  EXPECT_EQ(nsm_journal_head(header), 7u);
+  munmap((void*)header, size);
+}
+
+// Connects to the metrics socket at |path|, optionally sends |request|, and
+// returns everything read until the server closes the connection.
+std::string scrape(const gchar* path, const gchar* request) {
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  struct sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  g_strlcpy(address.sun_path, path, sizeof(address.sun_path));
+  if (connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+    close(fd);
+    return "";
+  }
+  if (request != nullptr) send(fd, request, strlen(request), MSG_NOSIGNAL);
+  std::string text;
+  gchar buffer[4096];
+  ssize_t received;
+  while ((received = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+    text.append(buffer, received);
+  }
+  close(fd);
+  return text;
+}
+
+TEST(MetricsExport, ServesDetectorMetricsOnASocket) {
+  ProcFixture proc(50);
+  ProcFixture dir(0);
+  g_autofree gchar* socket_path =
+      g_build_filename(dir.root(), "metrics.sock", NULL);
+  MetricsExport* metrics_export = metrics_export_new(socket_path, nullptr);
+  ASSERT_NE(metrics_export, nullptr);
+
+  ChangeRecorder recorder;
+  DisplayDetection* detection = display_detection_new(record_change, &recorder);
+  display_detection_set_metrics(detection, metrics_export);
+  display_detection_set_proc_root(detection, proc.root());
+  g_autofree gchar* missing_drm =
+      g_build_filename(dir.root(), "missing", NULL);
+  display_detection_set_drm_root(detection, missing_drm);
+  display_detection_start(detection, 2000, nullptr);
+
+  std::string text = scrape(socket_path, nullptr);
+  EXPECT_NE(text.find("\nno_screen_mirror_scan_duration_seconds_count{probe="
+                      "\"processes\"} 1\n"),
+            std::string::npos);
+  EXPECT_NE(text.find("\nno_screen_mirror_probe_errors_total{probe="
+                      "\"connectors\"} 1\n"),
+            std::string::npos);
+  EXPECT_NE(text.find("\nno_screen_mirror_process_table_size 50\n"),
+            std::string::npos);
+
+  // HTTP clients get the same exposition behind a status line.
+  std::string response =
+      scrape(socket_path, "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n");
+  EXPECT_EQ(response.rfind("HTTP/1.0 200 OK\r\n", 0), 0u);
+  EXPECT_NE(response.find("\r\n\r\n# HELP "), std::string::npos);
+
+  display_detection_free(detection);
+  metrics_export_free(metrics_export);
+  EXPECT_FALSE(g_file_test(socket_path, G_FILE_TEST_EXISTS));
+}
+
+TEST(MetricsExport, ReplacesOnlyAStaleSocket) {
+  ProcFixture dir(0);
+  g_autofree gchar* file_path = g_build_filename(dir.root(), "notes", NULL);
+  ASSERT_TRUE(g_file_set_contents(file_path, "keep", -1, NULL));
+  EXPECT_EQ(metrics_export_new(file_path, nullptr), nullptr);
+  EXPECT_TRUE(g_file_test(file_path, G_FILE_TEST_IS_REGULAR));
+
+  g_autofree gchar* socket_path =
+      g_build_filename(dir.root(), "metrics.sock", NULL);
+  MetricsExport* first = metrics_export_new(socket_path, nullptr);
+  ASSERT_NE(first, nullptr);
+  EXPECT_EQ(metrics_export_new(socket_path, nullptr), nullptr);
+  EXPECT_NE(scrape(socket_path, nullptr).find("# TYPE"), std::string::npos);
+
+  // A socket nobody listens on any more is taken over.
+  int stale_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  struct sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  g_autofree gchar* stale_path = g_build_filename(dir.root(), "stale", NULL);
+  g_strlcpy(address.sun_path, stale_path, sizeof(address.sun_path));
+  ASSERT_EQ(bind(stale_fd, (struct sockaddr*)&address, sizeof(address)), 0);
+  close(stale_fd);
+  MetricsExport* second = metrics_export_new(stale_path, nullptr);
+  EXPECT_NE(second, nullptr);
+
+  metrics_export_free(second);
+  metrics_export_free(first);
+}
+
+TEST(MetricsExport, LowPowerModeAlignsWakeupsToWholeSeconds) {
+  ProcFixture proc(10);
+  ProcFixture drm(0);
+  write_connector(drm.root(), "card0-HDMI-A-1", "disconnected");
+  ProcFixture dir(0);
+  g_autofree gchar* socket_path =
+      g_build_filename(dir.root(), "metrics.sock", NULL);
+  MetricsExport* metrics_export = metrics_export_new(socket_path, nullptr);
+  ASSERT_NE(metrics_export, nullptr);
+
+  ChangeRecorder recorder;
+  DisplayDetection* detection = display_detection_new(record_change, &recorder);
+  display_detection_set_metrics(detection, metrics_export);
+  display_detection_set_proc_root(detection, proc.root());
+  display_detection_set_drm_root(detection, drm.root());
+  display_detection_set_probe_intervals(detection, 10, 30);
+  display_detection_set_low_power(detection, TRUE);
+  display_detection_start(detection, 2000, nullptr);
+  write_connector(drm.root(), "card0-HDMI-A-1", "connected");
+  write_comm(proc.root(), 7, "zoom");
+
+  // Without alignment this would be well over a hundred wakeups.
+  gint64 until_us = g_get_monotonic_time() + 1500 * 1000;
+  while (g_get_monotonic_time() < until_us) {
+    g_main_context_iteration(nullptr, FALSE);
+  }
+  std::string text = scrape(socket_path, nullptr);
+  const std::string name = "\nno_screen_mirror_wakeups_total ";
+  size_t at = text.find(name);
+  ASSERT_NE(at, std::string::npos);
+  gint wakeups = atoi(text.c_str() + at + name.size());
+  EXPECT_GE(wakeups, 1);
+  EXPECT_LE(wakeups, 2);
+  // Both probes ran on the same wakeup.
+  EXPECT_EQ(recorder.calls, 2);
+  EXPECT_TRUE(recorder.is_external_connected);
+  EXPECT_TRUE(recorder.is_screen_shared);
+
+  display_detection_free(detection);
+  metrics_export_free(metrics_export);
+}
+
+TEST(MetricsExport, WritesAndRemovesTheTextfile) {
+  ProcFixture dir(0);
+  g_autofree gchar* textfile_path =
+      g_build_filename(dir.root(), "no_screen_mirror.prom", NULL);
+  MetricsExport* metrics_export = metrics_export_new(nullptr, textfile_path);
+  ASSERT_NE(metrics_export, nullptr);
+  metrics_export_set_state(metrics_export, FALSE, TRUE, 2, FALSE);
+  metrics_export_record_event(metrics_export, 4);
+
+  // The first write happens as soon as the thread starts.
+  for (gint attempt = 0; attempt < 100; attempt++) {
+    if (g_file_test(textfile_path, G_FILE_TEST_EXISTS)) break;
+    g_usleep(10000);
+  }
+  g_autofree gchar* text = nullptr;
+  ASSERT_TRUE(g_file_get_contents(textfile_path, &text, nullptr, nullptr));
+  EXPECT_NE(strstr(text, "# TYPE no_screen_mirror_events_total counter\n"),
+            nullptr);
+
+  metrics_export_free(metrics_export);
+  EXPECT_FALSE(g_file_test(textfile_path, G_FILE_TEST_EXISTS));
+}
+
+struct StateLog {
+  std::vector<std::string> states;
+};
+
+void log_state(gboolean is_external_connected, gint display_count,
+               gboolean is_screen_shared, gpointer user_data) {
+  static_cast<StateLog*>(user_data)->states.push_back(
+      std::string(is_external_connected ? "external " : "internal ") +
+      std::to_string(display_count) + (is_screen_shared ? " shared" : ""));
+}
+
+TEST(ProbeTrace, ReplayReproducesTheRecordedStates) {
+  ProcFixture proc(20);
+  ProcFixture drm(0);
+  write_connector(drm.root(), "card0-eDP-1", "connected");
+  write_connector(drm.root(), "card0-HDMI-A-1", "disconnected");
+  ProcFixture dir(0);
+  g_autofree gchar* trace_path = g_build_filename(dir.root(), "trace", NULL);
+  ProbeTraceWriter* writer = probe_trace_writer_new(trace_path);
+  ASSERT_NE(writer, nullptr);
+
+  StateLog recorded;
+  DisplayDetection* detection = display_detection_new(log_state, &recorded);
+  display_detection_set_proc_root(detection, proc.root());
+  display_detection_set_drm_root(detection, drm.root());
+  display_detection_set_probe_trace(detection, writer);
+  display_detection_start(detection, 60000, nullptr);
+  write_comm(proc.root(), 7, "obs");
+  display_detection_poll(detection, DISPLAY_DETECTION_FIELD_SCREEN_SHARED);
+  write_connector(drm.root(), "card0-HDMI-A-1", "connected");
+  display_detection_poll(detection, DISPLAY_DETECTION_FIELDS_ALL);
+  write_comm(proc.root(), 7, "bash");
+  display_detection_poll(detection, DISPLAY_DETECTION_FIELD_SCREEN_SHARED);
+  display_detection_free(detection);
+  probe_trace_writer_free(writer);
+  ASSERT_EQ(recorded.states.size(), 4u);
+
+  // Replay it the way nsm-replay does: both first ticks, then a poll of the
+  // matching probe per tick.
+  ProbeTraceReader* reader = probe_trace_reader_new(trace_path);
+  ASSERT_NE(reader, nullptr);
+  ProcFixture replay_proc(0);
+  ProcFixture replay_drm(0);
+  StateLog replayed;
+  detection = display_detection_new(log_state, &replayed);
+  display_detection_set_proc_root(detection, replay_proc.root());
+  display_detection_set_drm_root(detection, replay_drm.root());
+  ProbeTraceProbe probes[6];
+  gint64 offsets[6];
+  for (gint tick = 0; tick < 6; tick++) {
+    ASSERT_TRUE(probe_trace_reader_next(reader, replay_proc.root(),
+                                        replay_drm.root(), &probes[tick],
+                                        &offsets[tick]));
+    if (tick == 1) {
+      display_detection_start(detection, 60000, nullptr);
+    } else if (tick > 1) {
+      display_detection_poll(detection,
+                             probes[tick] == PROBE_TRACE_CONNECTORS
+                                 ? DISPLAY_DETECTION_FIELD_EXTERNAL_DISPLAY
+                                 : DISPLAY_DETECTION_FIELD_SCREEN_SHARED);
+    }
+  }
+  ProbeTraceProbe probe;
+  gint64 offset_us;
+  EXPECT_FALSE(probe_trace_reader_next(reader, replay_proc.root(),
+                                       replay_drm.root(), &probe, &offset_us));
+  probe_trace_reader_free(reader);
+  display_detection_free(detection);
+
+  EXPECT_EQ(probes[0], PROBE_TRACE_CONNECTORS);
+  EXPECT_EQ(probes[1], PROBE_TRACE_PROCESSES);
+  EXPECT_EQ(probes[2], PROBE_TRACE_PROCESSES);
+  EXPECT_EQ(offsets[0], 0);
+  for (gint tick = 1; tick < 6; tick++) {
+    EXPECT_GE(offsets[tick], offsets[tick - 1]);
+  }
+  EXPECT_EQ(replayed.states, recorded.states);
+  EXPECT_EQ(recorded.states.back(), "external 2");
+}
+
+// Replays |trace_path| the way nsm-replay does, matching |custom_processes|,
+// logging the states to |replayed| and each tick's probe to |probes|.
+void replay_trace(const gchar* trace_path, StateLog* replayed,
+                  std::vector<ProbeTraceProbe>* probes,
+                  const gchar** custom_processes = nullptr) {
+  ProbeTraceReader* reader = probe_trace_reader_new(trace_path);
+  ASSERT_NE(reader, nullptr);
+  ProcFixture replay_proc(0);
+  ProcFixture replay_drm(0);
+  DisplayDetection* detection = display_detection_new(log_state, replayed);
+  display_detection_set_proc_root(detection, replay_proc.root());
+  display_detection_set_drm_root(detection, replay_drm.root());
+  ProbeTraceProbe probe;
+  gint64 offset_us;
+  gint64 previous_us = 0;
+  while (probe_trace_reader_next(reader, replay_proc.root(), replay_drm.root(),
+                                 &probe, &offset_us)) {
+    EXPECT_GE(offset_us, previous_us);
+    previous_us = offset_us;
+    probes->push_back(probe);
+    if (probes->size() == 2) {
+      display_detection_start(detection, 60000, (gchar**)custom_processes);
+    } else if (probes->size() > 2) {
+      display_detection_poll(detection,
+                             probe == PROBE_TRACE_CONNECTORS
+                                 ? DISPLAY_DETECTION_FIELD_EXTERNAL_DISPLAY
+                                 : DISPLAY_DETECTION_FIELD_SCREEN_SHARED);
+    }
+  }
+  probe_trace_reader_free(reader);
+  display_detection_free(detection);
+}
+
+TEST(ProbeTrace, RecordsASlicedWalkAcrossAConnectorTick) {
+  ProcFixture proc(3000);
+  ProcFixture drm(0);
+  write_connector(drm.root(), "card0-eDP-1", "connected");
+  write_connector(drm.root(), "card0-HDMI-A-1", "disconnected");
+  ProcFixture dir(0);
+  g_autofree gchar* trace_path = g_build_filename(dir.root(), "trace", NULL);
+  ProbeTraceWriter* writer = probe_trace_writer_new(trace_path);
+  ASSERT_NE(writer, nullptr);
+
+  StateLog recorded;
+  DisplayDetection* detection = display_detection_new(log_state, &recorded);
+  display_detection_set_proc_root(detection, proc.root());
+  display_detection_set_drm_root(detection, drm.root());
+  display_detection_set_probe_trace(detection, writer);
+  display_detection_set_scan_slice_budget(detection, 50);
+  display_detection_start(detection, 60 * 60 * 1000, nullptr);
+
+  // A sliced walk that only finds the sharer at its end, with a connector
+  // tick landing while it yields.
+  write_comm(proc.root(), 2999, "obs");
+  display_detection_poll(detection, DISPLAY_DETECTION_FIELD_SCREEN_SHARED);
+  write_connector(drm.root(), "card0-HDMI-A-1", "connected");
+  display_detection_poll(detection, DISPLAY_DETECTION_FIELD_EXTERNAL_DISPLAY);
+  gint64 give_up_us = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+  while (recorded.states.size() < 3 && g_get_monotonic_time() < give_up_us) {
+    g_main_context_iteration(nullptr, FALSE);
+  }
+  display_detection_free(detection);
+  probe_trace_writer_free(writer);
+  ASSERT_EQ(recorded.states.size(), 3u);
+  EXPECT_EQ(recorded.states[1], "external 2");
+  EXPECT_EQ(recorded.states[2], "external 2 shared");
+
+  StateLog replayed;
+  std::vector<ProbeTraceProbe> probes;
+  replay_trace(trace_path, &replayed, &probes);
+  EXPECT_EQ(probes,
+            std::vector<ProbeTraceProbe>(
+                {PROBE_TRACE_CONNECTORS, PROBE_TRACE_PROCESSES,
+                 PROBE_TRACE_CONNECTORS, PROBE_TRACE_PROCESSES}));
+  EXPECT_EQ(replayed.states, recorded.states);
+}
+
+TEST(ProbeTrace, RecordsTheWalkThatSeesASharerExit) {
+  ProcFixture drm(0);
+  write_connector(drm.root(), "card0-eDP-1", "connected");
+  ProcFixture dir(0);
+  GPid sharer_pid;
+  ASSERT_NO_FATAL_FAILURE(spawn_sharer(dir.root(), &sharer_pid));
+  g_autofree gchar* trace_path = g_build_filename(dir.root(), "trace", NULL);
+  ProbeTraceWriter* writer = probe_trace_writer_new(trace_path);
+  ASSERT_NE(writer, nullptr);
+
+  StateLog recorded;
+  DisplayDetection* detection = display_detection_new(log_state, &recorded);
+  display_detection_set_drm_root(detection, drm.root());
+  display_detection_set_probe_trace(detection, writer);
+  const gchar* custom[] = {"nsm-test-share", nullptr};
+  display_detection_start(detection, 60 * 60 * 1000, (gchar**)custom);
+  ASSERT_EQ(recorded.states.size(), 1u);
+  EXPECT_EQ(recorded.states[0], "internal 1 shared");
+
+  // Unrecorded, a pidfd would clear sharing here; recorded, only the next
+  // walk does.
+  kill(sharer_pid, SIGTERM);
+  reap_sharer(sharer_pid);
+  gint64 settle_us = g_get_monotonic_time() + 200 * 1000;
+  while (g_get_monotonic_time() < settle_us) {
+    g_main_context_iteration(nullptr, FALSE);
+  }
+  EXPECT_EQ(recorded.states.size(), 1u);
+  display_detection_poll(detection, DISPLAY_DETECTION_FIELD_SCREEN_SHARED);
+  display_detection_free(detection);
+  probe_trace_writer_free(writer);
+  ASSERT_EQ(recorded.states.size(), 2u);
+  EXPECT_EQ(recorded.states[1], "internal 1");
+
+  StateLog replayed;
+  std::vector<ProbeTraceProbe> probes;
+  replay_trace(trace_path, &replayed, &probes, custom);
+  EXPECT_EQ(probes, std::vector<ProbeTraceProbe>({PROBE_TRACE_CONNECTORS,
+                                                  PROBE_TRACE_PROCESSES,
+                                                  PROBE_TRACE_PROCESSES}));
+  EXPECT_EQ(replayed.states, recorded.states);
+}
+
+// Two or three "apps" sharing one detector through a private dbus-daemon.
+class SessionServiceTest : public ::testing::Test {
+ protected:
+  struct Instance {
+    GDBusConnection* connection = nullptr;
+    SessionService* service = nullptr;
+    SessionServiceRole role = SESSION_SERVICE_ROLE_PENDING;
+    gint states = 0;
+    gint display_count = 0;
+    guint64 sequence = 0;
+    gint64 detected_at_us = 0;
+  };
+
+  void SetUp() override {
+    g_autofree gchar* daemon = g_find_program_in_path("dbus-daemon");
+    if (daemon == nullptr) GTEST_SKIP() << "dbus-daemon not installed";
+    bus_ = g_test_dbus_new(G_TEST_DBUS_NONE);
+    g_test_dbus_up(bus_);
+  }
+
+  void TearDown() override {
+    for (Instance& instance : instances_) Close(&instance);
+    if (bus_ != nullptr) {
+      g_test_dbus_down(bus_);
+      g_object_unref(bus_);
+    }
+  }
+
+  // Connects a new instance to the bus and queues it for the name.
+  Instance* Join() {
+    instances_.emplace_back();
+    Instance* instance = &instances_.back();
+    instance->connection = g_dbus_connection_new_for_address_sync(
+        g_test_dbus_get_bus_address(bus_),
+        (GDBusConnectionFlags)(
+            G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+            G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION),
+        nullptr, nullptr, nullptr);
+    EXPECT_NE(instance->connection, nullptr);
+    instance->service = session_service_new(
+        instance->connection, "com.flutterplaza.NoScreenMirror.Test",
+        [](SessionServiceRole role, gpointer user_data) {
+          static_cast<Instance*>(user_data)->role = role;
+        },
+        [](gboolean is_screen_mirrored, gboolean is_external_connected,
+           gint display_count, gboolean is_screen_shared, guint64 sequence,
+           gint64 detected_at_us, gpointer user_data) {
+          auto* instance = static_cast<Instance*>(user_data);
+          instance->states++;
+          instance->display_count = display_count;
+          instance->sequence = sequence;
+          instance->detected_at_us = detected_at_us;
+        },
+        instance);
+    EXPECT_NE(instance->service, nullptr);
+    return instance;
+  }
+
+  // Simulates the app exiting: the bus drops its name with the connection.
+  void Close(Instance* instance) {
+    session_service_free(instance->service);
+    instance->service = nullptr;
+    if (instance->connection != nullptr) {
+      g_dbus_connection_close_sync(instance->connection, nullptr, nullptr);
+      g_clear_object(&instance->connection);
+    }
+  }
+
+  // Runs the main loop until |done| returns true or 5 seconds pass.
+  template <typename Predicate>
+  bool RunUntil(Predicate done) {
+    gint64 give_up_us = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+    while (!done() && g_get_monotonic_time() < give_up_us) {
+      g_main_context_iteration(nullptr, FALSE);
+    }
+    return done();
+  }
+
+  GTestDBus* bus_ = nullptr;
+  // std::list keeps the callbacks' Instance pointers stable.
+  std::list<Instance> instances_;
+};
+
+TEST_F(SessionServiceTest, FirstInstanceScansOthersSubscribe) {
+  Instance* owner = Join();
+  ASSERT_TRUE(
+      RunUntil([&] { return owner->role == SESSION_SERVICE_ROLE_OWNER; }));
+  session_service_publish(owner->service, FALSE, TRUE, 2, FALSE, 1, 1000);
+
+  Instance* subscriber = Join();
+  ASSERT_TRUE(RunUntil(
+      [&] { return subscriber->role == SESSION_SERVICE_ROLE_SUBSCRIBER; }));
+  // Catches up with the state published before it joined.
+  ASSERT_TRUE(RunUntil([&] { return subscriber->states == 1; }));
+  EXPECT_EQ(subscriber->display_count, 2);
+  EXPECT_EQ(subscriber->detected_at_us, 1000);
+
+  session_service_publish(owner->service, FALSE, TRUE, 3, TRUE, 2, 2000);
+  ASSERT_TRUE(RunUntil([&] { return subscriber->states == 2; }));
+  EXPECT_EQ(subscriber->display_count, 3);
+  EXPECT_EQ(subscriber->sequence, 2u);
+  EXPECT_EQ(owner->states, 0);
+}
+
+TEST_F(SessionServiceTest, NextInstanceTakesOverWhenOwnerExits) {
+  Instance* owner = Join();
+  ASSERT_TRUE(
+      RunUntil([&] { return owner->role == SESSION_SERVICE_ROLE_OWNER; }));
+  Instance* second = Join();
+  Instance* third = Join();
+  ASSERT_TRUE(RunUntil([&] {
+    return second->role == SESSION_SERVICE_ROLE_SUBSCRIBER &&
+           third->role == SESSION_SERVICE_ROLE_SUBSCRIBER;
+  }));
+
+  Close(owner);
+  // The bus hands the name to the first queued instance.
+  ASSERT_TRUE(
+      RunUntil([&] { return second->role == SESSION_SERVICE_ROLE_OWNER; }));
+  ASSERT_TRUE(
+      RunUntil([&] { return third->role == SESSION_SERVICE_ROLE_SUBSCRIBER; }));
+
+  // The third instance now follows the new owner.
+  session_service_publish(second->service, FALSE, FALSE, 1, TRUE, 1, 3000);
+  ASSERT_TRUE(RunUntil([&] { return third->states == 1; }));
+  EXPECT_EQ(third->detected_at_us, 3000);
+}
+
+}  // namespace test
+}  // namespace no_screen_mirror
@@ -0,0 +1,107 @@
+#include <glib.h>
+#include <stdio.h>
+#include <sys/mman.h>
+
+#include "include/no_screen_mirror/no_screen_mirror_journal.h"
+
+// Dumps a state transition journal (LinuxScanOptions.journalPath or
+// nsm-monitor --journal) as one JSON line per record, oldest first:
+//
+// $ nsm-journal ~/.cache/no_screen_mirror/journal
+// {"position":41,"time":"2026-01-02T03:04:05.678901Z","sequence":1,
+//  "is_screen_mirrored":false,...,"cause":["displays","first_scan"]}
+//
+// Records torn by a crash mid-write are listed as {"position":N,"torn":true}.
+// The journal can be dumped while a detector is still writing it.
+
+namespace {
+
+gboolean skip_torn = FALSE;
+
+const GOptionEntry kOptions[] = {
+    {"skip-torn", 0, 0, G_OPTION_ARG_NONE, &skip_torn,
+     "Leave out records torn by a crash", nullptr},
+    {nullptr}};
+
+const char* bool_json(uint32_t flags, uint32_t bit) {
+  return (flags & bit) != 0 ? "true" : "false";
+}
+
+void print_causes(uint32_t cause) {
+  static const struct {
+    uint32_t bit;
+    const char* name;
+  } kCauses[] = {
+      {NSM_JOURNAL_CAUSE_DISPLAYS, "displays"},
+      {NSM_JOURNAL_CAUSE_SHARING, "sharing"},
+      {NSM_JOURNAL_CAUSE_FIRST_SCAN, "first_scan"},
+      {NSM_JOURNAL_CAUSE_SHARED_DETECTOR, "shared_detector"},
+  };
+  printf("[");
+  const char* separator = "";
+  for (const auto& known : kCauses) {
+    if ((cause & known.bit) == 0) continue;
+    printf("%s\"%s\"", separator, known.name);
+    separator = ",";
+  }
+  printf("]");
+}
+
+void print_record(uint64_t position, const NsmJournalRecord& record) {
+  g_autoptr(GDateTime) seconds = g_date_time_new_from_unix_utc(
+      record.detected_at_wall_us / G_USEC_PER_SEC);
+  g_autoptr(GDateTime) time =
+      g_date_time_add(seconds, record.detected_at_wall_us % G_USEC_PER_SEC);
+  g_autofree gchar* wall_time =
+      time != nullptr ? g_date_time_format_iso8601(time) : g_strdup("");
+
+  uint32_t flags = NSM_JOURNAL_STATE_FLAGS(record.state);
+  printf("{\"position\":%" G_GUINT64_FORMAT ",\"time\":\"%s\",\"sequence\":%"
+         G_GUINT64_FORMAT
+         ",\"is_screen_mirrored\":%s,\"is_external_display_connected\":%s,"
+         "\"display_count\":%d,\"is_screen_shared\":%s,\"cause\":",
+         (guint64)position, wall_time, (guint64)record.sequence,
+         bool_json(flags, NSM_STATE_SCREEN_MIRRORED),
+         bool_json(flags, NSM_STATE_EXTERNAL_DISPLAY_CONNECTED),
+         NSM_JOURNAL_STATE_DISPLAY_COUNT(record.state),
+         bool_json(flags, NSM_STATE_SCREEN_SHARED));
+  print_causes(record.cause);
+  printf("}\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  g_autoptr(GOptionContext) context =
+      g_option_context_new("PATH - print a state transition journal");
+  g_option_context_add_main_entries(context, kOptions, nullptr);
+  g_autoptr(GError) error = nullptr;
+  if (!g_option_context_parse(context, &argc, &argv, &error)) {
+    fprintf(stderr, "nsm-journal: %s\n", error->message);
+    return 2;
+  }
+  if (argc != 2) {
+    fprintf(stderr, "nsm-journal: expected one journal PATH\n");
+    return 2;
+  }
+
+  size_t size;
+  const NsmJournalHeader* journal = nsm_journal_map(argv[1], &size);
+  if (journal == nullptr) {
+    fprintf(stderr, "nsm-journal: %s is not a journal\n", argv[1]);
+    return 1;
+  }
+  uint64_t head = nsm_journal_head(journal);
+  for (uint64_t position = nsm_journal_tail(journal); position < head;
+       position++) {
+    NsmJournalRecord record;
+    if (nsm_journal_read(journal, position, &record)) {
+      print_record(position, record);
+    } else if (!skip_torn) {
+      printf("{\"position\":%" G_GUINT64_FORMAT ",\"torn\":true}\n",
+             (guint64)position);
+    }
+  }
+  munmap((void*)journal, size);
+  return 0;
+}
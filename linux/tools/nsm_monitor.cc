@@ -0,0 +1,273 @@
+#include <glib-unix.h>
+#include <glib.h>
+#include <signal.h>
+#include <stdio.h>
+
+#include <string>
+
+#include "display_detection.h"
+#include "event_outbox.h"
+#include "include/no_screen_mirror/no_screen_mirror_journal.h"
+#include "metrics_export.h"
+#include "probe_trace.h"
+#include "state_export.h"
+#include "state_journal.h"
+
+// Runs the Linux detector without Flutter and prints one JSON line per event:
+//
+// {"time":"2026-01-02T03:04:05.678901Z","monotonic_us":123456789,
+//  "event":{"is_screen_mirrored":false,...,"sequence":1,...}}
+//
+// "event" is what the plugin sends to Dart, stamped as soon as it is
+// detected rather than when the rate limit lets it out. Options mirror
+// startListening() and LinuxScanOptions:
+//
+// $ nsm-monitor --polling-interval-ms=500 --custom-process=my-app
+//       --process-source=appScopes --scan-threads=4 --field=screenShared
+
+namespace {
+
+gint polling_interval_ms = 2000;
+gint connector_interval_ms = 0;
+gint process_interval_ms = 0;
+gchar** custom_processes = nullptr;
+gchar** fields = nullptr;
+gchar* process_source = nullptr;
+gchar* process_scope = nullptr;
+gboolean require_capture_evidence = FALSE;
+gint capture_fd_budget = 256;
+gboolean match_libraries = FALSE;
+gint scan_slice_budget_us = 0;
+gint scan_threads = 1;
+gchar* proc_root = nullptr;
+gchar* drm_root = nullptr;
+gchar* export_shm = nullptr;
+gchar* metrics_socket = nullptr;
+gchar* metrics_textfile = nullptr;
+gchar* journal = nullptr;
+gint journal_capacity = 4096;
+gboolean low_power = FALSE;
+gchar* record_trace = nullptr;
+gint duration_s = 0;
+
+const GOptionEntry kOptions[] = {
+    {"polling-interval-ms", 0, 0, G_OPTION_ARG_INT, &polling_interval_ms,
+     "How often to poll (default 2000)", "MS"},
+    {"connector-interval-ms", 0, 0, G_OPTION_ARG_INT, &connector_interval_ms,
+     "How often to poll display connectors (default: polling interval)",
+     "MS"},
+    {"process-interval-ms", 0, 0, G_OPTION_ARG_INT, &process_interval_ms,
+     "How often to scan for screen sharing apps (default: polling interval)",
+     "MS"},
+    {"custom-process", 0, 0, G_OPTION_ARG_STRING_ARRAY, &custom_processes,
+     "Extra screen-sharing process name; repeatable", "NAME"},
+    {"field", 0, 0, G_OPTION_ARG_STRING_ARRAY, &fields,
+     "Only probe for this MirrorField (e.g. screenShared); repeatable",
+     "FIELD"},
+    {"process-source", 0, 0, G_OPTION_ARG_STRING, &process_source,
+     "processTable (default) or appScopes", "SOURCE"},
+    {"process-scope", 0, 0, G_OPTION_ARG_STRING, &process_scope,
+     "Processes the /proc walk reads: all (default), user or session",
+     "SCOPE"},
+    {"require-capture-evidence", 0, 0, G_OPTION_ARG_NONE,
+     &require_capture_evidence,
+     "Only count processes holding a capture resource open", nullptr},
+    {"capture-fd-budget", 0, 0, G_OPTION_ARG_INT, &capture_fd_budget,
+     "File descriptors inspected per poll (default 256)", "N"},
+    {"match-libraries", 0, 0, G_OPTION_ARG_NONE, &match_libraries,
+     "Also match processes by the capture libraries they load", nullptr},
+    {"scan-slice-budget-us", 0, 0, G_OPTION_ARG_INT, &scan_slice_budget_us,
+     "Max time per main-loop dispatch walking /proc (default 0, unsliced)",
+     "US"},
+    {"scan-threads", 0, 0, G_OPTION_ARG_INT, &scan_threads,
+     "Threads walking /proc in parallel (default 1)", "N"},
+    {"proc-root", 0, 0, G_OPTION_ARG_FILENAME, &proc_root,
+     "Read the process table from PATH instead of /proc", "PATH"},
+    {"drm-root", 0, 0, G_OPTION_ARG_FILENAME, &drm_root,
+     "Read display connectors from PATH instead of /sys/class/drm", "PATH"},
+    {"export-shm", 0, 0, G_OPTION_ARG_STRING, &export_shm,
+     "Also publish the state to shared memory segment NAME (e.g. "
+     "/no_screen_mirror)",
+     "NAME"},
+    {"metrics-socket", 0, 0, G_OPTION_ARG_FILENAME, &metrics_socket,
+     "Serve Prometheus metrics on the unix socket PATH", "PATH"},
+    {"metrics-textfile", 0, 0, G_OPTION_ARG_FILENAME, &metrics_textfile,
+     "Keep Prometheus metrics in the node-exporter textfile PATH", "PATH"},
+    {"journal", 0, 0, G_OPTION_ARG_FILENAME, &journal,
+     "Append every transition to the journal file PATH (see nsm-journal)",
+     "PATH"},
+    {"journal-capacity", 0, 0, G_OPTION_ARG_INT, &journal_capacity,
+     "Transitions the journal keeps (default 4096)", "N"},
+    {"record-trace", 0, 0, G_OPTION_ARG_FILENAME, &record_trace,
+     "Record every connector and process read to PATH (see nsm-replay)",
+     "PATH"},
+    {"low-power", 0, 0, G_OPTION_ARG_NONE, &low_power,
+     "Align polls to the session's whole-second wakeups", nullptr},
+    {"duration-s", 0, 0, G_OPTION_ARG_INT, &duration_s,
+     "Exit after this many seconds (default 0, run until interrupted)", "S"},
+    {nullptr}};
+
+struct Output {
+  no_screen_mirror::EventOutbox outbox;
+  std::string json;
+  StateExport* state_export = nullptr;
+  MetricsExport* metrics_export = nullptr;
+  StateJournal* journal = nullptr;
+};
+
+void print_event(gboolean is_external_connected, gint display_count,
+                 gboolean is_screen_shared, gpointer user_data) {
+  gint64 monotonic_us = g_get_monotonic_time();
+  g_autoptr(GDateTime) now = g_date_time_new_now_utc();
+  g_autofree gchar* wall_time = g_date_time_format_iso8601(now);
+
+  // Linux: is_screen_mirrored is always false (no kernel mirroring concept)
+  no_screen_mirror::DetectionState state;
+  state.is_external_display_connected = is_external_connected;
+  state.display_count = display_count;
+  state.is_screen_shared = is_screen_shared;
+  Output* output = static_cast<Output*>(user_data);
+  no_screen_mirror::DetectionState previous = output->outbox.state();
+  guint cause =
+      output->outbox.sequence() == 0 ? NSM_JOURNAL_CAUSE_FIRST_SCAN : 0;
+  if (!output->outbox.Record(state, monotonic_us)) return;
+  if (state.is_external_display_connected !=
+          previous.is_external_display_connected ||
+      state.display_count != previous.display_count) {
+    cause |= NSM_JOURNAL_CAUSE_DISPLAYS;
+  }
+  if (state.is_screen_shared != previous.is_screen_shared) {
+    cause |= NSM_JOURNAL_CAUSE_SHARING;
+  }
+  state_journal_append(output->journal, FALSE, is_external_connected,
+                       display_count, is_screen_shared,
+                       output->outbox.sequence(), monotonic_us, cause);
+  state_export_publish(output->state_export, FALSE, is_external_connected,
+                       display_count, is_screen_shared,
+                       output->outbox.sequence(), monotonic_us);
+  metrics_export_set_state(output->metrics_export, FALSE,
+                           is_external_connected, display_count,
+                           is_screen_shared);
+  output->outbox.TakePending(g_get_monotonic_time(), &output->json);
+  metrics_export_record_event(output->metrics_export, 0);
+
+  printf("{\"time\":\"%s\",\"monotonic_us\":%" G_GINT64_FORMAT
+         ",\"event\":%s}\n",
+         wall_time, monotonic_us, output->json.c_str());
+  // Keep lines flowing when piped into another tool.
+  fflush(stdout);
+}
+
+gboolean quit_loop(gpointer user_data) {
+  g_main_loop_quit(static_cast<GMainLoop*>(user_data));
+  return G_SOURCE_REMOVE;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  g_autoptr(GOptionContext) context =
+      g_option_context_new("- print display detection events as JSON lines");
+  g_option_context_add_main_entries(context, kOptions, nullptr);
+  g_autoptr(GError) error = nullptr;
+  if (!g_option_context_parse(context, &argc, &argv, &error)) {
+    fprintf(stderr, "nsm-monitor: %s\n", error->message);
+    return 2;
+  }
+
+  Output output;
+  if (export_shm != nullptr) {
+    output.state_export = state_export_new(export_shm);
+    if (output.state_export == nullptr) {
+      fprintf(stderr, "nsm-monitor: cannot create shared memory segment %s\n",
+              export_shm);
+      return 1;
+    }
+  }
+  if (metrics_socket != nullptr || metrics_textfile != nullptr) {
+    output.metrics_export = metrics_export_new(metrics_socket, metrics_textfile);
+    if (output.metrics_export == nullptr) {
+      fprintf(stderr, "nsm-monitor: cannot serve metrics\n");
+      return 1;
+    }
+  }
+  if (journal != nullptr) {
+    output.journal = state_journal_new(
+        journal, journal_capacity > 0 ? (guint)journal_capacity : 4096);
+    if (output.journal == nullptr) {
+      fprintf(stderr, "nsm-monitor: cannot open journal %s\n", journal);
+      return 1;
+    }
+  }
+  ProbeTraceWriter* trace = nullptr;
+  if (record_trace != nullptr) {
+    trace = probe_trace_writer_new(record_trace);
+    if (trace == nullptr) {
+      fprintf(stderr, "nsm-monitor: cannot write trace %s\n", record_trace);
+      return 1;
+    }
+  }
+  DisplayDetection* detection = display_detection_new(print_event, &output);
+  display_detection_set_metrics(detection, output.metrics_export);
+  display_detection_set_probe_trace(detection, trace);
+
+  // Same mapping as the plugin's apply_linux_scan_options().
+  display_detection_set_process_source(
+      detection, g_strcmp0(process_source, "appScopes") == 0
+                     ? DISPLAY_DETECTION_PROCESS_SOURCE_APP_SCOPES
+                     : DISPLAY_DETECTION_PROCESS_SOURCE_PROC);
+  display_detection_set_process_scope(
+      detection, display_detection_process_scope_from_name(process_scope));
+  display_detection_set_capture_fd_budget(
+      detection,
+      require_capture_evidence
+          ? (capture_fd_budget > 0 ? (guint)capture_fd_budget : 256)
+          : 0);
+  display_detection_set_library_signatures(detection, match_libraries);
+  display_detection_set_low_power(detection, low_power);
+  display_detection_set_scan_slice_budget(
+      detection, scan_slice_budget_us > 0 ? (guint)scan_slice_budget_us : 0);
+  display_detection_set_scan_threads(
+      detection, scan_threads > 1 ? (guint)scan_threads : 1);
+  display_detection_set_probe_intervals(
+      detection, connector_interval_ms > 0 ? (guint)connector_interval_ms : 0,
+      process_interval_ms > 0 ? (guint)process_interval_ms : 0);
+  if (proc_root != nullptr) display_detection_set_proc_root(detection, proc_root);
+  if (drm_root != nullptr) display_detection_set_drm_root(detection, drm_root);
+  if (fields != nullptr) {
+    guint mask = 0;
+    for (gchar** field = fields; *field != nullptr; field++) {
+      mask |= display_detection_field_from_name(*field);
+    }
+    display_detection_set_fields(detection, mask);
+  }
+
+  GMainLoop* loop = g_main_loop_new(nullptr, FALSE);
+  g_unix_signal_add(SIGINT, quit_loop, loop);
+  g_unix_signal_add(SIGTERM, quit_loop, loop);
+  if (duration_s > 0) g_timeout_add_seconds(duration_s, quit_loop, loop);
+
+  display_detection_start(
+      detection, polling_interval_ms > 0 ? (guint)polling_interval_ms : 2000,
+      custom_processes);
+  g_main_loop_run(loop);
+
+  display_detection_free(detection);
+  state_export_free(output.state_export);
+  metrics_export_free(output.metrics_export);
+  state_journal_free(output.journal);
+  probe_trace_writer_free(trace);
+  g_main_loop_unref(loop);
+  g_strfreev(custom_processes);
+  g_strfreev(fields);
+  g_free(process_source);
+  g_free(process_scope);
+  g_free(proc_root);
+  g_free(drm_root);
+  g_free(export_shm);
+  g_free(metrics_socket);
+  g_free(metrics_textfile);
+  g_free(journal);
+  g_free(record_trace);
+  return 0;
+}
@@ -62,6 +62,11 @@ public class MacOSNoScreenMirrorPlugin: NSObject, FlutterPlugin, FlutterStreamHa
             }
             startDetection()
             result("Listening started")
+        case "updateConfig":
+            if isListening, let args = call.arguments as? [String: Any] {
+                updateConfig(args)
+            }
+            result("Config updated")
         case "stopListening":
             stopDetection()
             result("Listening stopped")
@@ -89,6 +94,24 @@ public class MacOSNoScreenMirrorPlugin: NSObject, FlutterPlugin, FlutterStreamHa
         }
     }
 
+    // Applies updateConfig's arguments while listening; absent ones keep
+    // their current value.
+    private func updateConfig(_ args: [String: Any]) {
+        if let processes = args["customProcesses"] as? [String],
+           Set(processes) != customScreenSharingBundleIDs {
+            customScreenSharingBundleIDs = Set(processes)
+            updateState()
+        }
+        if let intervalMs = args["pollingIntervalMs"] as? Int, intervalMs > 0,
+           Double(intervalMs) / 1000.0 != pollingIntervalSec {
+            pollingIntervalSec = Double(intervalMs) / 1000.0
+            screenSharingTimer?.invalidate()
+            screenSharingTimer = Timer.scheduledTimer(withTimeInterval: pollingIntervalSec, repeats: true) { [weak self] _ in
+                self?.updateState()
+            }
+        }
+    }
+
     private func stopDetection() {
         guard isListening else { return }
         isListening = false
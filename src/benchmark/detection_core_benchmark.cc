@@ -0,0 +1,118 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "detection_state.h"
+#include "event_json.h"
+#include "event_outbox.h"
+#include "process_matcher.h"
+
+// Times the hot paths run on every poll: matching each process name, diffing
+// the state, and stamping and encoding an event.
+//
+// $ no_screen_mirror_core_benchmark [iterations]
+
+namespace {
+
+using no_screen_mirror::DetectionState;
+using no_screen_mirror::EncodeEventJson;
+using no_screen_mirror::EventOutbox;
+using no_screen_mirror::MonotonicNowUs;
+using no_screen_mirror::ProcessMatcher;
+using no_screen_mirror::StateTracker;
+using Clock = std::chrono::steady_clock;
+
+// Keeps the optimizer from discarding benchmarked work.
+volatile size_t g_sink = 0;
+
+template <typename Func>
+void Run(const char* label, size_t iterations, Func func) {
+  auto start = Clock::now();
+  for (size_t i = 0; i < iterations; i++) func(i);
+  double elapsed_ns =
+      std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+  std::printf("%-34s %12zu %10.1f\n", label, iterations,
+              elapsed_ns / iterations);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+  if (iterations == 0) iterations = 1;
+
+  const std::vector<std::string> defaults = {
+      "zoom",    "teams", "teams-for-linux", "slack",
+      "discord", "obs",   "ffmpeg",          "simplescreenrecorder",
+      "kazam",   "peek",  "recordmydesktop", "vokoscreen"};
+  std::vector<std::string> custom;
+  for (int i = 0; i < 32; i++) {
+    custom.push_back("custom-app-" + std::to_string(i));
+  }
+
+  // A process table where nothing matches, as on most polls.
+  std::vector<std::string> table;
+  for (int i = 0; i < 1024; i++) table.push_back("worker-" + std::to_string(i));
+
+  std::printf("%-34s %12s %10s\n", "benchmark", "iterations", "ns/op");
+
+  ProcessMatcher sensitive(defaults,
+                           ProcessMatcher::CaseSensitivity::kSensitive);
+  sensitive.SetCustomNames(custom);
+  Run("ProcessMatcher::Matches", iterations, [&](size_t i) {
+    g_sink += sensitive.Matches(table[i % table.size()]);
+  });
+
+  ProcessMatcher insensitive(defaults,
+                             ProcessMatcher::CaseSensitivity::kInsensitive);
+  insensitive.SetCustomNames(custom);
+  Run("ProcessMatcher::Matches (folded)", iterations, [&](size_t i) {
+    g_sink += insensitive.Matches(table[i % table.size()]);
+  });
+
+  // What the plugins did before: compare against every configured name.
+  Run("linear scan over names", iterations, [&](size_t i) {
+    const std::string& name = table[i % table.size()];
+    bool found = false;
+    for (const auto& candidate : defaults) found |= candidate == name;
+    for (const auto& candidate : custom) found |= candidate == name;
+    g_sink += found;
+  });
+
+  StateTracker tracker;
+  Run("StateTracker::Update", iterations, [&](size_t i) {
+    DetectionState state;
+    state.display_count = 1 + static_cast<int>(i % 2);
+    g_sink += tracker.Update(state);
+  });
+
+  std::string json;
+  Run("EncodeEventJson (reused buffer)", iterations, [&](size_t i) {
+    DetectionState state;
+    state.display_count = static_cast<int>(i % 8);
+    EncodeEventJson(state, &json);
+    g_sink += json.size();
+  });
+
+  // Record, stamp and encode, as each delivered event does.
+  EventOutbox outbox;
+  Run("EventOutbox record + take", iterations, [&](size_t i) {
+    DetectionState state;
+    state.display_count = 1 + static_cast<int>(i % 2);
+    outbox.Record(state, MonotonicNowUs());
+    g_sink += outbox.TakePending(MonotonicNowUs(), &json);
+  });
+
+  Run("snprintf", iterations, [&](size_t i) {
+    char buffer[160];
+    g_sink += std::snprintf(
+        buffer, sizeof(buffer),
+        "{\"is_screen_mirrored\":%s,\"is_external_display_connected\":%s,"
+        "\"display_count\":%d,\"is_screen_shared\":%s}",
+        "false", "false", static_cast<int>(i % 8), "false");
+  });
+
+  return 0;
+}
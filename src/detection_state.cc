@@ -0,0 +1,11 @@
+#include "detection_state.h"
+
+namespace no_screen_mirror {
+
+bool StateTracker::Update(const DetectionState& state) {
+  if (state == last_) return false;
+  last_ = state;
+  return true;
+}
+
+}  // namespace no_screen_mirror
@@ -0,0 +1,68 @@
+#ifndef NO_SCREEN_MIRROR_DETECTION_STATE_H_
+#define NO_SCREEN_MIRROR_DETECTION_STATE_H_
+
+#include <cstdint>
+
+namespace no_screen_mirror {
+
+// The display and sharing state reported to Dart as a MirrorSnapshot.
+struct DetectionState {
+  bool is_screen_mirrored = false;
+  bool is_external_display_connected = false;
+  int display_count = 1;
+  bool is_screen_shared = false;
+
+  bool operator==(const DetectionState& other) const {
+    return is_screen_mirrored == other.is_screen_mirrored &&
+           is_external_display_connected ==
+               other.is_external_display_connected &&
+           display_count == other.display_count &&
+           is_screen_shared == other.is_screen_shared;
+  }
+  bool operator!=(const DetectionState& other) const {
+    return !(*this == other);
+  }
+};
+
+// Delivery metadata sent with every event so Dart can measure how stale it
+// is. Times are microseconds on the monotonic clock, the same one Dart's
+// Timeline.now reads (CLOCK_MONOTONIC on Linux, QueryPerformanceCounter on
+// Windows).
+struct EventStamp {
+  // 1 for the first state a plugin instance reports, then one more per
+  // change. A gap means states were replaced before they could be delivered.
+  uint64_t sequence = 0;
+  // When the detector reported the state.
+  int64_t detected_at_us = 0;
+  // When the event was handed to the event sink.
+  int64_t enqueued_at_us = 0;
+  // Changes recorded since the previous event that this one replaced, e.g.
+  // while deliveries were rate limited.
+  uint64_t coalesced = 0;
+  // The state was restored from an earlier run rather than detected, and is
+  // reconciled by the next scan.
+  bool provisional = false;
+};
+
+// Remembers the last reported state so callers only report changes.
+class StateTracker {
+ public:
+  explicit StateTracker(const DetectionState& initial = DetectionState())
+      : last_(initial) {}
+
+  // Records |state| and returns true if it differs from the last one.
+  bool Update(const DetectionState& state);
+
+  // Records |state| unconditionally, e.g. after an initial scan that is
+  // always reported.
+  void Reset(const DetectionState& state) { last_ = state; }
+
+  const DetectionState& last() const { return last_; }
+
+ private:
+  DetectionState last_;
+};
+
+}  // namespace no_screen_mirror
+
+#endif  // NO_SCREEN_MIRROR_DETECTION_STATE_H_
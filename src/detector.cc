@@ -0,0 +1,31 @@
+#include "detector.h"
+
+namespace no_screen_mirror {
+
+Detector::Detector(DisplayProbe* display_probe, ProcessProbe* process_probe,
+                   const ProcessMatcher* matcher)
+    : display_probe_(display_probe),
+      process_probe_(process_probe),
+      matcher_(matcher) {}
+
+DetectionState Detector::Scan() {
+  DisplayInfo display = display_probe_->Scan();
+
+  DetectionState state;
+  state.is_screen_mirrored = display.is_screen_mirrored;
+  state.is_external_display_connected = display.is_external_display_connected;
+  // Ensure at least 1 display
+  state.display_count = display.display_count > 0 ? display.display_count : 1;
+  state.is_screen_shared = process_probe_->ForEachProcess(
+      [this](std::string_view name) { return matcher_->Matches(name); });
+  return state;
+}
+
+bool Detector::Poll() { return tracker_.Update(Scan()); }
+
+const DetectionState& Detector::Reset() {
+  tracker_.Reset(Scan());
+  return tracker_.last();
+}
+
+}  // namespace no_screen_mirror
@@ -0,0 +1,70 @@
+#ifndef NO_SCREEN_MIRROR_DETECTOR_H_
+#define NO_SCREEN_MIRROR_DETECTOR_H_
+
+#include <functional>
+#include <string_view>
+
+#include "detection_state.h"
+#include "process_matcher.h"
+
+namespace no_screen_mirror {
+
+// What a display probe reports; is_screen_shared comes from the process
+// probe.
+struct DisplayInfo {
+  bool is_screen_mirrored = false;
+  bool is_external_display_connected = false;
+  int display_count = 1;
+};
+
+// OS-specific source of connected displays.
+class DisplayProbe {
+ public:
+  virtual ~DisplayProbe() = default;
+  virtual DisplayInfo Scan() = 0;
+};
+
+// OS-specific source of running process names.
+class ProcessProbe {
+ public:
+  // Returns true to stop the walk.
+  using Visitor = std::function<bool(std::string_view name)>;
+
+  virtual ~ProcessProbe() = default;
+
+  // Calls |visit| with each running process name until it returns true.
+  // Returns true if it did.
+  virtual bool ForEachProcess(const Visitor& visit) = 0;
+};
+
+// Runs the probes and reports changes of the combined state. Probes and the
+// matcher are borrowed and must outlive the detector.
+class Detector {
+ public:
+  Detector(DisplayProbe* display_probe, ProcessProbe* process_probe,
+           const ProcessMatcher* matcher);
+
+  Detector(const Detector&) = delete;
+  Detector& operator=(const Detector&) = delete;
+
+  // Runs both probes and returns the resulting state without recording it.
+  DetectionState Scan();
+
+  // Runs both probes, records the result and returns true if it changed.
+  bool Poll();
+
+  // Runs both probes and records the result as the baseline for Poll().
+  const DetectionState& Reset();
+
+  const DetectionState& state() const { return tracker_.last(); }
+
+ private:
+  DisplayProbe* display_probe_;
+  ProcessProbe* process_probe_;
+  const ProcessMatcher* matcher_;
+  StateTracker tracker_;
+};
+
+}  // namespace no_screen_mirror
+
+#endif  // NO_SCREEN_MIRROR_DETECTOR_H_
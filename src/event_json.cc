@@ -0,0 +1,58 @@
+#include "event_json.h"
+
+#include <charconv>
+
+namespace no_screen_mirror {
+
+namespace {
+
+void AppendBool(bool value, std::string* out) {
+  out->append(value ? "true" : "false");
+}
+
+void AppendInt(long long value, std::string* out) {
+  char buffer[24];
+  auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  out->append(buffer, result.ptr);
+}
+
+}  // namespace
+
+std::string EncodeEventJson(const DetectionState& state) {
+  std::string json;
+  EncodeEventJson(state, &json);
+  return json;
+}
+
+void EncodeEventJson(const DetectionState& state, std::string* out) {
+  out->clear();
+  out->append("{\"is_screen_mirrored\":");
+  AppendBool(state.is_screen_mirrored, out);
+  out->append(",\"is_external_display_connected\":");
+  AppendBool(state.is_external_display_connected, out);
+  out->append(",\"display_count\":");
+  AppendInt(state.display_count, out);
+  out->append(",\"is_screen_shared\":");
+  AppendBool(state.is_screen_shared, out);
+  out->push_back('}');
+}
+
+void EncodeEventJson(const DetectionState& state, const EventStamp& stamp,
+                     std::string* out) {
+  EncodeEventJson(state, out);
+  out->pop_back();
+  if (stamp.coalesced > 0) {
+    out->append(",\"coalesced\":");
+    AppendInt(static_cast<long long>(stamp.coalesced), out);
+  }
+  out->append(",\"sequence\":");
+  AppendInt(static_cast<long long>(stamp.sequence), out);
+  out->append(",\"detected_at_us\":");
+  AppendInt(stamp.detected_at_us, out);
+  out->append(",\"enqueued_at_us\":");
+  AppendInt(stamp.enqueued_at_us, out);
+  if (stamp.provisional) out->append(",\"provisional\":true");
+  out->push_back('}');
+}
+
+}  // namespace no_screen_mirror
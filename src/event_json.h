@@ -0,0 +1,28 @@
+#ifndef NO_SCREEN_MIRROR_EVENT_JSON_H_
+#define NO_SCREEN_MIRROR_EVENT_JSON_H_
+
+#include <string>
+
+#include "detection_state.h"
+
+namespace no_screen_mirror {
+
+// Encodes |state| as the JSON event decoded by MirrorSnapshot.fromMap:
+// {"is_screen_mirrored":false,"is_external_display_connected":true,
+//  "display_count":2,"is_screen_shared":false}
+std::string EncodeEventJson(const DetectionState& state);
+
+// Same as EncodeEventJson(), replacing the contents of |out| so its buffer is
+// reused across events.
+void EncodeEventJson(const DetectionState& state, std::string* out);
+
+// Same as EncodeEventJson(state, out), followed by the delivery metadata:
+// ...,"is_screen_shared":false,"sequence":7,"detected_at_us":1234,
+//  "enqueued_at_us":1240}
+// with ,"provisional":true before the closing brace for provisional states.
+void EncodeEventJson(const DetectionState& state, const EventStamp& stamp,
+                     std::string* out);
+
+}  // namespace no_screen_mirror
+
+#endif  // NO_SCREEN_MIRROR_EVENT_JSON_H_
@@ -0,0 +1,61 @@
+#include "event_outbox.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "event_json.h"
+
+namespace no_screen_mirror {
+
+int64_t MonotonicNowUs() {
+  // steady_clock is CLOCK_MONOTONIC on Linux and QueryPerformanceCounter on
+  // Windows, matching the Dart VM's monotonic clock on both.
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+bool EventOutbox::Record(const DetectionState& state, int64_t detected_at_us) {
+  if (sequence_ > 0 && !provisional_ && !tracker_.Update(state)) return false;
+  // A provisional state was never a detected change.
+  if (has_pending_ && !provisional_) coalesced_++;
+  tracker_.Reset(state);
+  sequence_++;
+  detected_at_us_ = detected_at_us;
+  has_pending_ = true;
+  provisional_ = false;
+  return true;
+}
+
+void EventOutbox::RecordProvisional(const DetectionState& state,
+                                    int64_t detected_at_us) {
+  Record(state, detected_at_us);
+  provisional_ = true;
+}
+
+void EventOutbox::set_max_events_per_second(int max_per_second) {
+  min_interval_us_ = max_per_second > 0 ? 1000000 / max_per_second : 0;
+}
+
+int64_t EventOutbox::NextTakeUs(int64_t now_us) const {
+  if (!has_taken_) return now_us;
+  return std::max(now_us, last_taken_us_ + min_interval_us_);
+}
+
+bool EventOutbox::TakePending(int64_t enqueued_at_us, std::string* json) {
+  if (!has_pending_) return false;
+  EventStamp stamp;
+  stamp.sequence = sequence_;
+  stamp.detected_at_us = detected_at_us_;
+  stamp.enqueued_at_us = enqueued_at_us;
+  stamp.provisional = provisional_;
+  stamp.coalesced = coalesced_;
+  EncodeEventJson(tracker_.last(), stamp, json);
+  has_pending_ = false;
+  coalesced_ = 0;
+  has_taken_ = true;
+  last_taken_us_ = enqueued_at_us;
+  return true;
+}
+
+}  // namespace no_screen_mirror
@@ -0,0 +1,75 @@
+#ifndef NO_SCREEN_MIRROR_EVENT_OUTBOX_H_
+#define NO_SCREEN_MIRROR_EVENT_OUTBOX_H_
+
+#include <cstdint>
+#include <string>
+
+#include "detection_state.h"
+
+namespace no_screen_mirror {
+
+// Microseconds on the clock used by EventStamp.
+int64_t MonotonicNowUs();
+
+// Holds the state waiting to be sent to Dart. Only a state that differs from
+// the previous one becomes pending; if several arrive before it is taken the
+// latest wins, keeps its own detection time and counts the ones it replaced.
+//
+// Deliveries can be rate limited: the first change after a quiet period may
+// be taken right away (leading edge), later ones wait for the end of the
+// interval and coalesce into one event.
+class EventOutbox {
+ public:
+  EventOutbox() = default;
+
+  EventOutbox(const EventOutbox&) = delete;
+  EventOutbox& operator=(const EventOutbox&) = delete;
+
+  // Records |state|, detected at |detected_at_us|. The first state is always
+  // recorded, and so is the first one after a provisional state, even if
+  // unchanged, to confirm it. Returns true if it became the pending event.
+  bool Record(const DetectionState& state, int64_t detected_at_us);
+
+  // Records |state| as a stand-in until the first detected state, e.g. one
+  // restored from an earlier run. Always becomes the pending event.
+  void RecordProvisional(const DetectionState& state, int64_t detected_at_us);
+
+  bool has_pending() const { return has_pending_; }
+
+  // Changes the pending event has replaced so far.
+  uint64_t coalesced() const { return coalesced_; }
+
+  // Spaces taken events at least 1 / |max_per_second| seconds apart; 0 (the
+  // default) removes the limit.
+  void set_max_events_per_second(int max_per_second);
+
+  // The earliest time, no sooner than |now_us|, at which the pending event
+  // may be taken without exceeding the rate limit.
+  int64_t NextTakeUs(int64_t now_us) const;
+
+  // Encodes the pending event stamped with |enqueued_at_us| into |json| and
+  // clears it. Returns false, leaving |json| untouched, if nothing is pending.
+  bool TakePending(int64_t enqueued_at_us, std::string* json);
+
+  // The last recorded state, its sequence number (0 before the first) and
+  // when it was detected, whether or not it was taken yet.
+  const DetectionState& state() const { return tracker_.last(); }
+  uint64_t sequence() const { return sequence_; }
+  int64_t detected_at_us() const { return detected_at_us_; }
+  bool provisional() const { return provisional_; }
+
+ private:
+  StateTracker tracker_;
+  uint64_t sequence_ = 0;
+  int64_t detected_at_us_ = 0;
+  bool has_pending_ = false;
+  bool provisional_ = false;
+  uint64_t coalesced_ = 0;
+  int64_t min_interval_us_ = 0;
+  bool has_taken_ = false;
+  int64_t last_taken_us_ = 0;
+};
+
+}  // namespace no_screen_mirror
+
+#endif  // NO_SCREEN_MIRROR_EVENT_OUTBOX_H_
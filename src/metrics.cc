@@ -0,0 +1,192 @@
+#include "metrics.h"
+
+#include <charconv>
+
+namespace no_screen_mirror {
+
+namespace {
+
+// Upper bounds of the finite scan duration buckets. A connector scan takes
+// tens of microseconds; a /proc walk on a busy desktop a few milliseconds.
+constexpr int64_t kBucketBoundsUs[] = {50,   100,  250,   500,   1000,
+                                       2500, 5000, 10000, 25000, 100000};
+
+const char* const kProbeLabels[] = {"connectors", "processes"};
+
+void AppendInt(uint64_t value, std::string* out) {
+  char buffer[24];
+  auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  out->append(buffer, result.ptr);
+}
+
+// Microseconds as decimal seconds without trailing zeros, independent of the
+// C locale's decimal separator.
+void AppendSeconds(uint64_t us, std::string* out) {
+  AppendInt(us / 1000000, out);
+  uint64_t fraction = us % 1000000;
+  if (fraction == 0) return;
+  char digits[7];
+  for (int i = 5; i >= 0; i--) {
+    digits[i] = static_cast<char>('0' + fraction % 10);
+    fraction /= 10;
+  }
+  int length = 6;
+  while (digits[length - 1] == '0') length--;
+  out->push_back('.');
+  out->append(digits, length);
+}
+
+void AppendHeader(const char* name, const char* type, const char* help,
+                  std::string* out) {
+  out->append("# HELP ").append(name).append(" ").append(help).append("\n");
+  out->append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+void AppendSample(const char* name, uint64_t value, std::string* out) {
+  out->append(name).push_back(' ');
+  AppendInt(value, out);
+  out->push_back('\n');
+}
+
+}  // namespace
+
+void Metrics::RecordScan(Probe probe, int64_t duration_us) {
+  static_assert(
+      sizeof(kBucketBoundsUs) / sizeof(kBucketBoundsUs[0]) + 1 == kBucketCount,
+      "kBucketCount counts the finite bounds plus +Inf");
+  if (duration_us < 0) duration_us = 0;
+  Histogram& histogram = scans_[static_cast<int>(probe)];
+  int bucket = 0;
+  while (bucket < kBucketCount - 1 && duration_us > kBucketBoundsUs[bucket]) {
+    bucket++;
+  }
+  histogram.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  histogram.sum_us.fetch_add(static_cast<uint64_t>(duration_us),
+                             std::memory_order_relaxed);
+}
+
+void Metrics::RecordProbeError(Probe probe) {
+  probe_errors_[static_cast<int>(probe)].fetch_add(1,
+                                                   std::memory_order_relaxed);
+}
+
+void Metrics::RecordEvent(uint64_t coalesced) {
+  events_.fetch_add(1, std::memory_order_relaxed);
+  coalesced_.fetch_add(coalesced, std::memory_order_relaxed);
+}
+
+void Metrics::SetState(const DetectionState& state) {
+  is_screen_mirrored_.store(state.is_screen_mirrored,
+                            std::memory_order_relaxed);
+  is_external_display_connected_.store(state.is_external_display_connected,
+                                       std::memory_order_relaxed);
+  display_count_.store(state.display_count, std::memory_order_relaxed);
+  is_screen_shared_.store(state.is_screen_shared, std::memory_order_relaxed);
+}
+
+void Metrics::SetProcessCount(uint64_t count) {
+  process_count_.store(count, std::memory_order_relaxed);
+}
+
+void Metrics::RecordWakeup(int64_t now_us) {
+  if (wakeups_.load(std::memory_order_relaxed) == 0) {
+    first_wakeup_us_.store(now_us, std::memory_order_relaxed);
+  }
+  last_wakeup_us_.store(now_us, std::memory_order_relaxed);
+  wakeups_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::Render(std::string* out) const {
+  out->clear();
+
+  const char* scan_name = "no_screen_mirror_scan_duration_seconds";
+  AppendHeader(scan_name, "histogram", "Time taken by one probe run.", out);
+  for (int probe = 0; probe < kProbeCount; probe++) {
+    const Histogram& histogram = scans_[probe];
+    std::string labels = std::string("probe=\"") + kProbeLabels[probe] + "\"";
+    // _count is the +Inf bucket, so the two always agree.
+    uint64_t cumulative = 0;
+    for (int bucket = 0; bucket < kBucketCount; bucket++) {
+      cumulative += histogram.buckets[bucket].load(std::memory_order_relaxed);
+      out->append(scan_name).append("_bucket{").append(labels);
+      out->append(",le=\"");
+      if (bucket < kBucketCount - 1) {
+        AppendSeconds(kBucketBoundsUs[bucket], out);
+      } else {
+        out->append("+Inf");
+      }
+      out->append("\"} ");
+      AppendInt(cumulative, out);
+      out->push_back('\n');
+    }
+    out->append(scan_name).append("_sum{").append(labels).append("} ");
+    AppendSeconds(histogram.sum_us.load(std::memory_order_relaxed), out);
+    out->push_back('\n');
+    out->append(scan_name).append("_count{").append(labels).append("} ");
+    AppendInt(cumulative, out);
+    out->push_back('\n');
+  }
+
+  const char* errors_name = "no_screen_mirror_probe_errors_total";
+  AppendHeader(errors_name, "counter",
+               "Probe runs that could not read their source.", out);
+  for (int probe = 0; probe < kProbeCount; probe++) {
+    out->append(errors_name).append("{probe=\"").append(kProbeLabels[probe]);
+    out->append("\"} ");
+    AppendInt(probe_errors_[probe].load(std::memory_order_relaxed), out);
+    out->push_back('\n');
+  }
+
+  AppendHeader("no_screen_mirror_events_total", "counter",
+               "Events delivered to Dart.", out);
+  AppendSample("no_screen_mirror_events_total",
+               events_.load(std::memory_order_relaxed), out);
+  AppendHeader("no_screen_mirror_events_coalesced_total", "counter",
+               "State changes replaced by a later one before delivery.", out);
+  AppendSample("no_screen_mirror_events_coalesced_total",
+               coalesced_.load(std::memory_order_relaxed), out);
+
+  AppendHeader("no_screen_mirror_screen_mirrored", "gauge",
+               "1 while the screen is mirrored.", out);
+  AppendSample("no_screen_mirror_screen_mirrored",
+               is_screen_mirrored_.load(std::memory_order_relaxed), out);
+  AppendHeader("no_screen_mirror_external_display_connected", "gauge",
+               "1 while an external display is connected.", out);
+  AppendSample(
+      "no_screen_mirror_external_display_connected",
+      is_external_display_connected_.load(std::memory_order_relaxed), out);
+  AppendHeader("no_screen_mirror_display_count", "gauge",
+               "Connected displays.", out);
+  AppendSample("no_screen_mirror_display_count",
+               static_cast<uint64_t>(
+                   display_count_.load(std::memory_order_relaxed)),
+               out);
+  AppendHeader("no_screen_mirror_screen_shared", "gauge",
+               "1 while a screen sharing app is detected.", out);
+  AppendSample("no_screen_mirror_screen_shared",
+               is_screen_shared_.load(std::memory_order_relaxed), out);
+
+  AppendHeader("no_screen_mirror_process_table_size", "gauge",
+               "Processes examined by the last process table walk.", out);
+  AppendSample("no_screen_mirror_process_table_size",
+               process_count_.load(std::memory_order_relaxed), out);
+
+  uint64_t wakeups = wakeups_.load(std::memory_order_relaxed);
+  AppendHeader("no_screen_mirror_wakeups_total", "counter",
+               "Timer and descriptor wakeups of the main loop.", out);
+  AppendSample("no_screen_mirror_wakeups_total", wakeups, out);
+  // Intervals between wakeups over the time they span, so the first one
+  // does not count against an arbitrary start.
+  int64_t span_us = last_wakeup_us_.load(std::memory_order_relaxed) -
+                    first_wakeup_us_.load(std::memory_order_relaxed);
+  uint64_t per_hour = 0;
+  if (wakeups > 1 && span_us > 0) {
+    per_hour = static_cast<uint64_t>(
+        static_cast<double>(wakeups - 1) * 3600e6 / span_us + 0.5);
+  }
+  AppendHeader("no_screen_mirror_wakeups_per_hour", "gauge",
+               "Average wakeups per hour since the first one.", out);
+  AppendSample("no_screen_mirror_wakeups_per_hour", per_hour, out);
+}
+
+}  // namespace no_screen_mirror
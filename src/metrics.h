@@ -0,0 +1,85 @@
+#ifndef NO_SCREEN_MIRROR_METRICS_H_
+#define NO_SCREEN_MIRROR_METRICS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "detection_state.h"
+
+namespace no_screen_mirror {
+
+// Counters and gauges describing the detector, rendered in the Prometheus
+// text exposition format (version 0.0.4).
+//
+// Every update is a single relaxed atomic operation, so the detector records
+// on its own thread while another thread renders without taking a lock. A
+// render can observe part of a concurrent scan (its bucket but not yet its
+// duration in the sum); scrapers tolerate that skew.
+class Metrics {
+ public:
+  enum class Probe {
+    // DRM connector status files.
+    kConnectors,
+    // The process table or app scopes.
+    kProcesses,
+  };
+
+  Metrics() = default;
+
+  Metrics(const Metrics&) = delete;
+  Metrics& operator=(const Metrics&) = delete;
+
+  // Adds one completed probe run that took |duration_us| to the
+  // no_screen_mirror_scan_duration_seconds histogram.
+  void RecordScan(Probe probe, int64_t duration_us);
+
+  // Counts a probe run that could not read its source, e.g. a missing
+  // /sys/class/drm.
+  void RecordProbeError(Probe probe);
+
+  // Counts an event handed to Dart and the changes it replaced.
+  void RecordEvent(uint64_t coalesced);
+
+  // The last committed state.
+  void SetState(const DetectionState& state);
+
+  // Processes examined by the last /proc walk.
+  void SetProcessCount(uint64_t count);
+
+  // Counts a timer or descriptor wakeup of the detector at |now_us|, for
+  // no_screen_mirror_wakeups_total and the average rate since the first one
+  // in no_screen_mirror_wakeups_per_hour. Only called from one thread.
+  void RecordWakeup(int64_t now_us);
+
+  // Replaces |out| with the exposition of every metric.
+  void Render(std::string* out) const;
+
+ private:
+  static constexpr int kProbeCount = 2;
+  // Finite bucket bounds plus +Inf.
+  static constexpr int kBucketCount = 11;
+
+  struct Histogram {
+    // Per-bucket (not cumulative) counts; Render() accumulates them.
+    std::atomic<uint64_t> buckets[kBucketCount] = {};
+    std::atomic<uint64_t> sum_us{0};
+  };
+
+  Histogram scans_[kProbeCount];
+  std::atomic<uint64_t> probe_errors_[kProbeCount] = {};
+  std::atomic<uint64_t> events_{0};
+  std::atomic<uint64_t> coalesced_{0};
+  std::atomic<bool> is_screen_mirrored_{false};
+  std::atomic<bool> is_external_display_connected_{false};
+  std::atomic<int> display_count_{1};
+  std::atomic<bool> is_screen_shared_{false};
+  std::atomic<uint64_t> process_count_{0};
+  std::atomic<uint64_t> wakeups_{0};
+  std::atomic<int64_t> first_wakeup_us_{0};
+  std::atomic<int64_t> last_wakeup_us_{0};
+};
+
+}  // namespace no_screen_mirror
+
+#endif  // NO_SCREEN_MIRROR_METRICS_H_
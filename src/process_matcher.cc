@@ -0,0 +1,71 @@
+#include "process_matcher.h"
+
+#include <algorithm>
+
+namespace no_screen_mirror {
+
+namespace {
+
+// Long enough for any Windows executable name (MAX_PATH) in UTF-8.
+constexpr size_t kMaxFoldedLength = 1024;
+
+char FoldAscii(char c) {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+}  // namespace
+
+ProcessMatcher::ProcessMatcher(const std::vector<std::string>& default_names,
+                               CaseSensitivity case_sensitivity)
+    : case_sensitivity_(case_sensitivity), default_names_(default_names) {
+  Rebuild();
+}
+
+bool ProcessMatcher::SetCustomNames(
+    const std::vector<std::string>& custom_names) {
+  // Moving the vector keeps its strings in place, so the old views stay
+  // valid for the comparison.
+  std::vector<std::string> old_storage = std::move(storage_);
+  std::unordered_set<std::string_view> old_names = std::move(names_);
+  custom_names_ = custom_names;
+  Rebuild();
+  return names_ != old_names;
+}
+
+void ProcessMatcher::Rebuild() {
+  names_.clear();
+  storage_.clear();
+  storage_.reserve(default_names_.size() + custom_names_.size());
+  max_length_ = 0;
+
+  for (const auto* list : {&default_names_, &custom_names_}) {
+    for (const auto& name : *list) {
+      if (name.empty() || name.size() > kMaxFoldedLength) continue;
+      std::string stored = name;
+      if (case_sensitivity_ == CaseSensitivity::kInsensitive) {
+        std::transform(stored.begin(), stored.end(), stored.begin(),
+                       FoldAscii);
+      }
+      storage_.push_back(std::move(stored));
+    }
+  }
+
+  // storage_ is complete, so these views stay valid until the next Rebuild().
+  for (const auto& name : storage_) {
+    names_.insert(name);
+    max_length_ = std::max(max_length_, name.size());
+  }
+}
+
+bool ProcessMatcher::Matches(std::string_view name) const {
+  if (name.empty() || name.size() > max_length_) return false;
+  if (case_sensitivity_ == CaseSensitivity::kSensitive) {
+    return names_.count(name) != 0;
+  }
+
+  char folded[kMaxFoldedLength];
+  std::transform(name.begin(), name.end(), folded, FoldAscii);
+  return names_.count(std::string_view(folded, name.size())) != 0;
+}
+
+}  // namespace no_screen_mirror
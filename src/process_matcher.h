@@ -0,0 +1,56 @@
+#ifndef NO_SCREEN_MIRROR_PROCESS_MATCHER_H_
+#define NO_SCREEN_MIRROR_PROCESS_MATCHER_H_
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace no_screen_mirror {
+
+// Matches process names against the built-in screen-sharing list plus the
+// app's customScreenSharingProcesses.
+//
+// Names are kept in a hash set so each lookup costs one hash of the candidate,
+// regardless of how many names are configured. Matches() is const and safe to
+// call from several threads at once.
+class ProcessMatcher {
+ public:
+  enum class CaseSensitivity {
+    // Linux comm names.
+    kSensitive,
+    // Windows executable names. Folds ASCII letters only.
+    kInsensitive,
+  };
+
+  ProcessMatcher(const std::vector<std::string>& default_names,
+                 CaseSensitivity case_sensitivity);
+
+  ProcessMatcher(const ProcessMatcher&) = delete;
+  ProcessMatcher& operator=(const ProcessMatcher&) = delete;
+
+  // Replaces the custom names; the default names always apply. Returns
+  // whether that changed which names match, so callers only rescan when the
+  // rules did; order, duplicates and (when insensitive) case do not count.
+  bool SetCustomNames(const std::vector<std::string>& custom_names);
+
+  bool Matches(std::string_view name) const;
+
+ private:
+  void Rebuild();
+
+  CaseSensitivity case_sensitivity_;
+  std::vector<std::string> default_names_;
+  std::vector<std::string> custom_names_;
+  // Every name, ASCII-folded when case-insensitive. names_ holds views into
+  // it, so it is only modified by Rebuild().
+  std::vector<std::string> storage_;
+  std::unordered_set<std::string_view> names_;
+  // Longer candidates can't match and skip hashing.
+  size_t max_length_ = 0;
+};
+
+}  // namespace no_screen_mirror
+
+#endif  // NO_SCREEN_MIRROR_PROCESS_MATCHER_H_
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "detector.h"
+
+namespace no_screen_mirror {
+namespace test {
+
+namespace {
+
+class FakeDisplayProbe : public DisplayProbe {
+ public:
+  DisplayInfo Scan() override { return info; }
+
+  DisplayInfo info;
+};
+
+class FakeProcessProbe : public ProcessProbe {
+ public:
+  bool ForEachProcess(const Visitor& visit) override {
+    visited = 0;
+    for (const auto& name : names) {
+      visited++;
+      if (visit(name)) return true;
+    }
+    return false;
+  }
+
+  std::vector<std::string> names;
+  size_t visited = 0;
+};
+
+}  // namespace
+
+TEST(StateTracker, ReportsOnlyChanges) {
+  StateTracker tracker;
+  DetectionState state;
+  EXPECT_FALSE(tracker.Update(state));
+
+  state.display_count = 2;
+  EXPECT_TRUE(tracker.Update(state));
+  EXPECT_FALSE(tracker.Update(state));
+  EXPECT_EQ(tracker.last().display_count, 2);
+
+  state.is_screen_shared = true;
+  tracker.Reset(state);
+  EXPECT_FALSE(tracker.Update(state));
+}
+
+TEST(Detector, CombinesProbes) {
+  FakeDisplayProbe displays;
+  displays.info.is_external_display_connected = true;
+  displays.info.display_count = 2;
+  FakeProcessProbe processes;
+  processes.names = {"bash", "zoom", "ffmpeg"};
+  ProcessMatcher matcher({"zoom"}, ProcessMatcher::CaseSensitivity::kSensitive);
+
+  Detector detector(&displays, &processes, &matcher);
+  DetectionState state = detector.Reset();
+
+  EXPECT_TRUE(state.is_external_display_connected);
+  EXPECT_EQ(state.display_count, 2);
+  EXPECT_TRUE(state.is_screen_shared);
+  // The walk stops at the first match.
+  EXPECT_EQ(processes.visited, 2u);
+}
+
+TEST(Detector, PollReportsChanges) {
+  FakeDisplayProbe displays;
+  FakeProcessProbe processes;
+  ProcessMatcher matcher({"obs"}, ProcessMatcher::CaseSensitivity::kSensitive);
+  Detector detector(&displays, &processes, &matcher);
+  detector.Reset();
+
+  EXPECT_FALSE(detector.Poll());
+
+  processes.names = {"obs"};
+  EXPECT_TRUE(detector.Poll());
+  EXPECT_TRUE(detector.state().is_screen_shared);
+  EXPECT_FALSE(detector.Poll());
+
+  displays.info.display_count = 0;
+  // A probe that finds no display still reports one.
+  EXPECT_FALSE(detector.Poll());
+  EXPECT_EQ(detector.state().display_count, 1);
+}
+
+}  // namespace test
+}  // namespace no_screen_mirror
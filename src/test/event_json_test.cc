@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#include "event_json.h"
+
+namespace no_screen_mirror {
+namespace test {
+
+TEST(EventJson, EncodesDefaultState) {
+  EXPECT_EQ(EncodeEventJson(DetectionState()),
+            "{\"is_screen_mirrored\":false,"
+            "\"is_external_display_connected\":false,"
+            "\"display_count\":1,\"is_screen_shared\":false}");
+}
+
+TEST(EventJson, EncodesEveryField) {
+  DetectionState state;
+  state.is_screen_mirrored = true;
+  state.is_external_display_connected = true;
+  state.display_count = 12;
+  state.is_screen_shared = true;
+
+  EXPECT_EQ(EncodeEventJson(state),
+            "{\"is_screen_mirrored\":true,"
+            "\"is_external_display_connected\":true,"
+            "\"display_count\":12,\"is_screen_shared\":true}");
+}
+
+TEST(EventJson, ReplacesPreviousContents) {
+  std::string json = "stale";
+  DetectionState state;
+  state.display_count = -3;
+  EncodeEventJson(state, &json);
+
+  EXPECT_EQ(json, EncodeEventJson(state));
+  EXPECT_NE(json.find("\"display_count\":-3,"), std::string::npos);
+}
+
+TEST(EventJson, AppendsTheStamp) {
+  EventStamp stamp;
+  stamp.sequence = 42;
+  stamp.detected_at_us = 9007199254740993;
+  stamp.enqueued_at_us = 9007199254741000;
+  std::string json;
+  EncodeEventJson(DetectionState(), stamp, &json);
+
+  EXPECT_EQ(json,
+            "{\"is_screen_mirrored\":false,"
+            "\"is_external_display_connected\":false,"
+            "\"display_count\":1,\"is_screen_shared\":false,"
+            "\"sequence\":42,\"detected_at_us\":9007199254740993,"
+            "\"enqueued_at_us\":9007199254741000}");
+}
+
+TEST(EventJson, MarksProvisionalStates) {
+  EventStamp stamp;
+  stamp.sequence = 1;
+  stamp.provisional = true;
+  std::string json;
+  EncodeEventJson(DetectionState(), stamp, &json);
+
+  EXPECT_EQ(json.substr(json.find("\"enqueued_at_us\"")),
+            "\"enqueued_at_us\":0,\"provisional\":true}");
+}
+
+TEST(EventJson, CountsCoalescedChangesOnlyWhenAny) {
+  EventStamp stamp;
+  stamp.sequence = 5;
+  std::string json;
+  EncodeEventJson(DetectionState(), stamp, &json);
+  EXPECT_EQ(json.find("coalesced"), std::string::npos);
+
+  stamp.coalesced = 3;
+  EncodeEventJson(DetectionState(), stamp, &json);
+  EXPECT_NE(json.find("\"is_screen_shared\":false,\"coalesced\":3,"
+                      "\"sequence\":5,"),
+            std::string::npos);
+}
+
+}  // namespace test
+}  // namespace no_screen_mirror
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+
+#include "event_json.h"
+#include "event_outbox.h"
+
+namespace no_screen_mirror {
+namespace test {
+
+DetectionState WithDisplays(int display_count) {
+  DetectionState state;
+  state.display_count = display_count;
+  return state;
+}
+
+TEST(EventOutbox, AlwaysRecordsTheFirstState) {
+  EventOutbox outbox;
+  EXPECT_FALSE(outbox.has_pending());
+
+  EXPECT_TRUE(outbox.Record(DetectionState(), 100));
+  EXPECT_TRUE(outbox.has_pending());
+  EXPECT_EQ(outbox.sequence(), 1u);
+}
+
+TEST(EventOutbox, StampsThePendingEvent) {
+  EventOutbox outbox;
+  outbox.Record(WithDisplays(2), 100);
+
+  std::string json;
+  ASSERT_TRUE(outbox.TakePending(130, &json));
+
+  EventStamp stamp;
+  stamp.sequence = 1;
+  stamp.detected_at_us = 100;
+  stamp.enqueued_at_us = 130;
+  std::string expected;
+  EncodeEventJson(WithDisplays(2), stamp, &expected);
+  EXPECT_EQ(json, expected);
+
+  EXPECT_FALSE(outbox.has_pending());
+  json = "untouched";
+  EXPECT_FALSE(outbox.TakePending(140, &json));
+  EXPECT_EQ(json, "untouched");
+}
+
+TEST(EventOutbox, IgnoresUnchangedStates) {
+  EventOutbox outbox;
+  outbox.Record(WithDisplays(2), 100);
+  std::string json;
+  outbox.TakePending(110, &json);
+
+  EXPECT_FALSE(outbox.Record(WithDisplays(2), 200));
+  EXPECT_FALSE(outbox.has_pending());
+  EXPECT_EQ(outbox.sequence(), 1u);
+  EXPECT_EQ(outbox.state(), WithDisplays(2));
+  EXPECT_EQ(outbox.detected_at_us(), 100);
+}
+
+TEST(EventOutbox, LatestStateWinsBetweenTakes) {
+  EventOutbox outbox;
+  outbox.Record(WithDisplays(1), 100);
+  outbox.Record(WithDisplays(2), 200);
+  outbox.Record(WithDisplays(3), 300);
+
+  std::string json;
+  ASSERT_TRUE(outbox.TakePending(310, &json));
+  EXPECT_NE(json.find("\"display_count\":3,"), std::string::npos);
+  // The skipped sequence numbers tell Dart two states never arrived.
+  EXPECT_NE(json.find("\"sequence\":3,\"detected_at_us\":300,"
+                      "\"enqueued_at_us\":310}"),
+            std::string::npos);
+}
+
+TEST(EventOutbox, CountsReplacedStatesInTheNextEvent) {
+  EventOutbox outbox;
+  outbox.RecordProvisional(WithDisplays(1), 50);
+  outbox.Record(WithDisplays(2), 100);
+  outbox.Record(WithDisplays(3), 200);
+  outbox.Record(WithDisplays(2), 300);
+
+  std::string json;
+  ASSERT_TRUE(outbox.TakePending(310, &json));
+  // The provisional state was not a change, so only two were replaced.
+  EXPECT_NE(json.find("\"coalesced\":2,"), std::string::npos);
+
+  outbox.Record(WithDisplays(1), 400);
+  ASSERT_TRUE(outbox.TakePending(410, &json));
+  EXPECT_EQ(json.find("coalesced"), std::string::npos);
+}
+
+TEST(EventOutbox, RateLimitsTakesAfterTheLeadingEdge) {
+  EventOutbox outbox;
+  outbox.set_max_events_per_second(10);
+  std::string json;
+
+  // Nothing taken yet: the first change goes out right away.
+  outbox.Record(WithDisplays(2), 1000000);
+  EXPECT_EQ(outbox.NextTakeUs(1000000), 1000000);
+  outbox.TakePending(1000000, &json);
+
+  // Within 100 ms of that take, the next one waits for the interval to end.
+  outbox.Record(WithDisplays(3), 1020000);
+  EXPECT_EQ(outbox.NextTakeUs(1020000), 1100000);
+  outbox.TakePending(1100000, &json);
+
+  // After a quiet interval, immediate again.
+  outbox.Record(WithDisplays(1), 1500000);
+  EXPECT_EQ(outbox.NextTakeUs(1500000), 1500000);
+
+  outbox.set_max_events_per_second(0);
+  outbox.TakePending(1500000, &json);
+  outbox.Record(WithDisplays(2), 1500001);
+  EXPECT_EQ(outbox.NextTakeUs(1500001), 1500001);
+}
+
+TEST(EventOutbox, ConfirmsAProvisionalStateEvenIfUnchanged) {
+  EventOutbox outbox;
+  outbox.RecordProvisional(WithDisplays(2), 50);
+  EXPECT_TRUE(outbox.provisional());
+  std::string json;
+  ASSERT_TRUE(outbox.TakePending(60, &json));
+  EXPECT_NE(json.find("\"provisional\":true"), std::string::npos);
+
+  EXPECT_TRUE(outbox.Record(WithDisplays(2), 100));
+  EXPECT_FALSE(outbox.provisional());
+  EXPECT_EQ(outbox.sequence(), 2u);
+  ASSERT_TRUE(outbox.TakePending(110, &json));
+  EXPECT_EQ(json.find("provisional"), std::string::npos);
+
+  // Back to ordinary change detection.
+  EXPECT_FALSE(outbox.Record(WithDisplays(2), 200));
+}
+
+TEST(EventOutbox, MonotonicClockNeverGoesBackwards) {
+  int64_t first = MonotonicNowUs();
+  int64_t second = MonotonicNowUs();
+  EXPECT_GT(first, 0);
+  EXPECT_GE(second, first);
+}
+
+}  // namespace test
+}  // namespace no_screen_mirror
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include "metrics.h"
+
+namespace no_screen_mirror {
+namespace test {
+
+bool HasLine(const std::string& text, const std::string& line) {
+  return text.find("\n" + line + "\n") != std::string::npos;
+}
+
+TEST(Metrics, RendersCumulativeScanBuckets) {
+  Metrics metrics;
+  metrics.RecordScan(Metrics::Probe::kProcesses, 40);
+  metrics.RecordScan(Metrics::Probe::kProcesses, 3000);
+  metrics.RecordScan(Metrics::Probe::kProcesses, 2000000);
+
+  std::string text;
+  metrics.Render(&text);
+  EXPECT_TRUE(HasLine(
+      text, "# TYPE no_screen_mirror_scan_duration_seconds histogram"));
+  EXPECT_TRUE(HasLine(text,
+                      "no_screen_mirror_scan_duration_seconds_bucket{probe="
+                      "\"processes\",le=\"0.00005\"} 1"));
+  EXPECT_TRUE(HasLine(text,
+                      "no_screen_mirror_scan_duration_seconds_bucket{probe="
+                      "\"processes\",le=\"0.005\"} 2"));
+  EXPECT_TRUE(HasLine(text,
+                      "no_screen_mirror_scan_duration_seconds_bucket{probe="
+                      "\"processes\",le=\"0.1\"} 2"));
+  EXPECT_TRUE(HasLine(text,
+                      "no_screen_mirror_scan_duration_seconds_bucket{probe="
+                      "\"processes\",le=\"+Inf\"} 3"));
+  EXPECT_TRUE(HasLine(
+      text,
+      "no_screen_mirror_scan_duration_seconds_sum{probe=\"processes\"} "
+      "2.00304"));
+  EXPECT_TRUE(HasLine(
+      text,
+      "no_screen_mirror_scan_duration_seconds_count{probe=\"processes\"} 3"));
+  EXPECT_TRUE(HasLine(
+      text,
+      "no_screen_mirror_scan_duration_seconds_count{probe=\"connectors\"} 0"));
+}
+
+TEST(Metrics, RendersCountersAndGauges) {
+  Metrics metrics;
+  metrics.RecordProbeError(Metrics::Probe::kConnectors);
+  metrics.RecordEvent(0);
+  metrics.RecordEvent(3);
+  DetectionState state;
+  state.is_external_display_connected = true;
+  state.display_count = 2;
+  metrics.SetState(state);
+  metrics.SetProcessCount(412);
+
+  std::string text;
+  metrics.Render(&text);
+  EXPECT_TRUE(HasLine(
+      text, "no_screen_mirror_probe_errors_total{probe=\"connectors\"} 1"));
+  EXPECT_TRUE(HasLine(
+      text, "no_screen_mirror_probe_errors_total{probe=\"processes\"} 0"));
+  EXPECT_TRUE(HasLine(text, "no_screen_mirror_events_total 2"));
+  EXPECT_TRUE(HasLine(text, "no_screen_mirror_events_coalesced_total 3"));
+  EXPECT_TRUE(HasLine(text, "no_screen_mirror_external_display_connected 1"));
+  EXPECT_TRUE(HasLine(text, "no_screen_mirror_display_count 2"));
+  EXPECT_TRUE(HasLine(text, "no_screen_mirror_screen_shared 0"));
+  EXPECT_TRUE(HasLine(text, "no_screen_mirror_process_table_size 412"));
+  ASSERT_FALSE(text.empty());
+  EXPECT_EQ(text.back(), '\n');
+}
+
+TEST(Metrics, RendersWakeupsPerHour) {
+  Metrics metrics;
+  std::string text;
+  metrics.Render(&text);
+  EXPECT_TRUE(HasLine(text, "no_screen_mirror_wakeups_total 0"));
+  EXPECT_TRUE(HasLine(text, "no_screen_mirror_wakeups_per_hour 0"));
+
+  // Five wakeups two seconds apart: one every 2 s is 1800 an hour.
+  for (int64_t i = 0; i < 5; i++) metrics.RecordWakeup(1000000 + i * 2000000);
+  metrics.Render(&text);
+  EXPECT_TRUE(HasLine(text, "no_screen_mirror_wakeups_total 5"));
+  EXPECT_TRUE(HasLine(text, "no_screen_mirror_wakeups_per_hour 1800"));
+}
+
+}  // namespace test
+}  // namespace no_screen_mirror
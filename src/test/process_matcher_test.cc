@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+
+#include "process_matcher.h"
+
+namespace no_screen_mirror {
+namespace test {
+
+TEST(ProcessMatcher, MatchesDefaultAndCustomNames) {
+  ProcessMatcher matcher({"zoom", "obs"},
+                         ProcessMatcher::CaseSensitivity::kSensitive);
+  EXPECT_TRUE(matcher.Matches("zoom"));
+  EXPECT_FALSE(matcher.Matches("my-meetings"));
+
+  matcher.SetCustomNames({"my-meetings"});
+  EXPECT_TRUE(matcher.Matches("my-meetings"));
+  EXPECT_TRUE(matcher.Matches("obs"));
+
+  matcher.SetCustomNames({});
+  EXPECT_FALSE(matcher.Matches("my-meetings"));
+}
+
+TEST(ProcessMatcher, RequiresWholeName) {
+  ProcessMatcher matcher({"zoom"}, ProcessMatcher::CaseSensitivity::kSensitive);
+  EXPECT_FALSE(matcher.Matches("zoo"));
+  EXPECT_FALSE(matcher.Matches("zoomit"));
+  EXPECT_FALSE(matcher.Matches(""));
+}
+
+TEST(ProcessMatcher, HonorsCaseSensitivity) {
+  ProcessMatcher sensitive({"Zoom.exe"},
+                           ProcessMatcher::CaseSensitivity::kSensitive);
+  EXPECT_TRUE(sensitive.Matches("Zoom.exe"));
+  EXPECT_FALSE(sensitive.Matches("zoom.exe"));
+
+  ProcessMatcher insensitive({"Zoom.exe"},
+                             ProcessMatcher::CaseSensitivity::kInsensitive);
+  insensitive.SetCustomNames({"MyApp.EXE"});
+  EXPECT_TRUE(insensitive.Matches("zoom.exe"));
+  EXPECT_TRUE(insensitive.Matches("ZOOM.EXE"));
+  EXPECT_TRUE(insensitive.Matches("myapp.exe"));
+}
+
+TEST(ProcessMatcher, ReportsWhetherCustomNamesChangedTheRules) {
+  ProcessMatcher matcher({"Zoom.exe"},
+                         ProcessMatcher::CaseSensitivity::kInsensitive);
+  EXPECT_TRUE(matcher.SetCustomNames({"MyApp.exe", "Other.exe"}));
+  EXPECT_FALSE(matcher.SetCustomNames({"other.EXE", "myapp.exe", "MyApp.exe"}));
+  // Already a default name.
+  EXPECT_FALSE(matcher.SetCustomNames({"other.exe", "myapp.exe", "zoom.exe"}));
+  EXPECT_TRUE(matcher.SetCustomNames({"myapp.exe"}));
+  EXPECT_TRUE(matcher.Matches("MYAPP.EXE"));
+  EXPECT_FALSE(matcher.Matches("other.exe"));
+  EXPECT_TRUE(matcher.SetCustomNames({}));
+  EXPECT_FALSE(matcher.Matches("myapp.exe"));
+}
+
+TEST(ProcessMatcher, KeepsNamesValidAcrossManyCustomNames) {
+  ProcessMatcher matcher({"zoom"}, ProcessMatcher::CaseSensitivity::kSensitive);
+  std::vector<std::string> custom_names;
+  for (int i = 0; i < 1000; i++) {
+    custom_names.push_back("app-" + std::to_string(i));
+  }
+  matcher.SetCustomNames(custom_names);
+
+  EXPECT_TRUE(matcher.Matches("zoom"));
+  EXPECT_TRUE(matcher.Matches("app-0"));
+  EXPECT_TRUE(matcher.Matches("app-999"));
+  EXPECT_FALSE(matcher.Matches("app-1000"));
+}
+
+}  // namespace test
+}  // namespace no_screen_mirror
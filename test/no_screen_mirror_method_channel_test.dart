@@ -1,6 +1,8 @@
 import 'package:flutter/services.dart';
 import 'package:flutter_test/flutter_test.dart';
 import 'package:no_screen_mirror/constants.dart';
+import 'package:no_screen_mirror/linux_scan_options.dart';
+import 'package:no_screen_mirror/mirror_field.dart';
 import 'package:no_screen_mirror/mirror_snapshot.dart';
 import 'package:no_screen_mirror/no_screen_mirror_method_channel.dart';
 
@@ -86,6 +88,105 @@ void main() {
       expect(capturedArgs!.containsKey('customProcesses'), false);
     });
 
+    test('startListening sends Linux scan options', () async {
+      Map<String, dynamic>? capturedArgs;
+      TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger
+          .setMockMethodCallHandler(channel, (MethodCall methodCall) async {
+        if (methodCall.method == startListeningConst) {
+          capturedArgs = Map<String, dynamic>.from(
+              methodCall.arguments as Map<Object?, Object?>);
+          return null;
+        }
+        return null;
+      });
+
+      await platform.startListening(
+        linuxScanOptions: const LinuxScanOptions(
+          processSource: LinuxProcessSource.appScopes,
+        ),
+      );
+      expect(capturedArgs!['linuxScanOptions'], {
+        'processSource': 'appScopes',
+        'requireCaptureEvidence': false,
+        'captureFdBudget': 256,
+        'scanSliceBudgetUs': 0,
+        'scanThreads': 1,
+      });
+    });
+
+    test('startListening omits Linux scan options by default', () async {
+      Map<String, dynamic>? capturedArgs;
+      TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger
+          .setMockMethodCallHandler(channel, (MethodCall methodCall) async {
+        if (methodCall.method == startListeningConst) {
+          capturedArgs = Map<String, dynamic>.from(
+              methodCall.arguments as Map<Object?, Object?>);
+          return null;
+        }
+        return null;
+      });
+
+      await platform.startListening();
+      expect(capturedArgs!.containsKey('linuxScanOptions'), false);
+    });
+
+    test('startListening sends subscribed fields', () async {
+      Map<String, dynamic>? capturedArgs;
+      TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger
+          .setMockMethodCallHandler(channel, (MethodCall methodCall) async {
+        if (methodCall.method == startListeningConst) {
+          capturedArgs = Map<String, dynamic>.from(
+              methodCall.arguments as Map<Object?, Object?>);
+          return null;
+        }
+        return null;
+      });
+
+      await platform.startListening(
+        fields: {
+          MirrorField.externalDisplayConnected,
+          MirrorField.displayCount,
+        },
+      );
+      expect(capturedArgs!['fields'],
+          ['externalDisplayConnected', 'displayCount']);
+    });
+
+    test('startListening sends maxEventsPerSecond only when set', () async {
+      Map<String, dynamic>? capturedArgs;
+      TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger
+          .setMockMethodCallHandler(channel, (MethodCall methodCall) async {
+        if (methodCall.method == startListeningConst) {
+          capturedArgs = Map<String, dynamic>.from(
+              methodCall.arguments as Map<Object?, Object?>);
+          return null;
+        }
+        return null;
+      });
+
+      await platform.startListening(maxEventsPerSecond: 20);
+      expect(capturedArgs!['maxEventsPerSecond'], 20);
+
+      await platform.startListening();
+      expect(capturedArgs!.containsKey('maxEventsPerSecond'), false);
+    });
+
+    test('startListening omits fields by default', () async {
+      Map<String, dynamic>? capturedArgs;
+      TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger
+          .setMockMethodCallHandler(channel, (MethodCall methodCall) async {
+        if (methodCall.method == startListeningConst) {
+          capturedArgs = Map<String, dynamic>.from(
+              methodCall.arguments as Map<Object?, Object?>);
+          return null;
+        }
+        return null;
+      });
+
+      await platform.startListening();
+      expect(capturedArgs!.containsKey('fields'), false);
+    });
+
     test('stopListening', () async {
       TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger
           .setMockMethodCallHandler(channel, (MethodCall methodCall) async {
@@ -98,6 +199,28 @@ void main() {
       await platform.stopListening();
       expect(true, true);
     });
+
+    test('updateConfig sends only the given settings', () async {
+      Map<String, dynamic>? capturedArgs;
+      TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger
+          .setMockMethodCallHandler(channel, (MethodCall methodCall) async {
+        if (methodCall.method == updateConfigConst) {
+          capturedArgs = Map<String, dynamic>.from(
+              methodCall.arguments as Map<Object?, Object?>);
+          return null;
+        }
+        return null;
+      });
+
+      await platform.updateConfig(customScreenSharingProcesses: []);
+      expect(capturedArgs, {'customProcesses': []});
+
+      await platform.updateConfig(
+        pollingInterval: const Duration(milliseconds: 500),
+        maxEventsPerSecond: 0,
+      );
+      expect(capturedArgs, {'pollingIntervalMs': 500, 'maxEventsPerSecond': 0});
+    });
   });
 
   group('MirrorSnapshot', () {
@@ -228,5 +351,248 @@ void main() {
       final roundtripped = MirrorSnapshot.fromMap(original.toMap());
       expect(roundtripped, original);
     });
+
+    test('fromMap reads delivery stamps', () {
+      final snapshot = MirrorSnapshot.fromMap({
+        'display_count': 2,
+        'sequence': 7,
+        'detected_at_us': 1000,
+        'enqueued_at_us': 1250,
+      });
+      expect(snapshot.sequence, 7);
+      expect(snapshot.detectedAtUs, 1000);
+      expect(snapshot.enqueuedAtUs, 1250);
+      expect(snapshot.enqueueDelay, const Duration(microseconds: 250));
+      expect(snapshot.toMap()['sequence'], 7);
+    });
+
+    test('delivery stamps are optional', () {
+      final snapshot = MirrorSnapshot.fromMap({'display_count': 2});
+      expect(snapshot.sequence, isNull);
+      expect(snapshot.enqueueDelay, isNull);
+      expect(snapshot.toMap().containsKey('sequence'), false);
+    });
+
+    test('equality ignores delivery stamps', () {
+      final first = MirrorSnapshot(
+        isScreenMirrored: false,
+        isExternalDisplayConnected: true,
+        displayCount: 2,
+        sequence: 1,
+        detectedAtUs: 10,
+        enqueuedAtUs: 20,
+      );
+      final second = MirrorSnapshot(
+        isScreenMirrored: false,
+        isExternalDisplayConnected: true,
+        displayCount: 2,
+        sequence: 5,
+        detectedAtUs: 50,
+        enqueuedAtUs: 60,
+      );
+      expect(first, second);
+      expect(first.hashCode, second.hashCode);
+    });
+
+    test('fromMap reads the provisional flag', () {
+      final snapshot = MirrorSnapshot.fromMap({
+        'display_count': 2,
+        'sequence': 1,
+        'provisional': true,
+      });
+      expect(snapshot.isProvisional, true);
+      expect(snapshot.toMap()['provisional'], true);
+      expect(snapshot.toString(), contains('isProvisional: true'));
+    });
+
+    test('snapshots are not provisional by default', () {
+      final snapshot = MirrorSnapshot.fromMap({'display_count': 2});
+      expect(snapshot.isProvisional, false);
+      expect(snapshot.toMap().containsKey('provisional'), false);
+      expect(
+          snapshot,
+          MirrorSnapshot.fromMap(
+              {'display_count': 2, 'provisional': true}));
+    });
+
+    test('fromMap reads the coalesced count', () {
+      final snapshot = MirrorSnapshot.fromMap({
+        'display_count': 2,
+        'sequence': 7,
+        'coalesced': 3,
+      });
+      expect(snapshot.coalescedCount, 3);
+      expect(snapshot.toMap()['coalesced'], 3);
+      expect(snapshot.toString(), contains('coalescedCount: 3'));
+      expect(MirrorSnapshot.fromMap({'display_count': 2}).coalescedCount, 0);
+      expect(
+          MirrorSnapshot.fromMap({'display_count': 2})
+              .toMap()
+              .containsKey('coalesced'),
+          false);
+    });
+  });
+
+  group('LinuxScanOptions', () {
+    test('defaults to the process table', () {
+      const options = LinuxScanOptions();
+      expect(options.processSource, LinuxProcessSource.processTable);
+      expect(options.processScope, LinuxProcessScope.all);
+      expect(options.requireCaptureEvidence, false);
+      expect(options.captureFdBudget, 256);
+      expect(options.matchLibraries, false);
+      expect(options.scanSliceBudget, Duration.zero);
+      expect(options.scanThreads, 1);
+      expect(options.connectorPollingInterval, isNull);
+      expect(options.processPollingInterval, isNull);
+      expect(options.awaitFirstScan, false);
+      expect(options.lowPower, false);
+      expect(options.stateExportName, isNull);
+      expect(options.metricsSocketPath, isNull);
+      expect(options.metricsTextfilePath, isNull);
+      expect(options.journalPath, isNull);
+      expect(options.journalCapacity, 4096);
+      expect(options.probeTracePath, isNull);
+      expect(options.shareDetector, false);
+      expect(options.procRoot, isNull);
+      expect(options.drmRoot, isNull);
+    });
+
+    test('toMap', () {
+      const options = LinuxScanOptions(
+        processSource: LinuxProcessSource.appScopes,
+        requireCaptureEvidence: true,
+        captureFdBudget: 64,
+        scanSliceBudget: Duration(microseconds: 500),
+        scanThreads: 4,
+      );
+      expect(options.toMap(), {
+        'processSource': 'appScopes',
+        'requireCaptureEvidence': true,
+        'captureFdBudget': 64,
+        'scanSliceBudgetUs': 500,
+        'scanThreads': 4,
+      });
+    });
+
+    test('toMap includes processScope only when narrowed', () {
+      const options = LinuxScanOptions(processScope: LinuxProcessScope.session);
+      expect(options.toMap()['processScope'], 'session');
+      expect(const LinuxScanOptions().toMap().containsKey('processScope'),
+          false);
+    });
+
+    test('toMap includes fixture roots only when set', () {
+      const options = LinuxScanOptions(
+        procRoot: '/tmp/proc',
+        drmRoot: '/tmp/drm',
+      );
+      expect(options.toMap()['procRoot'], '/tmp/proc');
+      expect(options.toMap()['drmRoot'], '/tmp/drm');
+      expect(const LinuxScanOptions().toMap().containsKey('procRoot'), false);
+    });
+
+    test('toMap includes per-probe intervals only when set', () {
+      const options = LinuxScanOptions(
+        connectorPollingInterval: Duration(milliseconds: 250),
+        processPollingInterval: Duration(seconds: 5),
+      );
+      expect(options.toMap()['connectorPollingIntervalMs'], 250);
+      expect(options.toMap()['processPollingIntervalMs'], 5000);
+      expect(
+          const LinuxScanOptions()
+              .toMap()
+              .containsKey('connectorPollingIntervalMs'),
+          false);
+    });
+
+    test('toMap includes matchLibraries only when enabled', () {
+      const options = LinuxScanOptions(matchLibraries: true);
+      expect(options.toMap()['matchLibraries'], true);
+      expect(const LinuxScanOptions().toMap().containsKey('matchLibraries'),
+          false);
+    });
+
+    test('toMap includes awaitFirstScan only when enabled', () {
+      const options = LinuxScanOptions(awaitFirstScan: true);
+      expect(options.toMap()['awaitFirstScan'], true);
+      expect(const LinuxScanOptions().toMap().containsKey('awaitFirstScan'),
+          false);
+    });
+
+    test('toMap includes lowPower only when enabled', () {
+      const options = LinuxScanOptions(lowPower: true);
+      expect(options.toMap()['lowPower'], true);
+      expect(const LinuxScanOptions().toMap().containsKey('lowPower'), false);
+    });
+
+    test('toMap includes shareDetector only when enabled', () {
+      const options = LinuxScanOptions(shareDetector: true);
+      expect(options.toMap()['shareDetector'], true);
+      expect(const LinuxScanOptions().toMap().containsKey('shareDetector'),
+          false);
+    });
+
+    test('toMap includes the state export name only when set', () {
+      const options = LinuxScanOptions(stateExportName: '/no_screen_mirror');
+      expect(options.toMap()['stateExportName'], '/no_screen_mirror');
+      expect(
+          const LinuxScanOptions().toMap().containsKey('stateExportName'),
+          false);
+    });
+
+    test('toMap includes metrics paths only when set', () {
+      const options = LinuxScanOptions(
+        metricsSocketPath: '/run/user/1000/no_screen_mirror.sock',
+        metricsTextfilePath: '/var/lib/node_exporter/no_screen_mirror.prom',
+      );
+      expect(options.toMap()['metricsSocketPath'],
+          '/run/user/1000/no_screen_mirror.sock');
+      expect(options.toMap()['metricsTextfilePath'],
+          '/var/lib/node_exporter/no_screen_mirror.prom');
+      expect(
+          const LinuxScanOptions().toMap().containsKey('metricsSocketPath'),
+          false);
+      expect(
+          const LinuxScanOptions().toMap().containsKey('metricsTextfilePath'),
+          false);
+    });
+
+    test('toMap includes the journal only when a path is set', () {
+      const options = LinuxScanOptions(
+        journalPath: '/var/lib/kiosk/no_screen_mirror.journal',
+        journalCapacity: 1024,
+      );
+      expect(options.toMap()['journalPath'],
+          '/var/lib/kiosk/no_screen_mirror.journal');
+      expect(options.toMap()['journalCapacity'], 1024);
+      final defaults = const LinuxScanOptions().toMap();
+      expect(defaults.containsKey('journalPath'), false);
+      expect(defaults.containsKey('journalCapacity'), false);
+    });
+
+    test('toMap includes the probe trace path only when set', () {
+      const options = LinuxScanOptions(probeTracePath: '/tmp/field.trace');
+      expect(options.toMap()['probeTracePath'], '/tmp/field.trace');
+      expect(const LinuxScanOptions().toMap().containsKey('probeTracePath'),
+          false);
+    });
+
+    test('equality operator', () {
+      const options1 =
+          LinuxScanOptions(processSource: LinuxProcessSource.appScopes);
+      const options2 =
+          LinuxScanOptions(processSource: LinuxProcessSource.appScopes);
+      const options3 = LinuxScanOptions();
+      const options4 = LinuxScanOptions(
+        processSource: LinuxProcessSource.appScopes,
+        requireCaptureEvidence: true,
+      );
+
+      expect(options1 == options2, true);
+      expect(options1 == options3, false);
+      expect(options1 == options4, false);
+      expect(options1.hashCode, options2.hashCode);
+    });
   });
 }
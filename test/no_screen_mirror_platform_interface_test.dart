@@ -1,4 +1,6 @@
 import 'package:flutter_test/flutter_test.dart';
+import 'package:no_screen_mirror/linux_scan_options.dart';
+import 'package:no_screen_mirror/mirror_field.dart';
 import 'package:no_screen_mirror/mirror_snapshot.dart';
 import 'package:no_screen_mirror/no_screen_mirror_method_channel.dart';
 import 'package:no_screen_mirror/no_screen_mirror_platform_interface.dart';
@@ -13,6 +15,9 @@ class MockNoScreenMirrorPlatform extends NoScreenMirrorPlatform {
   Future<void> startListening({
     Duration pollingInterval = const Duration(seconds: 2),
     List<String> customScreenSharingProcesses = const [],
+    LinuxScanOptions? linuxScanOptions,
+    Set<MirrorField>? fields,
+    int? maxEventsPerSecond,
   }) async {
     return;
   }
@@ -76,5 +81,12 @@ void main() {
       final basePlatform = BaseNoScreenMirrorPlatform();
       expect(() => basePlatform.stopListening(), throwsUnimplementedError);
     });
+
+    test(
+        'base NoScreenMirrorPlatform.updateConfig() throws UnimplementedError',
+        () {
+      final basePlatform = BaseNoScreenMirrorPlatform();
+      expect(() => basePlatform.updateConfig(), throwsUnimplementedError);
+    });
   });
 }
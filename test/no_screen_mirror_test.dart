@@ -1,4 +1,6 @@
 import 'package:flutter_test/flutter_test.dart';
+import 'package:no_screen_mirror/linux_scan_options.dart';
+import 'package:no_screen_mirror/mirror_field.dart';
 import 'package:no_screen_mirror/mirror_snapshot.dart';
 import 'package:no_screen_mirror/no_screen_mirror.dart';
 import 'package:no_screen_mirror/no_screen_mirror_method_channel.dart';
@@ -15,6 +17,9 @@ class MockNoScreenMirrorPlatform
   Future<void> startListening({
     Duration pollingInterval = const Duration(seconds: 2),
     List<String> customScreenSharingProcesses = const [],
+    LinuxScanOptions? linuxScanOptions,
+    Set<MirrorField>? fields,
+    int? maxEventsPerSecond,
   }) {
     return Future.value();
   }
@@ -23,6 +28,15 @@ class MockNoScreenMirrorPlatform
   Future<void> stopListening() {
     return Future.value();
   }
+
+  @override
+  Future<void> updateConfig({
+    Duration? pollingInterval,
+    List<String>? customScreenSharingProcesses,
+    int? maxEventsPerSecond,
+  }) {
+    return Future.value();
+  }
 }
 
 void main() {
@@ -85,10 +99,31 @@ void main() {
     );
   });
 
+  test('startListening with Linux scan options', () async {
+    expect(
+      NoScreenMirror.instance.startListening(
+        linuxScanOptions: const LinuxScanOptions(
+          processSource: LinuxProcessSource.appScopes,
+        ),
+      ),
+      completes,
+    );
+  });
+
   test('stopListening', () async {
     expect(NoScreenMirror.instance.stopListening(), completes);
   });
 
+  test('updateConfig', () async {
+    expect(
+      NoScreenMirror.instance.updateConfig(
+        pollingInterval: const Duration(seconds: 1),
+        customScreenSharingProcesses: ['custom.exe'],
+      ),
+      completes,
+    );
+  });
+
   test('NoScreenMirror equality operator', () {
     final instance1 = NoScreenMirror.instance;
     final instance2 = NoScreenMirror.instance;
@@ -34,6 +34,14 @@ void main() {
       await expectLater(webPlugin.stopListening(), completes);
     });
 
+    test('updateConfig while listening completes without error', () async {
+      await webPlugin.startListening();
+      await expectLater(
+          webPlugin.updateConfig(pollingInterval: const Duration(seconds: 5)),
+          completes);
+      await webPlugin.stopListening();
+    });
+
     test('stopListening after startListening completes without error',
         () async {
       await webPlugin.startListening();
@@ -7,17 +7,11 @@
 // timer procs). Safe because Flutter Windows runs one engine per process.
 static DisplayDetection* g_detection_instance = nullptr;
 
-DisplayDetection::DisplayDetection(ChangeCallback callback)
-    : callback_(std::move(callback)) {
-  g_detection_instance = this;
-}
-
-DisplayDetection::~DisplayDetection() {
-  Stop();
-  if (g_detection_instance == this) {
-    g_detection_instance = nullptr;
-  }
-}
+static const std::vector<std::string> kDefaultProcessNames = {
+    "Zoom.exe",    "CptHost.exe", "Teams.exe",  "ms-teams.exe",
+    "slack.exe",   "Discord.exe", "obs64.exe",  "obs32.exe",
+    "ffmpeg.exe",
+};
 
 // -------------------------------------------------------------------------
 // Display scanning
@@ -30,83 +24,103 @@ static BOOL CALLBACK MonitorEnumProc(HMONITOR monitor, HDC hdc, LPRECT rect,
   return TRUE;
 }
 
-static const wchar_t* kDefaultProcessNames[] = {
-    L"Zoom.exe",    L"CptHost.exe", L"Teams.exe",  L"ms-teams.exe",
-    L"slack.exe",   L"Discord.exe", L"obs64.exe",  L"obs32.exe",
-    L"ffmpeg.exe",
-};
+namespace {
 
-bool DisplayDetection::IsScreenSharingProcessRunning() {
-  HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
-  if (snapshot == INVALID_HANDLE_VALUE) return false;
+class Win32DisplayProbe : public no_screen_mirror::DisplayProbe {
+ public:
+  no_screen_mirror::DisplayInfo Scan() override {
+    no_screen_mirror::DisplayInfo info;
 
-  PROCESSENTRY32W entry;
-  entry.dwSize = sizeof(entry);
+    // 1. Count monitors via EnumDisplayMonitors
+    int monitor_count = 0;
+    EnumDisplayMonitors(nullptr, nullptr, MonitorEnumProc,
+                        reinterpret_cast<LPARAM>(&monitor_count));
+    if (monitor_count > 0) {
+      info.display_count = monitor_count;
+    }
 
-  if (Process32FirstW(snapshot, &entry)) {
-    do {
-      // Check default process names
-      for (const auto* name : kDefaultProcessNames) {
-        if (_wcsicmp(entry.szExeFile, name) == 0) {
-          CloseHandle(snapshot);
-          return true;
-        }
-      }
-      // Check custom process names
-      for (const auto& name : custom_processes_) {
-        if (_wcsicmp(entry.szExeFile, name.c_str()) == 0) {
-          CloseHandle(snapshot);
-          return true;
+    // External display: more than one monitor means an external is connected.
+    if (monitor_count > 1) {
+      info.is_external_display_connected = true;
+    }
+
+    // 2. Check for Miracast / wireless displays via QueryDisplayConfig
+    UINT32 path_count = 0;
+    UINT32 mode_count = 0;
+    LONG qdc_result = GetDisplayConfigBufferSizes(QDC_ONLY_ACTIVE_PATHS,
+                                                  &path_count, &mode_count);
+    if (qdc_result == ERROR_SUCCESS && path_count > 0) {
+      std::vector<DISPLAYCONFIG_PATH_INFO> paths(path_count);
+      std::vector<DISPLAYCONFIG_MODE_INFO> modes(mode_count);
+      qdc_result = QueryDisplayConfig(QDC_ONLY_ACTIVE_PATHS, &path_count,
+                                      paths.data(), &mode_count, modes.data(),
+                                      nullptr);
+      if (qdc_result == ERROR_SUCCESS) {
+        for (UINT32 i = 0; i < path_count; i++) {
+          if (paths[i].targetInfo.outputTechnology ==
+              DISPLAYCONFIG_OUTPUT_TECHNOLOGY_MIRACAST) {
+            info.is_screen_mirrored = true;
+            break;
+          }
         }
       }
-    } while (Process32NextW(snapshot, &entry));
-  }
-
-  CloseHandle(snapshot);
-  return false;
-}
-
-DisplayDetection::Result DisplayDetection::Scan() {
-  Result result{false, false, 1, false};
+    }
 
-  // 1. Count monitors via EnumDisplayMonitors
-  int monitor_count = 0;
-  EnumDisplayMonitors(nullptr, nullptr, MonitorEnumProc,
-                      reinterpret_cast<LPARAM>(&monitor_count));
-  if (monitor_count > 0) {
-    result.display_count = monitor_count;
+    return info;
   }
+};
 
-  // External display: more than one monitor means an external is connected.
-  if (monitor_count > 1) {
-    result.is_external_connected = true;
-  }
+// -------------------------------------------------------------------------
+// Process scanning
+// -------------------------------------------------------------------------
 
-  // 2. Check for Miracast / wireless displays via QueryDisplayConfig
-  UINT32 path_count = 0;
-  UINT32 mode_count = 0;
-  LONG qdc_result = GetDisplayConfigBufferSizes(QDC_ONLY_ACTIVE_PATHS,
-                                                &path_count, &mode_count);
-  if (qdc_result == ERROR_SUCCESS && path_count > 0) {
-    std::vector<DISPLAYCONFIG_PATH_INFO> paths(path_count);
-    std::vector<DISPLAYCONFIG_MODE_INFO> modes(mode_count);
-    qdc_result = QueryDisplayConfig(QDC_ONLY_ACTIVE_PATHS, &path_count,
-                                    paths.data(), &mode_count, modes.data(),
-                                    nullptr);
-    if (qdc_result == ERROR_SUCCESS) {
-      for (UINT32 i = 0; i < path_count; i++) {
-        if (paths[i].targetInfo.outputTechnology ==
-            DISPLAYCONFIG_OUTPUT_TECHNOLOGY_MIRACAST) {
-          result.is_screen_mirrored = true;
+class ToolhelpProcessProbe : public no_screen_mirror::ProcessProbe {
+ public:
+  bool ForEachProcess(const Visitor& visit) override {
+    HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+    if (snapshot == INVALID_HANDLE_VALUE) return false;
+
+    PROCESSENTRY32W entry;
+    entry.dwSize = sizeof(entry);
+
+    bool stopped = false;
+    if (Process32FirstW(snapshot, &entry)) {
+      do {
+        // The matcher works on UTF-8 names.
+        char name[MAX_PATH * 3];
+        int length = WideCharToMultiByte(CP_UTF8, 0, entry.szExeFile, -1,
+                                         name, static_cast<int>(sizeof(name)),
+                                         nullptr, nullptr);
+        if (length <= 1) continue;
+        if (visit(std::string_view(name, length - 1))) {
+          stopped = true;
           break;
         }
-      }
+      } while (Process32NextW(snapshot, &entry));
     }
+
+    CloseHandle(snapshot);
+    return stopped;
   }
+};
 
-  result.is_screen_shared = IsScreenSharingProcessRunning();
+}  // namespace
 
-  return result;
+DisplayDetection::DisplayDetection(ChangeCallback callback)
+    : callback_(std::move(callback)),
+      display_probe_(std::make_unique<Win32DisplayProbe>()),
+      process_probe_(std::make_unique<ToolhelpProcessProbe>()),
+      matcher_(kDefaultProcessNames,
+               no_screen_mirror::ProcessMatcher::CaseSensitivity::kInsensitive),
+      detector_(display_probe_.get(), process_probe_.get(), &matcher_) {
+  g_detection_instance = this;
+}
+
+DisplayDetection::~DisplayDetection() {
+  Stop();
+  if (g_detection_instance == this) {
+    g_detection_instance = nullptr;
+  }
 }
 
 // -------------------------------------------------------------------------
@@ -119,35 +133,46 @@ void CALLBACK DisplayDetection::PollTimerProc(HWND /*hwnd*/, UINT /*msg*/,
   if (g_detection_instance == nullptr) return;
   auto* self = g_detection_instance;
 
-  Result current = self->Scan();
-  if (current.is_external_connected != self->last_result_.is_external_connected ||
-      current.is_screen_mirrored != self->last_result_.is_screen_mirrored ||
-      current.display_count != self->last_result_.display_count ||
-      current.is_screen_shared != self->last_result_.is_screen_shared) {
-    self->last_result_ = current;
-    if (self->callback_) {
-      self->callback_(current);
-    }
+  if (self->detector_.Poll() && self->callback_) {
+    self->callback_(self->detector_.state());
   }
 }
 
 void DisplayDetection::Start(UINT poll_interval_ms,
-                             const std::vector<std::wstring>& custom_processes) {
+                             const std::vector<std::string>& custom_processes) {
   if (timer_id_ != 0) return;
 
-  custom_processes_ = custom_processes;
+  matcher_.SetCustomNames(custom_processes);
 
   // Initial scan
-  last_result_ = Scan();
+  const Result& initial = detector_.Reset();
   if (callback_) {
-    callback_(last_result_);
+    callback_(initial);
   }
 
   // Configurable poll timer
   if (poll_interval_ms == 0) poll_interval_ms = 2000;
+  poll_interval_ms_ = poll_interval_ms;
   timer_id_ = SetTimer(nullptr, 0, poll_interval_ms, PollTimerProc);
 }
 
+void DisplayDetection::UpdateConfig(
+    UINT poll_interval_ms, const std::vector<std::string>* custom_processes) {
+  if (timer_id_ == 0) return;
+
+  if (custom_processes != nullptr &&
+      matcher_.SetCustomNames(*custom_processes) && detector_.Poll() &&
+      callback_) {
+    callback_(detector_.state());
+  }
+
+  if (poll_interval_ms != 0 && poll_interval_ms != poll_interval_ms_) {
+    poll_interval_ms_ = poll_interval_ms;
+    // Replaces the running timer's interval in place.
+    SetTimer(nullptr, timer_id_, poll_interval_ms, PollTimerProc);
+  }
+}
+
 void DisplayDetection::Stop() {
   if (timer_id_ != 0) {
     KillTimer(nullptr, timer_id_);
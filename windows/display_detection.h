@@ -4,41 +4,47 @@
 #include <windows.h>
 
 #include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "detector.h"
+
 // Scans connected displays using Win32 APIs.
 // Reports whether an external display is connected, whether wireless mirroring
-// (Miracast) is active, and the total display count.
+// (Miracast) is active, and the total display count. The Win32 probes feed the
+// shared no_screen_mirror::Detector, which diffs and matches.
 class DisplayDetection {
  public:
-  struct Result {
-    bool is_external_connected;
-    bool is_screen_mirrored;
-    int display_count;
-    bool is_screen_shared;
-  };
-
+  using Result = no_screen_mirror::DetectionState;
   using ChangeCallback = std::function<void(const Result&)>;
 
   explicit DisplayDetection(ChangeCallback callback);
   ~DisplayDetection();
 
+  // |custom_processes| are UTF-8 executable names, matched case-insensitively.
   void Start(UINT poll_interval_ms = 2000,
-             const std::vector<std::wstring>& custom_processes = {});
+             const std::vector<std::string>& custom_processes = {});
   void Stop();
 
+  // Applies a new poll interval (0 keeps the current one) and, unless null,
+  // custom process list while running. A new interval restarts the timer; a
+  // list that changes which names match is polled right away, anything else
+  // waits for the next tick.
+  void UpdateConfig(UINT poll_interval_ms,
+                    const std::vector<std::string>* custom_processes);
+
  private:
   static void CALLBACK PollTimerProc(HWND hwnd, UINT msg, UINT_PTR id,
                                      DWORD time);
 
-  Result Scan();
-  bool IsScreenSharingProcessRunning();
-
   ChangeCallback callback_;
   UINT_PTR timer_id_ = 0;
-  Result last_result_{false, false, 1, false};
-  std::vector<std::wstring> custom_processes_;
+  UINT poll_interval_ms_ = 2000;
+  std::unique_ptr<no_screen_mirror::DisplayProbe> display_probe_;
+  std::unique_ptr<no_screen_mirror::ProcessProbe> process_probe_;
+  no_screen_mirror::ProcessMatcher matcher_;
+  no_screen_mirror::Detector detector_;
 };
 
 #endif  // DISPLAY_DETECTION_H_
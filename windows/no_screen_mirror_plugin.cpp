@@ -2,7 +2,7 @@
 
 #include <flutter/encodable_value.h>
 
-#include <sstream>
+#include "event_outbox.h"
 
 namespace no_screen_mirror {
 
@@ -58,10 +58,7 @@ NoScreenMirrorPlugin::NoScreenMirrorPlugin(
                      events)
               -> std::unique_ptr<flutter::StreamHandlerError<flutter::EncodableValue>> {
             event_sink_ = std::move(events);
-            if (stream_timer_id_ == 0) {
-              stream_timer_id_ =
-                  SetTimer(nullptr, 0, 1000, StreamTimerProc);
-            }
+            DeliverPending();
             return nullptr;
           },
           // OnCancel
@@ -81,8 +78,7 @@ NoScreenMirrorPlugin::NoScreenMirrorPlugin(
       [this](const DisplayDetection::Result& r) { OnDisplayChanged(r); });
 
   // Initial state
-  last_event_json_ = BuildEventJson(false, false, 1, false);
-  has_pending_event_ = true;
+  outbox_.Record(DetectionState(), MonotonicNowUs());
 }
 
 NoScreenMirrorPlugin::~NoScreenMirrorPlugin() {
@@ -106,7 +102,8 @@ void NoScreenMirrorPlugin::HandleMethodCall(
 
   if (method == "startListening") {
     UINT poll_interval_ms = 2000;
-    std::vector<std::wstring> custom_processes;
+    std::vector<std::string> custom_processes;
+    int max_events_per_second = 1;
 
     const auto* args = std::get_if<flutter::EncodableMap>(method_call.arguments());
     if (args != nullptr) {
@@ -118,6 +115,14 @@ void NoScreenMirrorPlugin::HandleMethodCall(
         }
       }
 
+      auto rate_it = args->find(flutter::EncodableValue("maxEventsPerSecond"));
+      if (rate_it != args->end()) {
+        const auto* val = std::get_if<int32_t>(&rate_it->second);
+        if (val != nullptr && *val >= 0) {
+          max_events_per_second = *val;
+        }
+      }
+
       auto processes_it = args->find(flutter::EncodableValue("customProcesses"));
       if (processes_it != args->end()) {
         const auto* list = std::get_if<flutter::EncodableList>(&processes_it->second);
@@ -125,24 +130,67 @@ void NoScreenMirrorPlugin::HandleMethodCall(
           for (const auto& item : *list) {
             const auto* str = std::get_if<std::string>(&item);
             if (str != nullptr) {
-              // Convert UTF-8 string to wide string
-              int size_needed = MultiByteToWideChar(CP_UTF8, 0, str->c_str(),
-                                                    static_cast<int>(str->size()), nullptr, 0);
-              std::wstring wstr(size_needed, 0);
-              MultiByteToWideChar(CP_UTF8, 0, str->c_str(),
-                                  static_cast<int>(str->size()), &wstr[0], size_needed);
-              custom_processes.push_back(std::move(wstr));
+              custom_processes.push_back(*str);
             }
           }
         }
       }
     }
 
+    outbox_.set_max_events_per_second(max_events_per_second);
     if (!is_listening_) {
       is_listening_ = true;
       detection_->Start(poll_interval_ms, custom_processes);
     }
     result->Success(flutter::EncodableValue("Listening started"));
+  } else if (method == "updateConfig") {
+    // Absent arguments keep their current value.
+    UINT poll_interval_ms = 0;
+    std::vector<std::string> custom_processes;
+    bool has_custom_processes = false;
+
+    const auto* args = std::get_if<flutter::EncodableMap>(method_call.arguments());
+    if (args != nullptr && is_listening_) {
+      auto interval_it = args->find(flutter::EncodableValue("pollingIntervalMs"));
+      if (interval_it != args->end()) {
+        const auto* val = std::get_if<int32_t>(&interval_it->second);
+        if (val != nullptr && *val > 0) {
+          poll_interval_ms = static_cast<UINT>(*val);
+        }
+      }
+
+      auto rate_it = args->find(flutter::EncodableValue("maxEventsPerSecond"));
+      if (rate_it != args->end()) {
+        const auto* val = std::get_if<int32_t>(&rate_it->second);
+        if (val != nullptr && *val >= 0) {
+          outbox_.set_max_events_per_second(*val);
+          // A pending event waits out the new limit instead of the old one.
+          if (stream_timer_id_ != 0) {
+            KillTimer(nullptr, stream_timer_id_);
+            stream_timer_id_ = 0;
+            ScheduleDelivery();
+          }
+        }
+      }
+
+      auto processes_it = args->find(flutter::EncodableValue("customProcesses"));
+      if (processes_it != args->end()) {
+        const auto* list = std::get_if<flutter::EncodableList>(&processes_it->second);
+        if (list != nullptr) {
+          has_custom_processes = true;
+          for (const auto& item : *list) {
+            const auto* str = std::get_if<std::string>(&item);
+            if (str != nullptr) {
+              custom_processes.push_back(*str);
+            }
+          }
+        }
+      }
+
+      detection_->UpdateConfig(
+          poll_interval_ms, has_custom_processes ? &custom_processes : nullptr);
+    }
+    result->Success(flutter::EncodableValue("Config updated"));
   } else if (method == "stopListening") {
     if (is_listening_) {
       is_listening_ = false;
@@ -160,51 +208,47 @@ void NoScreenMirrorPlugin::HandleMethodCall(
 
 void NoScreenMirrorPlugin::OnDisplayChanged(
     const DisplayDetection::Result& detection_result) {
-  std::string json = BuildEventJson(detection_result.is_screen_mirrored,
-                                    detection_result.is_external_connected,
-                                    detection_result.display_count,
-                                    detection_result.is_screen_shared);
-  if (json != last_event_json_) {
-    last_event_json_ = json;
-    has_pending_event_ = true;
+  if (outbox_.Record(detection_result, MonotonicNowUs())) {
+    ScheduleDelivery();
   }
 }
 
 // -------------------------------------------------------------------------
-// Stream timer (1s polling to deliver events to Dart)
+// Event delivery (rate limited by maxEventsPerSecond)
 // -------------------------------------------------------------------------
 
+void NoScreenMirrorPlugin::DeliverPending() {
+  if (event_sink_ && outbox_.TakePending(MonotonicNowUs(), &event_json_)) {
+    event_sink_->Success(flutter::EncodableValue(event_json_));
+  }
+}
+
+void NoScreenMirrorPlugin::ScheduleDelivery() {
+  if (!event_sink_ || stream_timer_id_ != 0) return;
+
+  int64_t now_us = MonotonicNowUs();
+  int64_t take_at_us = outbox_.NextTakeUs(now_us);
+  if (take_at_us <= now_us) {
+    DeliverPending();
+    return;
+  }
+  // Changes until the timer fires replace the pending event.
+  stream_timer_id_ = SetTimer(
+      nullptr, 0, static_cast<UINT>((take_at_us - now_us + 999) / 1000),
+      StreamTimerProc);
+}
+
 // static
 void CALLBACK NoScreenMirrorPlugin::StreamTimerProc(HWND /*hwnd*/,
                                                      UINT /*msg*/,
-                                                     UINT_PTR /*id*/,
+                                                     UINT_PTR id,
                                                      DWORD /*time*/) {
+  // SetTimer repeats; each one is only needed once.
+  KillTimer(nullptr, id);
   if (g_plugin_instance == nullptr) return;
   auto* self = g_plugin_instance;
-
-  if (self->has_pending_event_ && self->event_sink_) {
-    self->event_sink_->Success(
-        flutter::EncodableValue(self->last_event_json_));
-    self->has_pending_event_ = false;
-  }
-}
-
-// -------------------------------------------------------------------------
-// JSON builder
-// -------------------------------------------------------------------------
-
-std::string NoScreenMirrorPlugin::BuildEventJson(bool is_screen_mirrored,
-                                                  bool is_external_connected,
-                                                  int display_count,
-                                                  bool is_screen_shared) {
-  std::ostringstream oss;
-  oss << "{\"is_screen_mirrored\":" << (is_screen_mirrored ? "true" : "false")
-      << ",\"is_external_display_connected\":"
-      << (is_external_connected ? "true" : "false")
-      << ",\"display_count\":" << display_count
-      << ",\"is_screen_shared\":" << (is_screen_shared ? "true" : "false")
-      << "}";
-  return oss.str();
+  self->stream_timer_id_ = 0;
+  self->DeliverPending();
 }
 
 }  // namespace no_screen_mirror
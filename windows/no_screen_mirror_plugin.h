@@ -13,6 +13,7 @@
 #include <vector>
 
 #include "display_detection.h"
+#include "event_outbox.h"
 
 namespace no_screen_mirror {
 
@@ -33,13 +34,14 @@ class NoScreenMirrorPlugin : public flutter::Plugin {
 
   void OnDisplayChanged(const DisplayDetection::Result& detection_result);
 
+  // Sends the pending event now if the rate limit allows, otherwise arms
+  // StreamTimerProc for when it does.
+  void ScheduleDelivery();
+  void DeliverPending();
+
   static void CALLBACK StreamTimerProc(HWND hwnd, UINT msg, UINT_PTR id,
                                        DWORD time);
 
-  std::string BuildEventJson(bool is_screen_mirrored,
-                             bool is_external_connected, int display_count,
-                             bool is_screen_shared);
-
   flutter::PluginRegistrarWindows* registrar_;
   std::unique_ptr<flutter::MethodChannel<flutter::EncodableValue>>
       method_channel_;
@@ -47,8 +49,8 @@ class NoScreenMirrorPlugin : public flutter::Plugin {
       event_channel_;
 
   bool is_listening_ = false;
-  std::string last_event_json_;
-  bool has_pending_event_ = false;
+  EventOutbox outbox_;
+  std::string event_json_;
   UINT_PTR stream_timer_id_ = 0;
   std::unique_ptr<flutter::EventSink<flutter::EncodableValue>> event_sink_;
   std::unique_ptr<DisplayDetection> detection_;